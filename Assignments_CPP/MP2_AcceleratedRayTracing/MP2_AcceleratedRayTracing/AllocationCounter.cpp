@@ -0,0 +1,135 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+static std::atomic<uint64_t> allocations{ 0 };
+
+static void* allocate(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// The nothrow forms forward to these by default. The array forms usually do too, but aren't required to.
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Over-aligned types (C++17) go through their own allocation functions, which don't forward to the ones above
+#ifdef __cpp_aligned_new
+static void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t bytes = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    void* memory = _aligned_malloc(size > 0 ? size : 1, bytes);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    void* memory = std::aligned_alloc(bytes, size > 0 ? (size + bytes - 1) / bytes * bytes : bytes);
+#endif
+    if (memory) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+static void freeAligned(void* memory)
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+#endif
+#endif
+
+/*
+* @return Whether heap allocations are being counted (COUNT_HEAP_ALLOCATIONS is defined)
+*/
+bool AllocationCounter::enabled()
+{
+#ifdef COUNT_HEAP_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+* @return The number of heap allocations made so far by any thread, 0 if they aren't being counted
+*/
+uint64_t AllocationCounter::count()
+{
+#ifdef COUNT_HEAP_ALLOCATIONS
+    return allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
@@ -2,8 +2,11 @@
 
 #include "Vec3D.h"
 #include "Ray3D.h"
+#include "TraversalRay.h"
 
 #include <cmath>
+#include <limits>
+#include <utility>
 
 class AxisAlignedBoundingBox
 {
@@ -20,11 +23,21 @@ public:
     const Point3D& max() const;
 
     bool hit(const Ray3D& r, double t_min, double t_max) const;
+    bool hit(const Ray3D& r, double t_min, double t_max, double& t_entry) const;
+    bool hit(const TraversalRay& r, double& t_entry) const;
     //inline bool hit(const Ray3D& r, double t_min, double t_max) const
 
+    void expand(const AxisAlignedBoundingBox& other);
+    void expand(const Point3D& p);
+    Point3D centroid() const;
+    double surfaceArea() const;
+
     std::string toString() const;
 };
 
 using AABB = AxisAlignedBoundingBox;
 using AABB3D = AxisAlignedBoundingBox;
 
+const AABB3D EMPTY_BOUNDING_BOX{ Point3D(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()),
+    Point3D(-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()) };
+
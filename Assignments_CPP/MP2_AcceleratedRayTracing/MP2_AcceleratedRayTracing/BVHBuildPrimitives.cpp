@@ -0,0 +1,214 @@
+#include "BVHBuildPrimitives.h"
+
+/*
+* Constructor for BVHBuildPrimitives. Caches the bounds, centroid and intersection cost of every primitive in parallel.
+*
+* @param primitives The primitives to build over
+* @param params The intersection costs
+* @param pool The thread pool to run on
+*/
+BVHBuildPrimitives::BVHBuildPrimitives(const std::vector<std::shared_ptr<Object>>& primitives, const BVHBuildParameters& params, ThreadPool& pool)
+{
+    size_t n = primitives.size();
+    bounds.resize(n);
+    centroids.resize(n);
+    costs.resize(n);
+    indices.resize(n);
+
+    pool.parallelFor(0, n, BVH_PARALLEL_BUILD_CUTOFF, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            if (!primitives[i]->generateBoundingBox(bounds[i])) {
+                std::cerr << "No bounding box in BVH build.\n";
+            }
+            centroids[i] = bounds[i].centroid();
+            costs[i] = params.intersectionCost(*primitives[i]);
+            indices[i] = (uint32_t)i;
+        }
+    });
+}
+
+/*
+* Bounds the primitives indices[start, end) and their centroids
+*
+* @param start The left-bound index of the range
+* @param end The right-bound index of the range
+* @param nodeBox The bounding box of the primitives. Modified by function.
+* @param centroidBox The bounding box of the primitives' centroids. Modified by function.
+*/
+void BVHBuildPrimitives::rangeBounds(size_t start, size_t end, AABB3D& nodeBox, AABB3D& centroidBox) const
+{
+    nodeBox = EMPTY_BOUNDING_BOX;
+    centroidBox = EMPTY_BOUNDING_BOX;
+    for (size_t i = start; i < end; i++) {
+        nodeBox.expand(bounds[indices[i]]);
+        centroidBox.expand(centroids[indices[i]]);
+    }
+}
+
+/*
+* @param start The left-bound index of the range
+* @param end The right-bound index of the range
+*
+* @return The summed intersection cost of the primitives indices[start, end)
+*/
+double BVHBuildPrimitives::rangeCost(size_t start, size_t end) const
+{
+    double cost = 0;
+    for (size_t i = start; i < end; i++) {
+        cost += costs[indices[i]];
+    }
+    return cost;
+}
+
+/*
+* Finds the cheapest split of indices[start, end) using the binned surface area heuristic, and partitions the indices around it.
+* Large ranges are binned in parallel chunks whose bins are merged afterwards.
+*
+* @param start The left-bound index of the primitives to split
+* @param end The right-bound index of the primitives to split
+* @param nodeBox The bounding box of the primitives
+* @param centroidBox The bounding box of the primitives' centroids
+* @param params The bin count and SAH costs
+* @param mid The index of the first primitive in the right half. Modified by function.
+* @param axis The chosen split axis. Modified by function.
+* @param pool The thread pool to bin large ranges on
+*
+* @return True if a split was found, false if every centroid falls into the same bin
+*/
+bool BVHBuildPrimitives::sahSplit(size_t start, size_t end, const AABB3D& nodeBox, const AABB3D& centroidBox, const BVHBuildParameters& params, size_t& mid, int& axis, ThreadPool& pool)
+{
+    const size_t binCount = std::max<size_t>(params.binCount, 2);
+    double nodeArea = nodeBox.surfaceArea();
+    if (nodeArea <= 0) {
+        return false;
+    }
+
+    double scale[3];
+    for (int a = 0; a < 3; a++) {
+        double extent = centroidBox.max()[a] - centroidBox.min()[a];
+        scale[a] = extent > 0 ? binCount / extent : 0;
+    }
+    auto binOf = [&](uint32_t p, int a) -> size_t {
+        return std::min(binCount - 1, (size_t)((centroids[p][a] - centroidBox.min()[a]) * scale[a]));
+    };
+
+    // Every chunk fills its own bins for all three axes at once (index a * binCount + b)
+    size_t span = end - start;
+    size_t chunkCount = span >= BVH_PARALLEL_BINNING_CUTOFF ? pool.getThreadCount() + 1 : 1;
+    std::vector<std::vector<AABB3D>> chunkBoxes(chunkCount, std::vector<AABB3D>(3 * binCount, EMPTY_BOUNDING_BOX));
+    std::vector<std::vector<double>> chunkCosts(chunkCount, std::vector<double>(3 * binCount, 0.0));
+
+    auto binChunk = [&](size_t c) {
+        std::vector<AABB3D>& binBoxes = chunkBoxes[c];
+        std::vector<double>& binCosts = chunkCosts[c];
+        for (size_t i = start + c * span / chunkCount; i < start + (c + 1) * span / chunkCount; i++) {
+            uint32_t p = indices[i];
+            for (int a = 0; a < 3; a++) {
+                size_t b = a * binCount + binOf(p, a);
+                binBoxes[b].expand(bounds[p]);
+                binCosts[b] += costs[p];
+            }
+        }
+    };
+    if (chunkCount > 1) {
+        pool.parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                binChunk(c);
+            }
+        });
+        for (size_t c = 1; c < chunkCount; c++) {
+            for (size_t b = 0; b < 3 * binCount; b++) {
+                chunkBoxes[0][b].expand(chunkBoxes[c][b]);
+                chunkCosts[0][b] += chunkCosts[c][b];
+            }
+        }
+    }
+    else {
+        binChunk(0);
+    }
+    const std::vector<AABB3D>& binBoxes = chunkBoxes[0];
+    const std::vector<double>& binCosts = chunkCosts[0];
+
+    double bestCost = std::numeric_limits<double>::infinity();
+    int bestAxis = -1;
+    size_t bestBin = 0;
+    std::vector<AABB3D> rightBoxes(binCount);
+    std::vector<double> rightCosts(binCount);
+
+    for (int a = 0; a < 3; a++) {
+        if (scale[a] <= 0) {
+            continue;
+        }
+        const size_t offset = a * binCount;
+
+        // Sweep from the right to accumulate the right-hand side of every split plane
+        AABB3D runningBox = EMPTY_BOUNDING_BOX;
+        double runningCost = 0;
+        for (size_t b = binCount - 1; b > 0; b--) {
+            runningBox.expand(binBoxes[offset + b]);
+            runningCost += binCosts[offset + b];
+            rightBoxes[b] = runningBox;
+            rightCosts[b] = runningCost;
+        }
+
+        // Sweep from the left and evaluate the split in front of every bin
+        runningBox = EMPTY_BOUNDING_BOX;
+        runningCost = 0;
+        for (size_t b = 1; b < binCount; b++) {
+            runningBox.expand(binBoxes[offset + b - 1]);
+            runningCost += binCosts[offset + b - 1];
+            if (runningCost == 0 || rightCosts[b] == 0) {
+                continue;
+            }
+            double cost = params.traversalCost
+                + (runningBox.surfaceArea() * (params.leafCost + runningCost) + rightBoxes[b].surfaceArea() * (params.leafCost + rightCosts[b])) / nodeArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = a;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis < 0) {
+        return false;
+    }
+
+    // Move every primitive left of the chosen plane to the front of the range
+    auto split = std::partition(indices.begin() + start, indices.begin() + end, [&](const uint32_t& p) -> bool {
+        return binOf(p, bestAxis) < bestBin;
+    });
+    mid = split - indices.begin();
+    axis = bestAxis;
+    return mid != start && mid != end;
+}
+
+/*
+* Partially sorts indices[start, end) so that indices[mid] holds the primitive with the median centroid along an axis
+*
+* @param start The left-bound index of the range
+* @param end The right-bound index of the range
+* @param mid The index of the median
+* @param axis The axis to compare centroids along
+*/
+void BVHBuildPrimitives::medianSplit(size_t start, size_t end, size_t mid, int axis)
+{
+    std::nth_element(indices.begin() + start, indices.begin() + mid, indices.begin() + end,
+        [&](const uint32_t& a, const uint32_t& b) -> bool { return centroids[a][axis] < centroids[b][axis]; });
+}
+
+/*
+* @param box A bounding box
+*
+* @return The axis along which the box is widest
+*/
+int BVHBuildPrimitives::longestAxis(const AABB3D& box)
+{
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (box.max()[a] - box.min()[a] > box.max()[axis] - box.min()[axis]) {
+            axis = a;
+        }
+    }
+    return axis;
+}
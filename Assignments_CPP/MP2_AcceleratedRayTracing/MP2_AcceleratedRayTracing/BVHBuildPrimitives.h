@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BVHNode.h"
+#include "ThreadPool.h"
+
+constexpr size_t BVH_PARALLEL_BUILD_CUTOFF = 4096;      // subtrees with fewer primitives are built on the current thread
+constexpr size_t BVH_PARALLEL_BINNING_CUTOFF = 65536;   // ranges with fewer primitives are binned on the current thread
+
+// Per-primitive data cached once at the start of a build. Builders only ever reorder the index array,
+// so no primitive (or shared_ptr refcount) is touched while the tree is being split.
+struct BVHBuildPrimitives {
+    std::vector<AABB3D> bounds;
+    std::vector<Point3D> centroids;
+    std::vector<double> costs;
+    std::vector<uint32_t> indices;
+
+    BVHBuildPrimitives(const std::vector<std::shared_ptr<Object>>& primitives, const BVHBuildParameters& params, ThreadPool& pool = ThreadPool::global());
+
+    void rangeBounds(size_t start, size_t end, AABB3D& nodeBox, AABB3D& centroidBox) const;
+    double rangeCost(size_t start, size_t end) const;
+    bool sahSplit(size_t start, size_t end, const AABB3D& nodeBox, const AABB3D& centroidBox, const BVHBuildParameters& params, size_t& mid, int& axis, ThreadPool& pool = ThreadPool::global());
+    void medianSplit(size_t start, size_t end, size_t mid, int axis);
+
+    static int longestAxis(const AABB3D& box);
+};
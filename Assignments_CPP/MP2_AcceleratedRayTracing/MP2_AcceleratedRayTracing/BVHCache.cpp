@@ -0,0 +1,390 @@
+#include "BVHCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+* Constructor for MappedFile. Maps the whole file read-only; isOpen() is false if it is missing or empty.
+*
+* @param path The path of the file
+*/
+MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0)
+{
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    fileHandle = file;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        return;
+    }
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        return;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data != nullptr) {
+        size = (size_t)fileSize.QuadPart;
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const unsigned char*>(mapping);
+            size = (size_t)fileStat.st_size;
+        }
+    }
+    close(fd);
+#endif
+}
+
+/*
+* Destructor for MappedFile. Unmaps the file.
+*/
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+#else
+    if (data != nullptr) {
+        munmap(const_cast<unsigned char*>(data), size);
+    }
+#endif
+}
+
+/*
+* @return Whether the file is mapped
+*/
+bool MappedFile::isOpen() const
+{
+    return data != nullptr;
+}
+
+/*
+* @return The first byte of the mapped file
+*/
+const unsigned char* MappedFile::getData() const
+{
+    return data;
+}
+
+/*
+* @return The size of the mapped file in bytes
+*/
+size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+/*
+* Constructor for BVHCache. Hashes the OBJ file's contents straight from a memory mapping.
+*
+* @param objFilepath The OBJ file the mesh is parsed from. The cache file sits next to it.
+* @param params The split method and SAH costs to build with
+*/
+BVHCache::BVHCache(const std::string& objFilepath, const BVHBuildParameters& params)
+    : objFilepath(objFilepath), cacheFilepath(objFilepath + ".bvhcache"), params(params), contentHash(0), parametersHash(hashParameters(params))
+{
+    MappedFile objFile(objFilepath);
+    if (objFile.isOpen()) {
+        contentHash = hashBytes(objFile.getData(), objFile.getSize());
+    }
+}
+
+/*
+* FNV-1a hash of a byte range, taken 8 bytes at a time so hashing a large mesh stays far cheaper than parsing it
+*
+* @param data The first byte
+* @param size The number of bytes
+* @param hash The hash to continue from
+*
+* @return The hash
+*/
+uint64_t BVHCache::hashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+* @param params The split method and SAH costs to build with
+*
+* @return A hash of the parameters and of every constant that changes the built tree
+*/
+uint64_t BVHCache::hashParameters(const BVHBuildParameters& params)
+{
+    uint64_t splitMethod = (uint64_t)params.splitMethod;
+    uint64_t binCount = params.binCount;
+    uint64_t maxLeafPrimitives = params.leafPrimitiveLimit();
+    uint64_t maxSAHDepth = LINEAR_BVH_MAX_SAH_DEPTH;
+    double costs[6]{ params.traversalCost, params.leafCost, params.sphereIntersectionCost, params.triangleIntersectionCost, params.spatialSplitBudget,
+        params.optimizationSeconds };
+
+    uint64_t hash = hashBytes(&splitMethod, sizeof(splitMethod));
+    hash = hashBytes(&binCount, sizeof(binCount), hash);
+    hash = hashBytes(&maxLeafPrimitives, sizeof(maxLeafPrimitives), hash);
+    hash = hashBytes(&maxSAHDepth, sizeof(maxSAHDepth), hash);
+    return hashBytes(costs, sizeof(costs), hash);
+}
+
+/*
+* @return The path of the cache file
+*/
+const std::string& BVHCache::getCacheFilepath() const
+{
+    return cacheFilepath;
+}
+
+/*
+* Checks that a mapped cache file belongs to the current OBJ file and parameters, is complete and uncorrupted,
+* and only holds in-range indices, so traversal can trust it
+*
+* @param file The mapped cache file
+*
+* @return True if the cache can be loaded
+*/
+bool BVHCache::validate(const MappedFile& file) const
+{
+    if (!file.isOpen() || file.getSize() < sizeof(BVHCacheHeader)) {
+        return false;
+    }
+    BVHCacheHeader header;
+    std::memcpy(&header, file.getData(), sizeof(header));
+    if (std::memcmp(header.magic, BVH_CACHE_MAGIC, sizeof(BVH_CACHE_MAGIC)) != 0 || header.version != BVH_CACHE_VERSION
+        || header.nodeSize != sizeof(LinearBVHNode)) {
+        return false;
+    }
+    if (header.contentHash != contentHash || header.parametersHash != parametersHash) {
+        std::cout << "BVH cache is stale." << std::endl;
+        return false;
+    }
+
+    // Every count is bounded by the file size before any of them is multiplied, so the sum cannot overflow
+    const uint64_t fileSize = file.getSize();
+    bool countsInRange = header.vertexCount <= fileSize && header.faceCount <= fileSize && header.nodeCount <= fileSize && header.indexCount <= fileSize;
+    uint64_t expectedSize = sizeof(BVHCacheHeader) + header.vertexCount * 6 * sizeof(double) + header.faceCount * 3 * sizeof(uint32_t)
+        + header.nodeCount * sizeof(LinearBVHNode) + header.indexCount * sizeof(uint32_t);
+    if (!countsInRange || expectedSize != fileSize || header.indexCount < header.faceCount) {
+        std::cout << "BVH cache is truncated." << std::endl;
+        return false;
+    }
+
+    const unsigned char* payload = file.getData() + sizeof(BVHCacheHeader);
+    if (hashBytes(payload, fileSize - sizeof(BVHCacheHeader)) != header.payloadHash) {
+        std::cout << "BVH cache is corrupt." << std::endl;
+        return false;
+    }
+
+    const uint32_t* faceData = reinterpret_cast<const uint32_t*>(payload + header.vertexCount * 6 * sizeof(double));
+    for (uint64_t i = 0; i < 3 * header.faceCount; i++) {
+        if (faceData[i] >= header.vertexCount) {
+            return false;
+        }
+    }
+    // Children always follow their parent, so one forward pass finds every node's depth. Traversal keeps its stack
+    // in a fixed LINEAR_BVH_STACK_SIZE array, so a deeper tree is rejected like LinearBVH::optimize rejects one.
+    const unsigned char* nodeData = payload + header.vertexCount * 6 * sizeof(double) + header.faceCount * 3 * sizeof(uint32_t);
+    std::vector<uint32_t> depths(header.nodeCount, 0);
+    if (header.nodeCount > 0) {
+        depths[0] = 1;
+    }
+    for (uint64_t i = 0; i < header.nodeCount; i++) {
+        LinearBVHNode node;
+        std::memcpy(&node, nodeData + i * sizeof(LinearBVHNode), sizeof(LinearBVHNode));
+        bool inRange = node.primitiveCount > 0 ? (uint64_t)node.offset + node.primitiveCount <= header.indexCount
+            : node.offset > i + 1 && node.offset < header.nodeCount;
+        if (!inRange) {
+            return false;
+        }
+        if (node.primitiveCount == 0) {
+            uint32_t childDepth = depths[i] + 1;
+            if (childDepth >= LINEAR_BVH_STACK_SIZE) {
+                std::cout << "BVH cache is too deep." << std::endl;
+                return false;
+            }
+            depths[i + 1] = std::max(depths[i + 1], childDepth);
+            depths[node.offset] = std::max(depths[node.offset], childDepth);
+        }
+    }
+    const uint32_t* indexData = reinterpret_cast<const uint32_t*>(nodeData + header.nodeCount * sizeof(LinearBVHNode));
+    for (uint64_t i = 0; i < header.indexCount; i++) {
+        if (indexData[i] >= header.faceCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+* Loads the mesh and its BVH from the cache file if it is valid. Nothing is modified otherwise.
+*
+* @param triangleMesh The TriangleMesh to load the vertices, normals and faces into. Modified by function.
+* @param bvh The BVH over the mesh's triangles. Modified by function.
+*
+* @return True if the cache was loaded
+*/
+bool BVHCache::load(TriangleMesh& triangleMesh, std::shared_ptr<LinearBVH>& bvh) const
+{
+    MappedFile file(cacheFilepath);
+    if (contentHash == 0 || !validate(file)) {
+        return false;
+    }
+
+    BVHCacheHeader header;
+    std::memcpy(&header, file.getData(), sizeof(header));
+    const unsigned char* payload = file.getData() + sizeof(BVHCacheHeader);
+    const double* vertexData = reinterpret_cast<const double*>(payload);
+    const double* normalData = vertexData + 3 * header.vertexCount;
+    const uint32_t* faceData = reinterpret_cast<const uint32_t*>(normalData + 3 * header.vertexCount);
+    const unsigned char* nodeData = reinterpret_cast<const unsigned char*>(faceData + 3 * header.faceCount);
+    triangleMesh.loadFromBuffers(vertexData, normalData, (size_t)header.vertexCount, faceData, (size_t)header.faceCount);
+
+    std::vector<LinearBVHNode> nodes((size_t)header.nodeCount);
+    std::vector<uint32_t> primitiveIndices((size_t)header.indexCount);
+    std::memcpy(nodes.data(), nodeData, nodes.size() * sizeof(LinearBVHNode));
+    std::memcpy(primitiveIndices.data(), nodeData + nodes.size() * sizeof(LinearBVHNode), primitiveIndices.size() * sizeof(uint32_t));
+
+    const std::vector<std::shared_ptr<Triangle>> triangles = triangleMesh.getTriangles();
+    std::vector<std::shared_ptr<Object>> primitives(triangles.begin(), triangles.end());
+    bvh = std::make_shared<LinearBVH>(primitives, std::move(nodes), std::move(primitiveIndices), params);
+    return true;
+}
+
+/*
+* Writes the mesh and its BVH to the cache file. The file is written under a temporary name and then renamed,
+* so an interrupted write never leaves a partial cache behind.
+*
+* @param triangleMesh The TriangleMesh, in model space, whose triangles the BVH was built over
+* @param bvh The BVH
+*
+* @return True if the cache was written
+*/
+bool BVHCache::save(const TriangleMesh& triangleMesh, const LinearBVH& bvh) const
+{
+    const std::vector<std::shared_ptr<Point3D>>& vertices = triangleMesh.getVertices();
+    const std::vector<std::shared_ptr<Vec3D>>& normals = triangleMesh.getNormals();
+    const std::vector<std::shared_ptr<TriangleFace>>& faces = triangleMesh.getFaces();
+    const std::vector<LinearBVHNode>& nodes = bvh.getNodes();
+    const std::vector<uint32_t>& primitiveIndices = bvh.getPrimitiveIndices();
+    if (contentHash == 0 || normals.size() != vertices.size() || primitiveIndices.size() < faces.size()
+        || vertices.size() > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    std::vector<double> vertexData;
+    vertexData.reserve(6 * vertices.size());
+    for (const std::shared_ptr<Point3D>& v : vertices) {
+        vertexData.insert(vertexData.end(), { (*v)[0], (*v)[1], (*v)[2] });
+    }
+    for (const std::shared_ptr<Vec3D>& n : normals) {
+        vertexData.insert(vertexData.end(), { (*n)[0], (*n)[1], (*n)[2] });
+    }
+    std::vector<uint32_t> faceData;
+    faceData.reserve(3 * faces.size());
+    for (const std::shared_ptr<TriangleFace>& f : faces) {
+        faceData.insert(faceData.end(), { (uint32_t)f->v0_idx, (uint32_t)f->v1_idx, (uint32_t)f->v2_idx });
+    }
+
+    // The payload hash runs over all sections back to back, exactly as they sit in the file
+    std::vector<unsigned char> payload(vertexData.size() * sizeof(double) + faceData.size() * sizeof(uint32_t)
+        + nodes.size() * sizeof(LinearBVHNode) + primitiveIndices.size() * sizeof(uint32_t));
+    unsigned char* cursor = payload.data();
+    auto append = [&cursor](const void* source, size_t bytes) {
+        if (bytes > 0) {
+            std::memcpy(cursor, source, bytes);
+            cursor += bytes;
+        }
+    };
+    append(vertexData.data(), vertexData.size() * sizeof(double));
+    append(faceData.data(), faceData.size() * sizeof(uint32_t));
+    append(nodes.data(), nodes.size() * sizeof(LinearBVHNode));
+    append(primitiveIndices.data(), primitiveIndices.size() * sizeof(uint32_t));
+
+    BVHCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BVH_CACHE_MAGIC, sizeof(BVH_CACHE_MAGIC));
+    header.version = BVH_CACHE_VERSION;
+    header.nodeSize = sizeof(LinearBVHNode);
+    header.contentHash = contentHash;
+    header.parametersHash = parametersHash;
+    header.vertexCount = vertices.size();
+    header.faceCount = faces.size();
+    header.nodeCount = nodes.size();
+    header.indexCount = primitiveIndices.size();
+    header.payloadHash = hashBytes(payload.data(), payload.size());
+
+    std::string temporaryFilepath = cacheFilepath + ".tmp";
+    {
+        std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        if (!file) {
+            std::remove(temporaryFilepath.c_str());
+            return false;
+        }
+    }
+    std::remove(cacheFilepath.c_str());
+    return std::rename(temporaryFilepath.c_str(), cacheFilepath.c_str()) == 0;
+}
+
+/*
+* Loads the mesh and its BVH from the cache, or parses the OBJ file, builds the BVH and writes the cache
+* if the cache is missing, stale or corrupt
+*
+* @param triangleMesh An empty TriangleMesh to load into. Modified by function.
+*
+* @return The BVH over the mesh's triangles
+*/
+std::shared_ptr<LinearBVH> BVHCache::loadOrBuild(const std::shared_ptr<TriangleMesh>& triangleMesh) const
+{
+    std::shared_ptr<LinearBVH> bvh;
+    if (load(*triangleMesh, bvh)) {
+        std::cout << "Loaded mesh and BVH from " << cacheFilepath << std::endl;
+        return bvh;
+    }
+
+    std::cout << "Building BVH cache " << cacheFilepath << "..." << std::endl;
+    triangleMesh->loadFromOBJFile(objFilepath);
+    bvh = std::make_shared<LinearBVH>(triangleMesh, params);
+    if (!save(*triangleMesh, *bvh)) {
+        std::cerr << "Could not write BVH cache " << cacheFilepath << std::endl;
+    }
+    return bvh;
+}
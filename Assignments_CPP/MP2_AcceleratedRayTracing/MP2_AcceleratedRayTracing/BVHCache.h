@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "LinearBVH.h"
+#include "TriangleMesh.h"
+
+constexpr char BVH_CACHE_MAGIC[8] = { 'M', 'P', '2', 'B', 'V', 'H', 'C', '\0' };
+constexpr uint32_t BVH_CACHE_VERSION = 2;       // bump whenever the file layout or the builders change
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+// Fixed-size header at the start of a cache file. It is followed by the vertex buffer (3 doubles per vertex),
+// the normal buffer (3 doubles per vertex), the faces (3 uint32 per face), the nodes and the primitive indices.
+struct BVHCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeSize;          // sizeof(LinearBVHNode) of the writer
+    uint64_t contentHash;       // hash of the OBJ file the mesh was parsed from
+    uint64_t parametersHash;    // hash of the build parameters and leaf limits
+    uint64_t vertexCount;
+    uint64_t faceCount;
+    uint64_t nodeCount;
+    uint64_t indexCount;
+    uint64_t payloadHash;       // hash of everything after the header
+};
+
+// A read-only memory mapping of a whole file. Unmapped when destroyed.
+class MappedFile
+{
+private:
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const unsigned char* getData() const;
+    size_t getSize() const;
+};
+
+// Binary cache of a parsed OBJ mesh and the LinearBVH built over it, stored next to the OBJ file. The cache is keyed by
+// a hash of the OBJ file's contents and of the build parameters, so editing the mesh or changing the parameters
+// invalidates it. Corrupt, truncated or stale caches are rejected and the mesh is parsed and built again.
+class BVHCache
+{
+private:
+    std::string objFilepath;
+    std::string cacheFilepath;
+    BVHBuildParameters params;
+    uint64_t contentHash;
+    uint64_t parametersHash;
+
+    bool validate(const MappedFile& file) const;
+
+public:
+    BVHCache(const std::string& objFilepath, const BVHBuildParameters& params);
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+    static uint64_t hashParameters(const BVHBuildParameters& params);
+
+    const std::string& getCacheFilepath() const;
+
+    bool load(TriangleMesh& triangleMesh, std::shared_ptr<LinearBVH>& bvh) const;
+    bool save(const TriangleMesh& triangleMesh, const LinearBVH& bvh) const;
+    std::shared_ptr<LinearBVH> loadOrBuild(const std::shared_ptr<TriangleMesh>& triangleMesh) const;
+};
@@ -1,4 +1,5 @@
 #include "BVHNode.h"
+#include "BVHBuildPrimitives.h"
 
 /*
 * Default constructor for BVHNode
@@ -9,18 +10,14 @@ BVHNode::BVHNode() : Object(ObjectType::BVHNode) {}
 * Constructor for BVHNode
 * 
 * @param triangleMesh The TriangleMesh with which to build a BVH Tree
+* @param params The split method and SAH costs to build with
 */
-BVHNode::BVHNode(const std::shared_ptr<TriangleMesh>& triangleMesh) : Object(ObjectType::BVHNode)
+BVHNode::BVHNode(const std::shared_ptr<TriangleMesh>& triangleMesh, const BVHBuildParameters& params) : Object(ObjectType::BVHNode)
 {
-    std::vector<std::shared_ptr<Object>> objs;
-    for (std::shared_ptr<Triangle> so : triangleMesh->getTriangles()) {
-        //std::cout << "Triangle: " << so->toString() << std::endl;
-        objs.push_back(so);
-    }
-    auto box_x_compare = [&](const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b) -> bool {return box_compare(a, b, 0); };
-    std::sort(objs.begin(), objs.end(), box_x_compare);
+    const std::vector<std::shared_ptr<Triangle>>& triangles = triangleMesh->getTriangles();
+    std::vector<std::shared_ptr<Object>> objs(triangles.begin(), triangles.end());
     std::cout << "Objects to insert into BVH Tree: " << objs.size() << std::endl;
-    *this = BVHNode(objs, 0, objs.size());
+    buildRoot(objs, 0, objs.size(), params);
     std::cout << std::endl << objs.size() << " objects in BVH tree!" << std::endl;
 }
 
@@ -28,17 +25,13 @@ BVHNode::BVHNode(const std::shared_ptr<TriangleMesh>& triangleMesh) : Object(Obj
 * Constructor for BVHNode
 * 
 * @param list A list of SceneObjects to use to build the BVH Tree
+* @param params The split method and SAH costs to build with
 */
-BVHNode::BVHNode(const std::vector<std::shared_ptr<SceneObject>>& list) : Object(ObjectType::BVHNode) 
+BVHNode::BVHNode(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params) : Object(ObjectType::BVHNode) 
 {
-    std::vector<std::shared_ptr<Object>> objs;
-    for (std::shared_ptr<SceneObject> so : list) {
-        objs.push_back(so);
-    }
-    auto box_x_compare = [&](const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b) -> bool {return box_compare(a, b, 0); };
-    std::sort(objs.begin(), objs.end(), box_x_compare);
+    std::vector<std::shared_ptr<Object>> objs(list.begin(), list.end());
     std::cout << "Objects to insert into BVH: " << objs.size() << std::endl;
-    *this = BVHNode(objs, 0, objs.size());
+    buildRoot(objs, 0, objs.size(), params);
     std::cout << std::endl << objs.size() << " objects in BVH tree!" << std::endl;
 }
 
@@ -47,74 +40,132 @@ BVHNode::BVHNode(const std::vector<std::shared_ptr<SceneObject>>& list) : Object
 * Constructor for BVHNode
 * 
 * @param list A list of Objects to use to build the BVH Tree
+* @param params The split method and SAH costs to build with
 */
-BVHNode::BVHNode(const std::vector<std::shared_ptr<Object>> list) : BVHNode(list, 0, list.size()) {}
+BVHNode::BVHNode(const std::vector<std::shared_ptr<Object>> list, const BVHBuildParameters& params) : BVHNode(list, 0, list.size(), params) {}
 
 /*
-* Primary Constructor for BVHNode (do not call directly)
+* Constructor for BVHNode
 * 
-* @param src_objects A list of Objects to build the current BVH Node
-* @param start The left-bound index of the subset of Objects to use in constructing the current node
-* @param end The right-bound index of the subset of Objects to use in constructing the current node
+* @param src_objects A list of Objects to build the BVH Tree from
+* @param start The left-bound index of the subset of Objects to build over
+* @param end The right-bound index of the subset of Objects to build over
+* @param params The split method and SAH costs to build with
 */
-BVHNode::BVHNode(const std::vector<std::shared_ptr<Object>>& src_objects, size_t start, size_t end) : Object(ObjectType::BVHNode) 
+BVHNode::BVHNode(const std::vector<std::shared_ptr<Object>>& src_objects, size_t start, size_t end, const BVHBuildParameters& params) : Object(ObjectType::BVHNode) 
 {
-    leaf = false;
+    buildRoot(src_objects, start, end, params);
+}
 
-    // Lambda expressions for box compare
-    auto box_x_compare = [&](const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b) -> bool {return box_compare(a, b, 0); };
-    auto box_y_compare = [&](const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b) -> bool {return box_compare(a, b, 1); };
-    auto box_z_compare = [&](const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b) -> bool {return box_compare(a, b, 2); };
+/*
+* Primary Constructor for BVHNode (only called by build)
+* 
+* @param objects The Objects the tree is built over
+* @param buildPrimitives The cached Object bounds and the index array being partitioned. Modified by function.
+* @param start The left-bound index of the indices to use in constructing the current node
+* @param end The right-bound index of the indices to use in constructing the current node
+* @param params The split method and SAH costs to build with
+*/
+BVHNode::BVHNode(const std::vector<std::shared_ptr<Object>>& objects, BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, const BVHBuildParameters& params) : Object(ObjectType::BVHNode)
+{
+    build(objects, buildPrimitives, start, end, params);
+}
 
-    // Create a modifiable array of the source scene objects
-    auto objects = src_objects; 
+/*
+* Caches the bounds of objects[start, end) and builds the tree over them, ordered by the minimum x of their bounding boxes
+* 
+* @param objects The Objects to build over
+* @param start The left-bound index of the subset of Objects to build over
+* @param end The right-bound index of the subset of Objects to build over
+* @param params The split method and SAH costs to build with
+*/
+void BVHNode::buildRoot(const std::vector<std::shared_ptr<Object>>& objects, size_t start, size_t end, const BVHBuildParameters& params)
+{
+    std::vector<std::shared_ptr<Object>> subset(objects.begin() + start, objects.begin() + end);
+    if (subset.empty()) {
+        leaf = true;
+        box = EMPTY_BOUNDING_BOX;
+        return;
+    }
 
-    // Select the axis of division
-    int axis = Arithmetic::random_int(0, 2);
+    BVHBuildPrimitives buildPrimitives(subset, params);
+    std::sort(buildPrimitives.indices.begin(), buildPrimitives.indices.end(), [&](const uint32_t& a, const uint32_t& b) -> bool {
+        return buildPrimitives.bounds[a].min()[0] < buildPrimitives.bounds[b].min()[0];
+    });
+    build(subset, buildPrimitives, 0, subset.size(), params);
+}
+
+/*
+* Builds the current node over indices[start, end), partitioning the indices in place.
+* Nodes above BVH_PARALLEL_BUILD_CUTOFF build their left child on the thread pool.
+* 
+* @param objects The Objects the tree is built over
+* @param buildPrimitives The cached Object bounds and the index array being partitioned. Modified by function.
+* @param start The left-bound index of the indices to use in constructing the current node
+* @param end The right-bound index of the indices to use in constructing the current node
+* @param params The split method and SAH costs to build with
+*/
+void BVHNode::build(const std::vector<std::shared_ptr<Object>>& objects, BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, const BVHBuildParameters& params)
+{
+    const std::vector<uint32_t>& indices = buildPrimitives.indices;
+    const std::vector<AABB3D>& bounds = buildPrimitives.bounds;
     
     // Perform the division
     size_t object_span = end - start;
     if (object_span == 1) {
-        left = right = objects[start];
+        left = right = objects[indices[start]];
         leaf = true;
+        box = bounds[indices[start]];
+        return;
     }
     else if (object_span == 2) {
-        if (box_compare(objects[start], objects[start + 1], axis)) {
-            left = objects[start];
-            right = objects[start + 1];
+        uint32_t a = indices[start];
+        uint32_t b = indices[start + 1];
+        box = surroundingBox(bounds[a], bounds[b]);
+        int axis = BVHBuildPrimitives::longestAxis(box);
+        if (bounds[a].min()[axis] < bounds[b].min()[axis]) {
+            left = objects[a];
+            right = objects[b];
         }
         else {
-            left = objects[start + 1];
-            right = objects[start];
+            left = objects[b];
+            right = objects[a];
         }
         leaf = true;
-    }
-    else {
-        //if (axis == 0) {
-        //    std::sort(objects.begin() + start, objects.begin() + end, box_x_compare);
-        //}
-        //else if (axis == 1) {
-        //    std::sort(objects.begin() + start, objects.begin() + end, box_y_compare);
-        //}
-        //else {
-        //    std::sort(objects.begin() + start, objects.begin() + end, box_z_compare);
-        //}
-
-        leaf = false;
-
-        auto mid = start + object_span / 2;
-        left = std::make_shared<BVHNode>(objects, start, mid);
-        right = std::make_shared<BVHNode>(objects, mid, end);
+        return;
     }
 
-    AABB3D box_left, box_right;
+    leaf = false;
 
-    if (!left->generateBoundingBox(box_left)
-        || !right->generateBoundingBox(box_right)
-        )
-        std::cerr << "No bounding box in bvh_node constructor.\n";
+    // Binned SAH partitions the indices in place; fall back to the midpoint if no split separates the centroids
+    size_t mid = start + object_span / 2;
+    if (params.splitMethod == BVHSplitMethod::SAH) {
+        AABB3D nodeBox;
+        AABB3D centroidBox;
+        int axis = 0;
+        buildPrimitives.rangeBounds(start, end, nodeBox, centroidBox);
+        if (!buildPrimitives.sahSplit(start, end, nodeBox, centroidBox, params, mid, axis)) {
+            mid = start + object_span / 2;
+        }
+    }
+
+    std::shared_ptr<BVHNode> leftNode;
+    std::shared_ptr<BVHNode> rightNode;
+    if (object_span >= BVH_PARALLEL_BUILD_CUTOFF) {
+        std::future<void> leftTask = ThreadPool::global().submit([&] {
+            leftNode = std::shared_ptr<BVHNode>(new BVHNode(objects, buildPrimitives, start, mid, params));
+        });
+        rightNode = std::shared_ptr<BVHNode>(new BVHNode(objects, buildPrimitives, mid, end, params));
+        ThreadPool::global().wait(leftTask);
+    }
+    else {
+        leftNode = std::shared_ptr<BVHNode>(new BVHNode(objects, buildPrimitives, start, mid, params));
+        rightNode = std::shared_ptr<BVHNode>(new BVHNode(objects, buildPrimitives, mid, end, params));
+    }
 
-    box = surroundingBox(box_left, box_right);
+    box = surroundingBox(leftNode->getBoundingBox(), rightNode->getBoundingBox());
+    left = leftNode;
+    right = rightNode;
 }
 
 /*
@@ -201,6 +252,33 @@ bool BVHNode::box_compare(const std::shared_ptr<Object>& a, const std::shared_pt
     return box_a.min()[axis] < box_b.min()[axis];
 }
 
+/*
+* Computes the surface area heuristic cost of the subtree rooted at this node
+*
+* @param params The traversal, leaf and intersection costs
+*
+* @return The expected cost of tracing a ray which hits this node's bounding box
+*/
+double BVHNode::sahCost(const BVHBuildParameters& params) const
+{
+    if (leaf) {
+        double cost = params.leafCost + params.intersectionCost(*left);
+        if (right != left) {
+            cost += params.intersectionCost(*right);
+        }
+        return cost;
+    }
+
+    double area = box.surfaceArea();
+    double cost = params.traversalCost;
+    for (const Object* child : { left.get(), right.get() }) {
+        const BVHNode* childNode = static_cast<const BVHNode*>(child);
+        double ratio = area > 0 ? childNode->getBoundingBox().surfaceArea() / area : 1.0;
+        cost += ratio * childNode->sahCost(params);
+    }
+    return cost;
+}
+
 /*
 * Check if a ray intersects with any descendant Objects of the BVHNode
 * 
@@ -211,22 +289,94 @@ bool BVHNode::box_compare(const std::shared_ptr<Object>& a, const std::shared_pt
 */
 int BVHNode::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
 {
-    if (!box.hit(ray, t_min, t_max)) {
+    TraversalRay traversalRay(ray, t_min, t_max);
+    double t_entry;
+    if (!box.hit(traversalRay, t_entry)) {
         return false;
     }
+    return intersectionHelper(ray, traversalRay, hitRecord);
+}
+
+/*
+* Helper method for intersection, called once the ray is known to hit the node's box.
+* Both child boxes are tested here so the nearer child is visited first, and the farther one is skipped if a closer hit was already found.
+* 
+* @param ray The Ray3D.
+* @param traversalRay The ray prepared for traversal. Its tMax is lowered to every closer hit found. Modified by function.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*/
+int BVHNode::intersectionHelper(const Ray3D& ray, TraversalRay& traversalRay, HitRecord& hitRecord) const
+{
+    if (leaf) {
+        bool hit_left = left->intersection(ray, traversalRay.tMin, traversalRay.tMax, hitRecord);
+        if (hit_left) {
+            traversalRay.tMax = hitRecord.intT;
+        }
+        bool hit_right = right != left && right->intersection(ray, traversalRay.tMin, traversalRay.tMax, hitRecord);
+        if (hit_right) {
+            traversalRay.tMax = hitRecord.intT;
+        }
+        return (hit_left || hit_right) ? 1 : 0;
+    }
 
-    bool hit_left = left->intersection(ray, t_min, t_max, hitRecord);
-    //double tm = t_max;
-    //if (hit_left) {
-    //    tm = hitRecord.intT;
-    //}
-    //bool hit_right = right->intersection(ray, t_min, tm, hitRecord);
-    bool hit_right = right->intersection(ray, t_min, hit_left ? hitRecord.intT : t_max, hitRecord);
+    const BVHNode* nearNode = static_cast<const BVHNode*>(left.get());
+    const BVHNode* farNode = static_cast<const BVHNode*>(right.get());
+    double t_near = 0;
+    double t_far = 0;
+    bool hit_near = nearNode->getBoundingBox().hit(traversalRay, t_near);
+    bool hit_far = farNode->getBoundingBox().hit(traversalRay, t_far);
+    if (!hit_near) {
+        std::swap(nearNode, farNode);
+        std::swap(t_near, t_far);
+        std::swap(hit_near, hit_far);
+    }
+    else if (hit_far && t_far < t_near) {
+        std::swap(nearNode, farNode);
+        std::swap(t_near, t_far);
+    }
 
-    if (hit_left || hit_right) {
-        return 1;
+    bool hit = false;
+    if (hit_near && nearNode->intersectionHelper(ray, traversalRay, hitRecord)) {
+        hit = true;
     }
-    return 0;
+    if (hit_far && t_far <= traversalRay.tMax && farNode->intersectionHelper(ray, traversalRay, hitRecord)) {
+        hit = true;
+    }
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any descendant Object of the BVHNode blocks a ray within [t_min, t_max], stopping at the first hit
+* 
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* 
+* @return True if any descendant Object is hit, false otherwise
+*/
+bool BVHNode::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    return occludedHelper(ray, TraversalRay(ray, t_min, t_max));
+}
+
+/*
+* Helper method for occluded, which prepares the ray for traversal only once
+* 
+* @param ray The Ray3D.
+* @param traversalRay The ray prepared for traversal
+* 
+* @return True if any descendant Object is hit, false otherwise
+*/
+bool BVHNode::occludedHelper(const Ray3D& ray, const TraversalRay& traversalRay) const
+{
+    double t_entry;
+    if (!box.hit(traversalRay, t_entry)) {
+        return false;
+    }
+    if (leaf) {
+        return left->occluded(ray, traversalRay.tMin, traversalRay.tMax) || (right != left && right->occluded(ray, traversalRay.tMin, traversalRay.tMax));
+    }
+    return static_cast<const BVHNode*>(left.get())->occludedHelper(ray, traversalRay) || static_cast<const BVHNode*>(right.get())->occludedHelper(ray, traversalRay);
 }
 
 /*
@@ -245,13 +395,21 @@ std::string BVHNode::toStringHelper(const BVHNode* curr, size_t level) const
         return printNode;
     }
 
-    BVHNode* left = std::dynamic_pointer_cast<BVHNode>(curr->getLeft()).get();
-    BVHNode* right = std::dynamic_pointer_cast<BVHNode>(curr->getRight()).get();
-
-    std::string leftString = toStringHelper(left, level + 1);
-    std::string rightString = toStringHelper(right, level + 1);
+    // Children of an interior node may still be primitives (or a LinearBVH), which are printed by their bounding box
+    std::string childStrings = "";
+    for (const std::shared_ptr<Object>& child : { curr->getLeft(), curr->getRight() }) {
+        const BVHNode* childNode = dynamic_cast<const BVHNode*>(child.get());
+        if (childNode) {
+            childStrings += toStringHelper(childNode, level + 1);
+            continue;
+        }
+        AABB3D childBox;
+        if (child && child->generateBoundingBox(childBox)) {
+            childStrings += "Level " + std::to_string(level + 1) + ": " + childBox.toString() + "\n";
+        }
+    }
 
-    return printNode + leftString + rightString;
+    return printNode + childStrings;
 }
 
 /*
@@ -5,6 +5,80 @@
 #include "SceneObject.h"
 #include "TriangleMesh.h"
 
+// LBVH and SBVH are only supported by LinearBVH; BVHNode builds them as MIDPOINT
+enum class BVHSplitMethod { MIDPOINT, SAH, LBVH, SBVH };
+
+constexpr size_t DEFAULT_SAH_BIN_COUNT = 16;
+constexpr double DEFAULT_SAH_TRAVERSAL_COST = 1.0;
+constexpr double DEFAULT_SAH_LEAF_COST = 0.5;
+constexpr double DEFAULT_SPHERE_INTERSECTION_COST = 1.0;
+constexpr double DEFAULT_TRIANGLE_INTERSECTION_COST = 1.5;
+constexpr double DEFAULT_SBVH_MEMORY_BUDGET = 1.3;     // SBVH references may grow to this multiple of the primitive count
+constexpr double DEFAULT_BVH_OPTIMIZATION_SECONDS = 2.0;   // time budget of the treelet optimization pass when it is enabled
+constexpr size_t DEFAULT_BVH_MAX_LEAF_PRIMITIVES = 4;
+constexpr size_t BVH_MAX_LEAF_PRIMITIVES_LIMIT = 255;      // CompressedBVH stores leaf primitive counts in 8 bits
+
+struct BVHBuildParameters {
+    BVHSplitMethod splitMethod;
+    size_t binCount;
+    double traversalCost;
+    double leafCost;
+    double sphereIntersectionCost;
+    double triangleIntersectionCost;
+    double spatialSplitBudget;
+    double optimizationSeconds;     // 0 disables the post-build optimization of LinearBVH
+    size_t maxLeafPrimitives;       // LinearBVH leaves hold up to this many primitives, where the SAH finds that cheaper than splitting
+
+    /*
+    * Default constructor for BVHBuildParameters (random-axis midpoint split, default SAH costs)
+    */
+    BVHBuildParameters() {
+        this->splitMethod = BVHSplitMethod::MIDPOINT;
+        this->binCount = DEFAULT_SAH_BIN_COUNT;
+        this->traversalCost = DEFAULT_SAH_TRAVERSAL_COST;
+        this->leafCost = DEFAULT_SAH_LEAF_COST;
+        this->sphereIntersectionCost = DEFAULT_SPHERE_INTERSECTION_COST;
+        this->triangleIntersectionCost = DEFAULT_TRIANGLE_INTERSECTION_COST;
+        this->spatialSplitBudget = DEFAULT_SBVH_MEMORY_BUDGET;
+        this->optimizationSeconds = 0;
+        this->maxLeafPrimitives = DEFAULT_BVH_MAX_LEAF_PRIMITIVES;
+    }
+
+    /*
+    * Constructor for BVHBuildParameters
+    *
+    * @param splitMethod How interior nodes are split
+    */
+    BVHBuildParameters(const BVHSplitMethod& splitMethod) : BVHBuildParameters() {
+        this->splitMethod = splitMethod;
+    }
+
+    /*
+    * @return maxLeafPrimitives, clamped to [1, BVH_MAX_LEAF_PRIMITIVES_LIMIT]
+    */
+    size_t leafPrimitiveLimit() const {
+        return std::min(std::max<size_t>(maxLeafPrimitives, 1), BVH_MAX_LEAF_PRIMITIVES_LIMIT);
+    }
+
+    /*
+    * @param object A primitive stored in the BVH
+    *
+    * @return The estimated cost of intersecting a ray with the primitive
+    */
+    double intersectionCost(const Object& object) const {
+        switch (object.getObjectType()) {
+        case ObjectType::Sphere:
+            return sphereIntersectionCost;
+        case ObjectType::Triangle:
+            return triangleIntersectionCost;
+        default:
+            return 1.0;
+        }
+    }
+};
+
+struct BVHBuildPrimitives;
+
 class BVHNode :
     public Object
 {
@@ -13,12 +87,18 @@ private:
     std::shared_ptr<Object> right;
     AABB3D box;
     bool leaf;
+
+    BVHNode(const std::vector<std::shared_ptr<Object>>& objects, BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, const BVHBuildParameters& params);
+    void buildRoot(const std::vector<std::shared_ptr<Object>>& objects, size_t start, size_t end, const BVHBuildParameters& params);
+    void build(const std::vector<std::shared_ptr<Object>>& objects, BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, const BVHBuildParameters& params);
+    int intersectionHelper(const Ray3D& ray, TraversalRay& traversalRay, HitRecord& hitRecord) const;
+    bool occludedHelper(const Ray3D& ray, const TraversalRay& traversalRay) const;
 public:
     BVHNode();
-    BVHNode(const std::shared_ptr<TriangleMesh>& triangleMesh);
-    BVHNode(const std::vector<std::shared_ptr<SceneObject>>& list);
-    BVHNode(const std::vector<std::shared_ptr<Object>> list);
-    BVHNode(const std::vector<std::shared_ptr<Object>>& src_objects, size_t start, size_t end);
+    BVHNode(const std::shared_ptr<TriangleMesh>& triangleMesh, const BVHBuildParameters& params = BVHBuildParameters());
+    BVHNode(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params = BVHBuildParameters());
+    BVHNode(const std::vector<std::shared_ptr<Object>> list, const BVHBuildParameters& params = BVHBuildParameters());
+    BVHNode(const std::vector<std::shared_ptr<Object>>& src_objects, size_t start, size_t end, const BVHBuildParameters& params = BVHBuildParameters());
 
     const std::shared_ptr<Object>& getLeft() const;
     const std::shared_ptr<Object>& getRight() const;
@@ -29,7 +109,10 @@ public:
     AABB3D surroundingBox(const AABB3D& box0, const AABB3D& box1) const;
     bool box_compare(const std::shared_ptr<Object>& a, const std::shared_ptr<Object>& b, int axis) const;
 
+    double sahCost(const BVHBuildParameters& params) const;
+
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
 
     std::string toStringHelper(const BVHNode* curr, size_t level) const;
     std::string toString() const;
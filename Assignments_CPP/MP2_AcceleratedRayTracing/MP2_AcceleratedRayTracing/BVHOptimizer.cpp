@@ -0,0 +1,299 @@
+#include "BVHOptimizer.h"
+
+/*
+* Constructor for BVHOptimizer. Copies the BVH's nodes into a linked form that can be restructured in place.
+*
+* @param bvh The built BVH
+* @param params The SAH costs to optimize for
+* @param pool The thread pool to optimize on
+*/
+BVHOptimizer::BVHOptimizer(const LinearBVH& bvh, const BVHBuildParameters& params, ThreadPool& pool) : params(params), pool(pool), outOfTime(false)
+{
+    const std::vector<LinearBVHNode>& linearNodes = bvh.getNodes();
+    const std::vector<uint32_t>& primitiveIndices = bvh.getPrimitiveIndices();
+    const std::vector<std::shared_ptr<Object>>& primitives = bvh.getPrimitives();
+    nodes.resize(linearNodes.size());
+
+    // Node i keeps index i, so the children of an interior node are i + 1 and its offset
+    for (size_t i = linearNodes.size(); i-- > 0; ) {
+        const LinearBVHNode& linearNode = linearNodes[i];
+        BVHOptimizerNode& node = nodes[i];
+        node.box = linearNode.getBounds();
+        node.primitiveCount = linearNode.primitiveCount;
+        if (node.primitiveCount > 0) {
+            node.offset = linearNode.offset;
+            node.left = node.right = 0;
+            double leafCost = params.leafCost;
+            for (uint32_t p = linearNode.offset; p < linearNode.offset + linearNode.primitiveCount; p++) {
+                leafCost += params.intersectionCost(*primitives[primitiveIndices[p]]);
+            }
+            node.cost = node.box.surfaceArea() * leafCost;
+        }
+        else {
+            node.offset = 0;
+            node.left = (uint32_t)i + 1;
+            node.right = linearNode.offset;
+            node.cost = node.box.surfaceArea() * params.traversalCost + nodes[node.left].cost + nodes[node.right].cost;
+        }
+    }
+}
+
+/*
+* Restructures the tree in passes until a pass stops paying off, BVH_OPTIMIZER_MAX_PASSES is reached or the time budget runs out
+*
+* @param timeBudgetSeconds The wall-clock time the optimization may take
+*/
+void BVHOptimizer::optimize(double timeBudgetSeconds)
+{
+    if (nodes.empty()) {
+        return;
+    }
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeBudgetSeconds));
+    outOfTime = false;
+
+    for (size_t pass = 0; pass < BVH_OPTIMIZER_MAX_PASSES && !outOfTime; pass++) {
+        double before = nodes[0].cost;
+        optimizeSubtree(0, 0);
+        if (nodes[0].cost > before * (1 - BVH_OPTIMIZER_MIN_IMPROVEMENT)) {
+            break;
+        }
+    }
+}
+
+/*
+* @return The SAH cost of the tree, as computed by LinearBVH::sahCost
+*/
+double BVHOptimizer::getSAHCost() const
+{
+    if (nodes.empty()) {
+        return 0;
+    }
+    double rootArea = nodes[0].box.surfaceArea();
+    return rootArea > 0 ? nodes[0].cost / rootArea : 0;
+}
+
+/*
+* Optimizes a subtree bottom-up: both children first, then the treelet rooted at the node itself.
+* Treelets never reach outside their root's subtree, so sibling subtrees near the root are optimized concurrently.
+*
+* @param index The subtree's root node
+* @param depth The depth of the subtree's root node
+*/
+void BVHOptimizer::optimizeSubtree(uint32_t index, size_t depth)
+{
+    BVHOptimizerNode& node = nodes[index];
+    if (node.primitiveCount > 0) {
+        return;
+    }
+
+    if (depth < BVH_OPTIMIZER_PARALLEL_DEPTH) {
+        std::future<void> leftTask = pool.submit([this, &node, depth] { optimizeSubtree(node.left, depth + 1); });
+        optimizeSubtree(node.right, depth + 1);
+        pool.wait(leftTask);
+    }
+    else {
+        optimizeSubtree(node.left, depth + 1);
+        optimizeSubtree(node.right, depth + 1);
+    }
+
+    updateNode(index);
+    if (outOfTime) {
+        return;
+    }
+    if (std::chrono::steady_clock::now() > deadline) {
+        outOfTime = true;
+        return;
+    }
+    restructureTreelet(index);
+}
+
+/*
+* Recomputes an interior node's box and cost from its children
+*
+* @param index The node
+*/
+void BVHOptimizer::updateNode(uint32_t index)
+{
+    BVHOptimizerNode& node = nodes[index];
+    node.box = nodes[node.left].box;
+    node.box.expand(nodes[node.right].box);
+    node.cost = node.box.surfaceArea() * params.traversalCost + nodes[node.left].cost + nodes[node.right].cost;
+}
+
+/*
+* Grows the treelet rooted at a node by repeatedly opening its largest interior leaf, then rebuilds the treelet's internal
+* nodes in the cheapest topology over its leaves if that beats the current one
+*
+* @param root The treelet's root node
+*
+* @return True if the treelet was restructured
+*/
+bool BVHOptimizer::restructureTreelet(uint32_t root)
+{
+    uint32_t leaves[BVH_TREELET_LEAVES];
+    uint32_t internals[BVH_TREELET_LEAVES - 1];
+    size_t leafCount = 2;
+    size_t internalCount = 1;
+    leaves[0] = nodes[root].left;
+    leaves[1] = nodes[root].right;
+    internals[0] = root;
+
+    while (leafCount < BVH_TREELET_LEAVES) {
+        int largest = -1;
+        double largestArea = -1;
+        for (size_t i = 0; i < leafCount; i++) {
+            const BVHOptimizerNode& leaf = nodes[leaves[i]];
+            if (leaf.primitiveCount == 0 && leaf.box.surfaceArea() > largestArea) {
+                largest = (int)i;
+                largestArea = leaf.box.surfaceArea();
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        uint32_t opened = leaves[largest];
+        internals[internalCount++] = opened;
+        leaves[largest] = nodes[opened].left;
+        leaves[leafCount++] = nodes[opened].right;
+    }
+    if (leafCount < 3) {
+        return false;
+    }
+
+    // Cheapest cost of every subset of the leaves, built up from smaller subsets.
+    // Only partitions whose first half holds the subset's lowest leaf are tried, so each split is seen once.
+    const uint32_t subsetCount = 1u << leafCount;
+    const uint32_t fullSet = subsetCount - 1;
+    AABB3D boxes[1u << BVH_TREELET_LEAVES];
+    double costs[1u << BVH_TREELET_LEAVES];
+    uint32_t partitions[1u << BVH_TREELET_LEAVES];
+    for (uint32_t subset = 1; subset < subsetCount; subset++) {
+        uint32_t lowest = subset & (0u - subset);
+        int lowestIndex = 0;
+        while ((1u << lowestIndex) != lowest) {
+            lowestIndex++;
+        }
+        if (subset == lowest) {
+            boxes[subset] = nodes[leaves[lowestIndex]].box;
+            costs[subset] = nodes[leaves[lowestIndex]].cost;
+            partitions[subset] = 0;
+            continue;
+        }
+        boxes[subset] = boxes[subset ^ lowest];
+        boxes[subset].expand(boxes[lowest]);
+
+        double bestCost = std::numeric_limits<double>::infinity();
+        uint32_t bestPartition = lowest;
+        for (uint32_t part = (subset - 1) & subset; part > 0; part = (part - 1) & subset) {
+            if (!(part & lowest)) {
+                continue;
+            }
+            double cost = costs[part] + costs[subset ^ part];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestPartition = part;
+            }
+        }
+        costs[subset] = boxes[subset].surfaceArea() * params.traversalCost + bestCost;
+        partitions[subset] = bestPartition;
+    }
+
+    if (!(costs[fullSet] < nodes[root].cost * (1 - 1e-9))) {
+        return false;
+    }
+
+    // Reuse the treelet's internal nodes for the new topology, the root keeps its index
+    struct Pending {
+        uint32_t subset;
+        uint32_t node;
+    };
+    Pending pending[BVH_TREELET_LEAVES - 1];
+    size_t pendingCount = 0;
+    size_t nextInternal = 1;
+    pending[pendingCount++] = { fullSet, root };
+    while (pendingCount > 0) {
+        Pending current = pending[--pendingCount];
+        uint32_t children[2];
+        uint32_t halves[2]{ partitions[current.subset], current.subset ^ partitions[current.subset] };
+        for (int c = 0; c < 2; c++) {
+            if ((halves[c] & (halves[c] - 1)) == 0) {
+                int leafIndex = 0;
+                while ((1u << leafIndex) != halves[c]) {
+                    leafIndex++;
+                }
+                children[c] = leaves[leafIndex];
+            }
+            else {
+                children[c] = internals[nextInternal++];
+                pending[pendingCount++] = { halves[c], children[c] };
+            }
+        }
+        BVHOptimizerNode& node = nodes[current.node];
+        node.left = children[0];
+        node.right = children[1];
+        node.primitiveCount = 0;
+        node.box = boxes[current.subset];
+        node.cost = costs[current.subset];
+    }
+    return true;
+}
+
+/*
+* Writes the tree back out as a depth-first node array
+*
+* @param output The depth-first node array. Modified by function.
+*
+* @return The depth of the tree (a single leaf has depth 1)
+*/
+size_t BVHOptimizer::flatten(std::vector<LinearBVHNode>& output) const
+{
+    output.clear();
+    if (nodes.empty()) {
+        return 0;
+    }
+    output.reserve(nodes.size());
+    size_t depth = 0;
+    flattenSubtree(0, 1, depth, output);
+    return depth;
+}
+
+/*
+* Appends a subtree depth-first, left child first
+*
+* @param index The subtree's root node
+* @param depth The depth of the subtree's root node
+* @param maxDepth The deepest depth reached so far. Modified by function.
+* @param output The node array to append to. Modified by function.
+*
+* @return The index of the subtree's root in the output
+*/
+uint32_t BVHOptimizer::flattenSubtree(uint32_t index, size_t depth, size_t& maxDepth, std::vector<LinearBVHNode>& output) const
+{
+    maxDepth = std::max(maxDepth, depth);
+    const BVHOptimizerNode& node = nodes[index];
+    uint32_t outputIndex = (uint32_t)output.size();
+    output.push_back(LinearBVHNode());
+    output[outputIndex].setBounds(node.box);
+    output[outputIndex].pad = 0;
+    output[outputIndex].primitiveCount = node.primitiveCount;
+    if (node.primitiveCount > 0) {
+        output[outputIndex].offset = node.offset;
+        output[outputIndex].axis = 0;
+        return outputIndex;
+    }
+
+    // Record the axis that best separates the children, like the builders' split axis
+    Vec3D separation = nodes[node.right].box.centroid() - nodes[node.left].box.centroid();
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (std::fabs(separation[a]) > std::fabs(separation[axis])) {
+            axis = a;
+        }
+    }
+    output[outputIndex].axis = (uint8_t)axis;
+
+    flattenSubtree(node.left, depth + 1, maxDepth, output);
+    uint32_t rightIndex = flattenSubtree(node.right, depth + 1, maxDepth, output);
+    output[outputIndex].offset = rightIndex;
+    return outputIndex;
+}
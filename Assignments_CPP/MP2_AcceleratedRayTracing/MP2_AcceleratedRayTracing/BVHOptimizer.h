@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "LinearBVH.h"
+#include "ThreadPool.h"
+
+constexpr size_t BVH_TREELET_LEAVES = 7;            // treelets are restructured optimally over this many leaves (3^7 partitions)
+constexpr size_t BVH_OPTIMIZER_MAX_PASSES = 3;
+constexpr double BVH_OPTIMIZER_MIN_IMPROVEMENT = 0.001;    // stop once a pass lowers the SAH cost by less than this fraction
+constexpr size_t BVH_OPTIMIZER_PARALLEL_DEPTH = 6;  // subtrees rooted above this depth are optimized concurrently
+
+struct BVHOptimizerNode {
+    AABB3D box;
+    double cost;                // SAH cost of the subtree times the node's surface area
+    uint32_t left;
+    uint32_t right;
+    uint32_t offset;            // leaf: index of the first primitive index
+    uint16_t primitiveCount;    // 0 for interior nodes
+};
+
+// Lowers the SAH cost of a built LinearBVH by treelet restructuring (Karras and Aila 2013). Walking the tree bottom-up,
+// every node grows a treelet of up to BVH_TREELET_LEAVES subtrees and replaces its internal topology with the
+// cheapest one found by dynamic programming over all subsets. Leaves and the primitive order are never changed.
+class BVHOptimizer
+{
+private:
+    std::vector<BVHOptimizerNode> nodes;
+    const BVHBuildParameters& params;
+    ThreadPool& pool;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> outOfTime;
+
+    void optimizeSubtree(uint32_t index, size_t depth);
+    bool restructureTreelet(uint32_t root);
+    void updateNode(uint32_t index);
+    uint32_t flattenSubtree(uint32_t index, size_t depth, size_t& maxDepth, std::vector<LinearBVHNode>& output) const;
+
+public:
+    BVHOptimizer(const LinearBVH& bvh, const BVHBuildParameters& params, ThreadPool& pool = ThreadPool::global());
+
+    void optimize(double timeBudgetSeconds);
+    double getSAHCost() const;
+    size_t flatten(std::vector<LinearBVHNode>& output) const;
+};
@@ -0,0 +1,179 @@
+#include "BVHStatistics.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+/*
+* Default constructor for BVHStatistics (an empty tree)
+*/
+BVHStatistics::BVHStatistics() : splitMethod("NONE"), buildSeconds(0), nodeCount(0), interiorCount(0), leafCount(0), primitiveCount(0), referenceCount(0),
+    maxDepth(0), sahCost(0), meanSiblingOverlap(0), maxSiblingOverlap(0), nodeBytes(0), indexBytes(0), primitiveBytes(0), trianglePackBytes(0), spherePackBytes(0), wideNodeCount(0), wideNodeBytes(0), memoryBytes(0) {}
+
+/*
+* Gathers the statistics of a LinearBVH in one depth-first pass over its nodes
+*
+* @param bvh The BVH
+* @param params The costs the SAH cost is computed with
+*/
+BVHStatistics::BVHStatistics(const LinearBVH& bvh, const BVHBuildParameters& params) : BVHStatistics()
+{
+    const std::vector<LinearBVHNode>& nodes = bvh.getNodes();
+    splitMethod = splitMethodName(bvh.getBuildParameters().splitMethod);
+    nodeCount = nodes.size();
+    primitiveCount = bvh.getPrimitives().size();
+    referenceCount = bvh.getPrimitiveIndices().size();
+    nodeBytes = nodeCount * sizeof(LinearBVHNode);
+    indexBytes = referenceCount * sizeof(uint32_t);
+    primitiveBytes = primitiveCount * sizeof(std::shared_ptr<Object>);
+    trianglePackBytes = bvh.getTrianglePacks().memoryBytes();
+    spherePackBytes = bvh.getSpherePacks().memoryBytes();
+    memoryBytes = nodeBytes + indexBytes + primitiveBytes + trianglePackBytes + spherePackBytes;
+    if (nodes.empty()) {
+        return;
+    }
+    sahCost = bvh.sahCost(params);
+
+    double overlapSum = 0;
+    std::vector<std::pair<uint32_t, size_t>> stack{ { 0, 0 } };
+    while (!stack.empty()) {
+        uint32_t index = stack.back().first;
+        size_t depth = stack.back().second;
+        stack.pop_back();
+
+        const LinearBVHNode& node = nodes[index];
+        if (depth >= depthHistogram.size()) {
+            depthHistogram.resize(depth + 1, 0);
+        }
+        depthHistogram[depth]++;
+        maxDepth = std::max(maxDepth, depth);
+
+        if (node.primitiveCount > 0) {
+            leafCount++;
+            if (node.primitiveCount >= leafSizeHistogram.size()) {
+                leafSizeHistogram.resize(node.primitiveCount + 1, 0);
+            }
+            leafSizeHistogram[node.primitiveCount]++;
+            continue;
+        }
+
+        interiorCount++;
+        const LinearBVHNode& left = nodes[index + 1];
+        const LinearBVHNode& right = nodes[node.offset];
+        double nodeArea = node.getBounds().surfaceArea();
+        double overlap = 0;
+        if (nodeArea > 0) {
+            AABB3D intersection(Point3D(std::max(left.boundsMin[0], right.boundsMin[0]), std::max(left.boundsMin[1], right.boundsMin[1]), std::max(left.boundsMin[2], right.boundsMin[2])),
+                Point3D(std::min(left.boundsMax[0], right.boundsMax[0]), std::min(left.boundsMax[1], right.boundsMax[1]), std::min(left.boundsMax[2], right.boundsMax[2])));
+            bool disjoint = false;
+            for (int a = 0; a < 3; a++) {
+                disjoint |= intersection.min()[a] > intersection.max()[a];
+            }
+            overlap = disjoint ? 0 : intersection.surfaceArea() / nodeArea;
+        }
+        overlapSum += overlap;
+        maxSiblingOverlap = std::max(maxSiblingOverlap, overlap);
+
+        stack.push_back({ node.offset, depth + 1 });
+        stack.push_back({ index + 1, depth + 1 });
+    }
+    meanSiblingOverlap = interiorCount > 0 ? overlapSum / interiorCount : 0;
+}
+
+/*
+* Adds the nodes of a CompressedBVH collapsed from the tree to the memory footprint
+*
+* @param compressedBVH The compressed BVH
+*/
+void BVHStatistics::addWideBVH(const CompressedBVH& compressedBVH)
+{
+    wideNodeCount = compressedBVH.getNodes().size();
+    wideNodeBytes = wideNodeCount * sizeof(CompressedBVHNode);
+    memoryBytes = nodeBytes + indexBytes + primitiveBytes + trianglePackBytes + spherePackBytes + wideNodeBytes;
+}
+
+/*
+* @return The statistics as a single JSON object
+*/
+std::string BVHStatistics::toJSON() const
+{
+    auto writeArray = [](std::ostringstream& out, const std::vector<size_t>& values) {
+        out << "[";
+        for (size_t i = 0; i < values.size(); i++) {
+            out << (i > 0 ? ", " : "") << values[i];
+        }
+        out << "]";
+    };
+
+    std::ostringstream out;
+    out << std::setprecision(8);
+    out << "{\n";
+    out << "  \"splitMethod\": \"" << splitMethod << "\",\n";
+    out << "  \"buildSeconds\": " << buildSeconds << ",\n";
+    out << "  \"nodeCount\": " << nodeCount << ",\n";
+    out << "  \"interiorCount\": " << interiorCount << ",\n";
+    out << "  \"leafCount\": " << leafCount << ",\n";
+    out << "  \"primitiveCount\": " << primitiveCount << ",\n";
+    out << "  \"referenceCount\": " << referenceCount << ",\n";
+    out << "  \"maxDepth\": " << maxDepth << ",\n";
+    out << "  \"depthHistogram\": ";
+    writeArray(out, depthHistogram);
+    out << ",\n";
+    out << "  \"leafSizeHistogram\": ";
+    writeArray(out, leafSizeHistogram);
+    out << ",\n";
+    out << "  \"sahCost\": " << sahCost << ",\n";
+    out << "  \"meanSiblingOverlap\": " << meanSiblingOverlap << ",\n";
+    out << "  \"maxSiblingOverlap\": " << maxSiblingOverlap << ",\n";
+    out << "  \"memory\": {\n";
+    out << "    \"nodeBytes\": " << nodeBytes << ",\n";
+    out << "    \"indexBytes\": " << indexBytes << ",\n";
+    out << "    \"primitiveBytes\": " << primitiveBytes << ",\n";
+    out << "    \"trianglePackBytes\": " << trianglePackBytes << ",\n";
+    out << "    \"spherePackBytes\": " << spherePackBytes << ",\n";
+    out << "    \"wideNodeCount\": " << wideNodeCount << ",\n";
+    out << "    \"wideNodeBytes\": " << wideNodeBytes << ",\n";
+    out << "    \"totalBytes\": " << memoryBytes << "\n";
+    out << "  }\n";
+    out << "}";
+    return out.str();
+}
+
+/*
+* Writes the statistics to a JSON file, replacing it if it exists
+*
+* @param filepath The path of the file
+*
+* @return True if the file was written, false otherwise
+*/
+bool BVHStatistics::writeJSON(const std::string& filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file) {
+        std::cerr << "Could not write BVH statistics to " << filepath << ".\n";
+        return false;
+    }
+    file << toJSON() << "\n";
+    return (bool)file;
+}
+
+/*
+* @param splitMethod A split method
+*
+* @return The split method's name
+*/
+std::string BVHStatistics::splitMethodName(const BVHSplitMethod& splitMethod)
+{
+    switch (splitMethod) {
+    case BVHSplitMethod::MIDPOINT:
+        return "MIDPOINT";
+    case BVHSplitMethod::SAH:
+        return "SAH";
+    case BVHSplitMethod::LBVH:
+        return "LBVH";
+    case BVHSplitMethod::SBVH:
+        return "SBVH";
+    default:
+        return "UNKNOWN";
+    }
+}
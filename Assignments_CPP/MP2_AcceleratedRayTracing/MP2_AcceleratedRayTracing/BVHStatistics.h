@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include "LinearBVH.h"
+#include "WideBVH.h"
+#include "CompressedBVH.h"
+
+// Summary of a built LinearBVH's shape and quality, cheap enough (one pass over the nodes) to gather after every build.
+// Emitted as JSON so tree-quality regressions can be diffed between builds instead of showing up as slow renders.
+struct BVHStatistics {
+    std::string splitMethod;
+    double buildSeconds;
+
+    size_t nodeCount;
+    size_t interiorCount;
+    size_t leafCount;
+    size_t primitiveCount;
+    size_t referenceCount;              // leaf references, more than primitiveCount when spatial splits duplicated primitives
+    size_t maxDepth;
+    std::vector<size_t> depthHistogram;     // number of nodes at each depth (root is depth 0)
+    std::vector<size_t> leafSizeHistogram;  // number of leaves holding each primitive count
+
+    double sahCost;
+    double meanSiblingOverlap;          // surface area of the intersection of two siblings over their parent's, averaged over interior nodes
+    double maxSiblingOverlap;
+
+    size_t nodeBytes;
+    size_t indexBytes;
+    size_t primitiveBytes;              // the primitive pointer array, not the primitives themselves
+    size_t trianglePackBytes;
+    size_t spherePackBytes;
+    size_t wideNodeCount;               // 0 unless a wide or compressed BVH was collapsed from the tree
+    size_t wideNodeBytes;
+    size_t memoryBytes;
+
+    BVHStatistics();
+    BVHStatistics(const LinearBVH& bvh, const BVHBuildParameters& params);
+
+    template <size_t Width>
+    void addWideBVH(const WideBVH<Width>& wideBVH) {
+        wideNodeCount = wideBVH.getNodes().size();
+        wideNodeBytes = wideNodeCount * sizeof(WideBVHNode<Width>);
+        memoryBytes = nodeBytes + indexBytes + primitiveBytes + trianglePackBytes + spherePackBytes + wideNodeBytes;
+    }
+
+    void addWideBVH(const CompressedBVH& compressedBVH);
+
+    std::string toJSON() const;
+    bool writeJSON(const std::string& filepath) const;
+
+    static std::string splitMethodName(const BVHSplitMethod& splitMethod);
+};
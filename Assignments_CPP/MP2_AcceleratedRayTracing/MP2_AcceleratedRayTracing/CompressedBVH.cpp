@@ -0,0 +1,515 @@
+#include "CompressedBVH.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+* Default constructor for CompressedBVH (empty tree)
+*/
+CompressedBVH::CompressedBVH() : Object(ObjectType::CompressedBVH) {}
+
+/*
+* Constructor for CompressedBVH
+*
+* @param binaryBVH The binary BVH to collapse and quantize
+*/
+CompressedBVH::CompressedBVH(const LinearBVH& binaryBVH) : Object(ObjectType::CompressedBVH), primitives(binaryBVH.getPrimitives())
+{
+    const std::vector<LinearBVHNode>& binaryNodes = binaryBVH.getNodes();
+    if (binaryNodes.empty()) {
+        return;
+    }
+
+    primitiveIndices.reserve(binaryBVH.getPrimitiveIndices().size());
+    nodes.reserve(binaryNodes.size() / (COMPRESSED_BVH_WIDTH - 1) + 1);
+    nodes.push_back(CompressedBVHNode());
+    collapse(binaryNodes, binaryBVH.getPrimitiveIndices(), 0, 0);
+    nodes.shrink_to_fit();
+
+    trianglePacks.build(primitives, primitiveIndices);
+    spherePacks.build(primitives, primitiveIndices);
+}
+
+/*
+* @param exponent A quantization exponent
+*
+* @return 2^exponent as a float, built directly from its bits
+*/
+float CompressedBVH::exponentScale(int exponent)
+{
+    uint32_t bits = (uint32_t)(exponent + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(float));
+    return scale;
+}
+
+/*
+* Decodes one quantized bound. The product is exact, so the float sum is the only rounding, with or without FMA.
+*
+* @param origin The node's origin along the axis
+* @param exponent The node's quantization exponent along the axis
+* @param quantized The quantized bound
+*
+* @return The decoded bound
+*/
+float CompressedBVH::decode(float origin, int exponent, uint8_t quantized)
+{
+    return origin + (float)quantized * exponentScale(exponent);
+}
+
+/*
+* Fills the compressed node at nodes[nodeIndex] from an interior binary node, then recursively its interior children
+*
+* @param binaryNodes The nodes of the binary BVH
+* @param binaryIndices The primitive indices referenced by the binary BVH's leaves
+* @param binaryIndex The binary node to collapse
+* @param nodeIndex The already allocated compressed node to fill
+*/
+void CompressedBVH::collapse(const std::vector<LinearBVHNode>& binaryNodes, const std::vector<uint32_t>& binaryIndices, uint32_t binaryIndex, uint32_t nodeIndex)
+{
+    auto area = [&](uint32_t i) -> double {
+        const LinearBVHNode& n = binaryNodes[i];
+        double dx = n.boundsMax[0] - n.boundsMin[0];
+        double dy = n.boundsMax[1] - n.boundsMin[1];
+        double dz = n.boundsMax[2] - n.boundsMin[2];
+        return dx * dy + dy * dz + dz * dx;
+    };
+
+    // Open the interior child with the largest surface area until the node is full, as WideBVH does.
+    // A binary leaf at the root becomes the only child of the root.
+    uint32_t children[COMPRESSED_BVH_WIDTH];
+    size_t childCount = 1;
+    children[0] = binaryIndex;
+    if (binaryNodes[binaryIndex].primitiveCount == 0) {
+        children[0] = binaryIndex + 1;
+        children[1] = binaryNodes[binaryIndex].offset;
+        childCount = 2;
+    }
+    while (childCount < COMPRESSED_BVH_WIDTH) {
+        int largest = -1;
+        for (size_t c = 0; c < childCount; c++) {
+            if (binaryNodes[children[c]].primitiveCount == 0 && (largest < 0 || area(children[c]) > area(children[largest]))) {
+                largest = (int)c;
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        uint32_t opened = children[largest];
+        children[largest] = opened + 1;
+        children[childCount++] = binaryNodes[opened].offset;
+    }
+
+    // Interior children are allocated side by side, and the leaves' references are appended in lane order
+    uint32_t childBase = (uint32_t)nodes.size();
+    uint32_t primitiveBase = (uint32_t)primitiveIndices.size();
+    size_t interiorCount = 0;
+    for (size_t lane = 0; lane < childCount; lane++) {
+        const LinearBVHNode& child = binaryNodes[children[lane]];
+        if (child.primitiveCount == 0) {
+            interiorCount++;
+            continue;
+        }
+        primitiveIndices.insert(primitiveIndices.end(), binaryIndices.begin() + child.offset, binaryIndices.begin() + child.offset + child.primitiveCount);
+    }
+    nodes.resize(nodes.size() + interiorCount);
+
+    CompressedBVHNode& node = nodes[nodeIndex];
+    node.childCount = (uint8_t)childCount;
+    node.childBase = childBase;
+    node.primitiveBase = primitiveBase;
+    for (size_t lane = 0; lane < COMPRESSED_BVH_WIDTH; lane++) {
+        node.primitiveCounts[lane] = lane < childCount ? (uint8_t)binaryNodes[children[lane]].primitiveCount : 0;
+    }
+    quantizeChildren(node, binaryNodes, binaryNodes[binaryIndex], children, childCount);
+
+    // Recursing may grow the node array, so node is not touched past this point
+    uint32_t nextChild = childBase;
+    for (size_t lane = 0; lane < childCount; lane++) {
+        if (binaryNodes[children[lane]].primitiveCount == 0) {
+            collapse(binaryNodes, binaryIndices, children[lane], nextChild++);
+        }
+    }
+}
+
+/*
+* Quantizes the child boxes of a node against the parent's box, rounding every bound outward
+*
+* @param node The compressed node. Modified by function.
+* @param binaryNodes The nodes of the binary BVH
+* @param parent The binary node whose box the children are quantized against
+* @param children The binary nodes of the children, in lane order
+* @param childCount The number of children
+*/
+void CompressedBVH::quantizeChildren(CompressedBVHNode& node, const std::vector<LinearBVHNode>& binaryNodes, const LinearBVHNode& parent, const uint32_t* children, size_t childCount)
+{
+    for (int a = 0; a < 3; a++) {
+        float lo = parent.boundsMin[a];
+        float hi = parent.boundsMax[a];
+
+        // The smallest step for which 255 steps from the origin still reach the far side of the box
+        double extent = (double)hi - (double)lo;
+        int exponent = extent > 0 ? (int)std::ceil(std::log2(extent / 255.0)) : COMPRESSED_BVH_MIN_EXPONENT;
+        exponent = std::max(exponent, COMPRESSED_BVH_MIN_EXPONENT);
+        while (decode(lo, exponent, 255) < hi) {
+            exponent++;
+        }
+        node.origin[a] = lo;
+        node.exponent[a] = (int8_t)exponent;
+
+        double step = std::ldexp(1.0, exponent);
+        for (size_t lane = 0; lane < COMPRESSED_BVH_WIDTH; lane++) {
+            if (lane >= childCount) {
+                node.quantizedMin[a][lane] = 255;
+                node.quantizedMax[a][lane] = 0;
+                continue;
+            }
+            const LinearBVHNode& child = binaryNodes[children[lane]];
+
+            // Round outward, then step further out wherever the decoded float still cuts into the child's box
+            int qMin = (int)std::floor(((double)child.boundsMin[a] - lo) / step);
+            int qMax = (int)std::ceil(((double)child.boundsMax[a] - lo) / step);
+            qMin = std::min(std::max(qMin, 0), 255);
+            qMax = std::min(std::max(qMax, 0), 255);
+            while (qMin > 0 && decode(lo, exponent, (uint8_t)qMin) > child.boundsMin[a]) {
+                qMin--;
+            }
+            while (qMax < 255 && decode(lo, exponent, (uint8_t)qMax) < child.boundsMax[a]) {
+                qMax++;
+            }
+            node.quantizedMin[a][lane] = (uint8_t)qMin;
+            node.quantizedMax[a][lane] = (uint8_t)qMax;
+        }
+    }
+}
+
+/*
+* Decodes a node's child boxes and slab tests a ray against all of them
+*
+* @param node The node
+* @param origin The origin of the ray
+* @param invDir The reciprocal of the ray's direction
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param t_entry The t at which the ray enters each child box (only meaningful for hit lanes). Modified by function.
+*
+* @return A bit mask with bit i set if the ray enters child i within [t_min, t_max]
+*/
+unsigned CompressedBVH::hitChildren(const CompressedBVHNode& node, const float(&origin)[3], const float(&invDir)[3], float t_min, float t_max, float(&t_entry)[COMPRESSED_BVH_WIDTH]) const
+{
+    unsigned mask = 0;
+
+#if defined(__AVX2__)
+    __m256 tNear = _mm256_set1_ps(t_min);
+    __m256 tFar = _mm256_set1_ps(t_max);
+    for (int a = 0; a < 3; a++) {
+        __m256 nodeOrigin = _mm256_set1_ps(node.origin[a]);
+        __m256 scale = _mm256_set1_ps(exponentScale(node.exponent[a]));
+        __m256 qMin = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)node.quantizedMin[a])));
+        __m256 qMax = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)node.quantizedMax[a])));
+        __m256 boundsMin = _mm256_add_ps(nodeOrigin, _mm256_mul_ps(qMin, scale));
+        __m256 boundsMax = _mm256_add_ps(nodeOrigin, _mm256_mul_ps(qMax, scale));
+
+        __m256 o = _mm256_set1_ps(origin[a]);
+        __m256 inv = _mm256_set1_ps(invDir[a]);
+        __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(boundsMin, o), inv);
+        __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(boundsMax, o), inv);
+        tNear = _mm256_max_ps(tNear, _mm256_min_ps(t0, t1));
+        tFar = _mm256_min_ps(tFar, _mm256_mul_ps(_mm256_max_ps(t0, t1), _mm256_set1_ps(WIDE_BVH_SLAB_PADDING)));
+    }
+    _mm256_storeu_ps(t_entry, tNear);
+    mask = (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+#else
+    float scale[3];
+    for (int a = 0; a < 3; a++) {
+        scale[a] = exponentScale(node.exponent[a]);
+    }
+    for (size_t lane = 0; lane < node.childCount; lane++) {
+        float tNear = t_min;
+        float tFar = t_max;
+        for (int a = 0; a < 3; a++) {
+            float boundsMin = node.origin[a] + (float)node.quantizedMin[a][lane] * scale[a];
+            float boundsMax = node.origin[a] + (float)node.quantizedMax[a][lane] * scale[a];
+            float t0 = (boundsMin - origin[a]) * invDir[a];
+            float t1 = (boundsMax - origin[a]) * invDir[a];
+            tNear = std::max(tNear, std::min(t0, t1));
+            tFar = std::min(tFar, std::max(t0, t1) * WIDE_BVH_SLAB_PADDING);
+        }
+        t_entry[lane] = tNear;
+        if (tNear <= tFar) {
+            mask |= 1u << lane;
+        }
+    }
+#endif
+
+    return mask & ((1u << node.childCount) - 1);
+}
+
+/*
+* @return The compressed nodes; the root is first and every node's interior children are contiguous
+*/
+const std::vector<CompressedBVHNode>& CompressedBVH::getNodes() const
+{
+    return nodes;
+}
+
+/*
+* @return The bytes held by the nodes and the primitive index array
+*/
+size_t CompressedBVH::memoryBytes() const
+{
+    return nodes.size() * sizeof(CompressedBVHNode) + primitiveIndices.size() * sizeof(uint32_t);
+}
+
+/*
+* Retrieve the bounding box of the whole BVH (the decoded root children, so slightly larger than the exact box)
+*
+* @param output_box The variable to hold the bounding box. Modified by function.
+*
+* @return False if the BVH is empty, true otherwise
+*/
+bool CompressedBVH::generateBoundingBox(AABB3D& output_box) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+    const CompressedBVHNode& root = nodes[0];
+    output_box = EMPTY_BOUNDING_BOX;
+    for (size_t lane = 0; lane < root.childCount; lane++) {
+        Point3D boxMin;
+        Point3D boxMax;
+        for (int a = 0; a < 3; a++) {
+            boxMin[a] = decode(root.origin[a], root.exponent[a], root.quantizedMin[a][lane]);
+            boxMax[a] = decode(root.origin[a], root.exponent[a], root.quantizedMax[a][lane]);
+        }
+        output_box.expand(AABB3D(boxMin, boxMax));
+    }
+    return true;
+}
+
+/*
+* Find the closest primitive a ray intersects. Traversal order is the same as WideBVH's: hit children by entry distance,
+* leaves first, interior children pushed far-to-near with their entry distance.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+int CompressedBVH::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    if (nodes.empty()) {
+        return 0;
+    }
+
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    float origin[3];
+    float invDir[3];
+    for (int a = 0; a < 3; a++) {
+        origin[a] = (float)start[a];
+        invDir[a] = (float)(1.0 / direction[a]);
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        float t_entry;
+    };
+    StackEntry stack[WIDE_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = { 0, (float)t_min };
+    double closest = t_max;
+    bool hit = false;
+
+    const bool dedupe = primitiveIndices.size() > primitives.size();
+    uint32_t mailbox[LINEAR_BVH_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + LINEAR_BVH_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+    const bool packed = !trianglePacks.empty();
+    const bool spherePacked = !spherePacks.empty();
+    TrianglePackHit packHit;
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.t_entry > closest) {
+            continue;
+        }
+
+        const CompressedBVHNode& node = nodes[entry.node];
+        float t_entry[COMPRESSED_BVH_WIDTH];
+        unsigned mask = hitChildren(node, origin, invDir, (float)t_min, std::nextafter((float)closest, std::numeric_limits<float>::infinity()), t_entry);
+
+        // Where every child's nodes and references start, from the running counts of the lanes before it
+        uint32_t childIndices[COMPRESSED_BVH_WIDTH];
+        uint32_t nextChild = node.childBase;
+        uint32_t nextPrimitive = node.primitiveBase;
+        for (size_t lane = 0; lane < node.childCount; lane++) {
+            childIndices[lane] = node.primitiveCounts[lane] == 0 ? nextChild++ : nextPrimitive;
+            nextPrimitive += node.primitiveCounts[lane];
+        }
+
+        size_t order[COMPRESSED_BVH_WIDTH];
+        size_t hitCount = 0;
+        for (size_t lane = 0; mask != 0; lane++, mask >>= 1) {
+            if (!(mask & 1)) {
+                continue;
+            }
+            size_t i = hitCount++;
+            while (i > 0 && t_entry[order[i - 1]] > t_entry[lane]) {
+                order[i] = order[i - 1];
+                i--;
+            }
+            order[i] = lane;
+        }
+
+        for (size_t i = 0; i < hitCount; i++) {
+            size_t lane = order[i];
+            if (node.primitiveCounts[lane] == 0 || t_entry[lane] > closest) {
+                continue;
+            }
+            uint32_t first = childIndices[lane];
+            uint32_t last = first + node.primitiveCounts[lane];
+            if (packed && !dedupe) {
+                hit |= trianglePacks.intersect(first, last, start, direction, t_min, closest, packHit);
+                continue;
+            }
+            if (spherePacked && !dedupe) {
+                hit |= spherePacks.intersect(first, last, ray, t_min, closest, hitRecord);
+                continue;
+            }
+            for (uint32_t p = first; p < last; p++) {
+                const uint32_t primitive = primitiveIndices[p];
+                if (dedupe) {
+                    if (mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] == primitive) {
+                        continue;
+                    }
+                    mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] = primitive;
+                }
+                if (packed) {
+                    hit |= trianglePacks.intersect(p, p + 1, start, direction, t_min, closest, packHit);
+                }
+                else if (primitives[primitive]->intersection(ray, t_min, closest, hitRecord)) {
+                    hit = true;
+                    closest = hitRecord.intT;
+                }
+            }
+        }
+        for (size_t i = hitCount; i > 0; i--) {
+            size_t lane = order[i - 1];
+            if (node.primitiveCounts[lane] == 0 && t_entry[lane] <= closest) {
+                stack[stackSize++] = { childIndices[lane], t_entry[lane] };
+            }
+        }
+    }
+
+    if (hit && packed) {
+        static_cast<const Triangle&>(*primitives[primitiveIndices[packHit.slot]]).makeHitRecord(ray, closest, packHit.u, packHit.v, hitRecord);
+    }
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any primitive blocks a ray within [t_min, t_max]. Stops at the first hit found, in no particular order.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any primitive is hit, false otherwise
+*/
+bool CompressedBVH::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    float origin[3];
+    float invDir[3];
+    for (int a = 0; a < 3; a++) {
+        origin[a] = (float)start[a];
+        invDir[a] = (float)(1.0 / direction[a]);
+    }
+    const float t_maxPadded = std::nextafter((float)t_max, std::numeric_limits<float>::infinity());
+
+    uint32_t stack[WIDE_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    const bool packed = !trianglePacks.empty();
+    const bool spherePacked = !spherePacks.empty();
+
+    while (stackSize > 0) {
+        const CompressedBVHNode& node = nodes[stack[--stackSize]];
+        float t_entry[COMPRESSED_BVH_WIDTH];
+        unsigned mask = hitChildren(node, origin, invDir, (float)t_min, t_maxPadded, t_entry);
+
+        uint32_t nextChild = node.childBase;
+        uint32_t nextPrimitive = node.primitiveBase;
+        for (size_t lane = 0; lane < node.childCount; lane++) {
+            uint32_t first = nextPrimitive;
+            nextPrimitive += node.primitiveCounts[lane];
+            if (node.primitiveCounts[lane] == 0) {
+                if (mask & (1u << lane)) {
+                    stack[stackSize++] = nextChild;
+                }
+                nextChild++;
+                continue;
+            }
+            if (!(mask & (1u << lane))) {
+                continue;
+            }
+            if (packed) {
+                if (trianglePacks.occluded(first, nextPrimitive, start, direction, t_min, t_max)) {
+                    return true;
+                }
+                continue;
+            }
+            if (spherePacked) {
+                if (spherePacks.occluded(first, nextPrimitive, ray, t_min, t_max)) {
+                    return true;
+                }
+                continue;
+            }
+            for (uint32_t p = first; p < nextPrimitive; p++) {
+                if (primitives[primitiveIndices[p]]->occluded(ray, t_min, t_max)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& CompressedBVH::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& CompressedBVH::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& CompressedBVH::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& CompressedBVH::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D CompressedBVH::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "LinearBVH.h"
+#include "WideBVH.h"
+#include "TrianglePacks.h"
+#include "SpherePacks.h"
+
+constexpr size_t COMPRESSED_BVH_WIDTH = 8;
+constexpr int COMPRESSED_BVH_MIN_EXPONENT = -100;     // keeps q * 2^exponent a normal float for boxes that are flat along an axis
+
+// 80-byte node of an 8-wide BVH whose child bounds are quantized to 8 bits against the node's own box
+// (Ylitie et al. 2017). Interior children are stored contiguously from childBase and leaf children's primitive
+// references contiguously from primitiveBase, both in lane order, so no per-child index is needed.
+struct CompressedBVHNode {
+    float origin[3];                // minimum corner of the node's box, every child box is an offset from it
+    int8_t exponent[3];             // a quantization step along each axis is 2^exponent
+    uint8_t childCount;
+    uint32_t childBase;             // index of the first interior child node
+    uint32_t primitiveBase;         // index of the first primitive reference of the first leaf child
+    uint8_t primitiveCounts[COMPRESSED_BVH_WIDTH];     // 0 for interior children
+    uint8_t quantizedMin[3][COMPRESSED_BVH_WIDTH];
+    uint8_t quantizedMax[3][COMPRESSED_BVH_WIDTH];
+};
+
+static_assert(sizeof(CompressedBVHNode) == 80, "CompressedBVHNode must be 80 bytes");
+
+// An 8-wide BVH with quantized child bounds, collapsed from a binary LinearBVH the same way as WideBVH.
+// Child boxes are decoded to floats during traversal; quantization always rounds outward, and the build checks every
+// decoded bound against the exact one, so a decoded box never excludes anything the original box contained.
+class CompressedBVH :
+    public Object
+{
+private:
+    std::vector<CompressedBVHNode> nodes;
+    std::vector<uint32_t> primitiveIndices;     // reordered so the leaves of every node are contiguous
+    std::vector<std::shared_ptr<Object>> primitives;
+    TrianglePacks trianglePacks;
+    SpherePacks spherePacks;
+
+    void collapse(const std::vector<LinearBVHNode>& binaryNodes, const std::vector<uint32_t>& binaryIndices, uint32_t binaryIndex, uint32_t nodeIndex);
+    void quantizeChildren(CompressedBVHNode& node, const std::vector<LinearBVHNode>& binaryNodes, const LinearBVHNode& parent, const uint32_t* children, size_t childCount);
+    unsigned hitChildren(const CompressedBVHNode& node, const float(&origin)[3], const float(&invDir)[3], float t_min, float t_max, float(&t_entry)[COMPRESSED_BVH_WIDTH]) const;
+
+public:
+    CompressedBVH();
+    CompressedBVH(const LinearBVH& binaryBVH);
+
+    static float exponentScale(int exponent);
+    static float decode(float origin, int exponent, uint8_t quantized);
+
+    const std::vector<CompressedBVHNode>& getNodes() const;
+    size_t memoryBytes() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
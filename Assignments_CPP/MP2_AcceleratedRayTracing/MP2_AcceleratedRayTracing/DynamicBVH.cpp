@@ -0,0 +1,642 @@
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+/*
+* @param a A bounding box
+* @param b A bounding box
+*
+* @return The smallest box containing both
+*/
+static AABB3D unionBox(const AABB3D& a, const AABB3D& b)
+{
+    AABB3D box = a;
+    box.expand(b);
+    return box;
+}
+
+/*
+* Default constructor for DynamicBVH (empty tree)
+*/
+DynamicBVH::DynamicBVH() : Object(ObjectType::DynamicBVH), rootIndex(DYNAMIC_BVH_NULL), freeList(DYNAMIC_BVH_NULL), buildParameters(BVHSplitMethod::SAH) {}
+
+/*
+* Constructor for DynamicBVH
+*
+* @param list A list of SceneObjects to use to build the BVH
+* @param params The split method and SAH costs of the initial build
+*/
+DynamicBVH::DynamicBVH(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params)
+    : Object(ObjectType::DynamicBVH), rootIndex(DYNAMIC_BVH_NULL), freeList(DYNAMIC_BVH_NULL), buildParameters(params)
+{
+    std::cout << "Objects to insert into dynamic BVH: " << list.size() << std::endl;
+    build(std::vector<std::shared_ptr<Object>>(list.begin(), list.end()));
+    std::cout << std::endl << leaves.size() << " objects in dynamic BVH!" << std::endl;
+}
+
+/*
+* Constructor for DynamicBVH
+*
+* @param list A list of Objects to use to build the BVH
+* @param params The split method and SAH costs of the initial build
+*/
+DynamicBVH::DynamicBVH(const std::vector<std::shared_ptr<Object>>& list, const BVHBuildParameters& params)
+    : Object(ObjectType::DynamicBVH), rootIndex(DYNAMIC_BVH_NULL), freeList(DYNAMIC_BVH_NULL), buildParameters(params)
+{
+    build(list);
+}
+
+/*
+* Replaces the tree with one built over a list of objects. The initial tree is a LinearBVH built with the tree's build
+* parameters and one primitive per leaf, which is converted node for node; edits are incremental from then on.
+*
+* @param list The objects. Objects without a bounding box are skipped.
+*/
+void DynamicBVH::build(const std::vector<std::shared_ptr<Object>>& list)
+{
+    nodes.clear();
+    leaves.clear();
+    rootIndex = DYNAMIC_BVH_NULL;
+    freeList = DYNAMIC_BVH_NULL;
+    if (list.empty()) {
+        return;
+    }
+
+    // Spatial splits would reference an object from several leaves, which an editable tree can't have
+    BVHBuildParameters params = buildParameters;
+    if (params.splitMethod == BVHSplitMethod::SBVH) {
+        params.splitMethod = BVHSplitMethod::SAH;
+    }
+    params.maxLeafPrimitives = 1;
+    LinearBVH bvh(list, params);
+
+    std::vector<std::shared_ptr<Object>> leftovers;
+    nodes.reserve(2 * list.size());
+    if (!bvh.getNodes().empty()) {
+        rootIndex = convert(bvh, 0, DYNAMIC_BVH_NULL, leftovers);
+    }
+    for (const std::shared_ptr<Object>& object : leftovers) {
+        insert(object);
+    }
+}
+
+/*
+* Rebuilds the tree from scratch over the objects it holds, for when many edits have worn its quality down
+*/
+void DynamicBVH::rebuild()
+{
+    std::vector<std::shared_ptr<Object>> objects;
+    objects.reserve(leaves.size());
+    for (const std::pair<const Object* const, int32_t>& leaf : leaves) {
+        objects.push_back(nodes[leaf.second].object);
+    }
+    build(objects);
+}
+
+/*
+* Copies the subtree of a LinearBVH into the node pool. Leaves holding more than one primitive keep the first one;
+* the rest are handed back to be inserted afterwards.
+*
+* @param bvh The LinearBVH
+* @param binaryIndex The root of the subtree in bvh
+* @param parent The node the subtree hangs from
+* @param leftovers Primitives that didn't get a leaf of their own. Modified by function.
+*
+* @return The index of the subtree's root
+*/
+int32_t DynamicBVH::convert(const LinearBVH& bvh, uint32_t binaryIndex, int32_t parent, std::vector<std::shared_ptr<Object>>& leftovers)
+{
+    const LinearBVHNode& binaryNode = bvh.getNodes()[binaryIndex];
+    const int32_t index = allocateNode();
+    nodes[index].parent = parent;
+
+    if (binaryNode.primitiveCount > 0) {
+        const std::vector<uint32_t>& primitiveIndices = bvh.getPrimitiveIndices();
+        const std::shared_ptr<Object>& object = bvh.getPrimitives()[primitiveIndices[binaryNode.offset]];
+        object->generateBoundingBox(nodes[index].bounds);
+        nodes[index].object = object;
+        leaves[object.get()] = index;
+        for (uint32_t i = binaryNode.offset + 1; i < binaryNode.offset + binaryNode.primitiveCount; i++) {
+            leftovers.push_back(bvh.getPrimitives()[primitiveIndices[i]]);
+        }
+        return index;
+    }
+
+    const int32_t left = convert(bvh, binaryIndex + 1, index, leftovers);
+    const int32_t right = convert(bvh, binaryNode.offset, index, leftovers);
+    DynamicBVHNode& node = nodes[index];
+    node.child[0] = left;
+    node.child[1] = right;
+    node.bounds = unionBox(nodes[left].bounds, nodes[right].bounds);
+    node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+    return index;
+}
+
+/*
+* @return The index of an unused node, reset to an empty leaf
+*/
+int32_t DynamicBVH::allocateNode()
+{
+    int32_t index;
+    if (freeList != DYNAMIC_BVH_NULL) {
+        index = freeList;
+        freeList = nodes[index].parent;
+    }
+    else {
+        index = (int32_t)nodes.size();
+        nodes.push_back(DynamicBVHNode());
+    }
+    DynamicBVHNode& node = nodes[index];
+    node.bounds = EMPTY_BOUNDING_BOX;
+    node.object = nullptr;
+    node.parent = DYNAMIC_BVH_NULL;
+    node.child[0] = DYNAMIC_BVH_NULL;
+    node.child[1] = DYNAMIC_BVH_NULL;
+    node.height = 0;
+    return index;
+}
+
+/*
+* Returns a node to the free list
+*
+* @param index The node
+*/
+void DynamicBVH::freeNode(int32_t index)
+{
+    nodes[index].object = nullptr;
+    nodes[index].height = -1;
+    nodes[index].parent = freeList;
+    freeList = index;
+}
+
+/*
+* Finds the node next to which a box adds the least surface area to the tree: the new parent's area plus the growth of
+* every ancestor. Subtrees are visited cheapest first and skipped once even their lower bound can't beat the best so far.
+*
+* @param box The bounds of the object to insert
+*
+* @return The index of the best sibling
+*/
+int32_t DynamicBVH::findBestSibling(const AABB3D& box) const
+{
+    const double boxArea = box.surfaceArea();
+    int32_t bestSibling = rootIndex;
+    double bestCost = unionBox(nodes[rootIndex].bounds, box).surfaceArea();
+
+    // (area the ancestors grow by, node), cheapest first
+    typedef std::pair<double, int32_t> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    candidates.push({ 0, rootIndex });
+    while (!candidates.empty()) {
+        const double inheritedCost = candidates.top().first;
+        const int32_t index = candidates.top().second;
+        candidates.pop();
+        if (inheritedCost + boxArea >= bestCost) {
+            break;
+        }
+
+        const DynamicBVHNode& node = nodes[index];
+        const double directCost = unionBox(node.bounds, box).surfaceArea();
+        const double cost = directCost + inheritedCost;
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestSibling = index;
+        }
+
+        // Going below this node, it grows by its direct cost minus its own area wherever the box ends up
+        const double childInheritedCost = inheritedCost + directCost - node.bounds.surfaceArea();
+        if (!node.isLeaf() && childInheritedCost + boxArea < bestCost) {
+            candidates.push({ childInheritedCost, node.child[0] });
+            candidates.push({ childInheritedCost, node.child[1] });
+        }
+    }
+    return bestSibling;
+}
+
+/*
+* Links a detached leaf into the tree next to its best sibling, then refits and rotates the path up to the root
+*
+* @param leaf The leaf, with its bounds already set
+*/
+void DynamicBVH::insertLeaf(int32_t leaf)
+{
+    if (rootIndex == DYNAMIC_BVH_NULL) {
+        rootIndex = leaf;
+        nodes[leaf].parent = DYNAMIC_BVH_NULL;
+        return;
+    }
+
+    const int32_t sibling = findBestSibling(nodes[leaf].bounds);
+    const int32_t oldParent = nodes[sibling].parent;
+    const int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].child[0] = sibling;
+    nodes[newParent].child[1] = leaf;
+    nodes[newParent].bounds = unionBox(nodes[sibling].bounds, nodes[leaf].bounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == DYNAMIC_BVH_NULL) {
+        rootIndex = newParent;
+    }
+    else {
+        DynamicBVHNode& parent = nodes[oldParent];
+        parent.child[parent.child[0] == sibling ? 0 : 1] = newParent;
+        refitAndRotate(oldParent);
+    }
+}
+
+/*
+* Unlinks a leaf from the tree, replacing its parent with its sibling, then refits and rotates the path up to the root.
+* The leaf itself stays allocated.
+*
+* @param leaf The leaf
+*/
+void DynamicBVH::removeLeaf(int32_t leaf)
+{
+    if (leaf == rootIndex) {
+        rootIndex = DYNAMIC_BVH_NULL;
+        return;
+    }
+
+    const int32_t parent = nodes[leaf].parent;
+    const int32_t grandParent = nodes[parent].parent;
+    const int32_t sibling = nodes[parent].child[nodes[parent].child[0] == leaf ? 1 : 0];
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    nodes[leaf].parent = DYNAMIC_BVH_NULL;
+
+    if (grandParent == DYNAMIC_BVH_NULL) {
+        rootIndex = sibling;
+    }
+    else {
+        DynamicBVHNode& node = nodes[grandParent];
+        node.child[node.child[0] == parent ? 0 : 1] = sibling;
+        refitAndRotate(grandParent);
+    }
+}
+
+/*
+* Walks from a node up to the root, rotating every node where that helps and then refitting its bounds and height
+*
+* @param index The lowest node whose subtree changed
+*/
+void DynamicBVH::refitAndRotate(int32_t index)
+{
+    while (index != DYNAMIC_BVH_NULL) {
+        rotate(index);
+        DynamicBVHNode& node = nodes[index];
+        const DynamicBVHNode& left = nodes[node.child[0]];
+        const DynamicBVHNode& right = nodes[node.child[1]];
+        node.bounds = unionBox(left.bounds, right.bounds);
+        node.height = 1 + std::max(left.height, right.height);
+        index = node.parent;
+    }
+}
+
+/*
+* Swaps one child of a node with a grandchild under the other child if that shrinks the other child's box the most.
+* The node's own box never changes, so neither does anything above it.
+*
+* @param index The node
+*/
+void DynamicBVH::rotate(int32_t index)
+{
+    const DynamicBVHNode& node = nodes[index];
+    double bestGain = 0;
+    int32_t bestChild = DYNAMIC_BVH_NULL;           // child moved down
+    int32_t bestGrandChild = DYNAMIC_BVH_NULL;      // grandchild moved up
+
+    for (int c = 0; c < 2; c++) {
+        const int32_t child = node.child[c];
+        const int32_t other = node.child[1 - c];
+        const DynamicBVHNode& otherNode = nodes[other];
+        if (otherNode.isLeaf()) {
+            continue;
+        }
+        // Swapping child with one of other's children leaves other's box around child and the remaining grandchild
+        for (int g = 0; g < 2; g++) {
+            const int32_t grandChild = otherNode.child[g];
+            const int32_t remaining = otherNode.child[1 - g];
+            double gain = otherNode.bounds.surfaceArea() - unionBox(nodes[child].bounds, nodes[remaining].bounds).surfaceArea();
+            if (gain > bestGain) {
+                bestGain = gain;
+                bestChild = child;
+                bestGrandChild = grandChild;
+            }
+        }
+    }
+
+    if (bestChild == DYNAMIC_BVH_NULL) {
+        return;
+    }
+
+    const int32_t other = nodes[bestGrandChild].parent;
+    DynamicBVHNode& nodeRef = nodes[index];
+    nodeRef.child[nodeRef.child[0] == bestChild ? 0 : 1] = bestGrandChild;
+    nodes[bestGrandChild].parent = index;
+    DynamicBVHNode& otherNode = nodes[other];
+    otherNode.child[otherNode.child[0] == bestGrandChild ? 0 : 1] = bestChild;
+    nodes[bestChild].parent = other;
+    otherNode.bounds = unionBox(nodes[otherNode.child[0]].bounds, nodes[otherNode.child[1]].bounds);
+    otherNode.height = 1 + std::max(nodes[otherNode.child[0]].height, nodes[otherNode.child[1]].height);
+}
+
+/*
+* Adds an object to the tree
+*
+* @param object The object
+*
+* @return True if it was added, false if it has no bounding box or is already in the tree
+*/
+bool DynamicBVH::insert(const std::shared_ptr<Object>& object)
+{
+    AABB3D box;
+    if (leaves.count(object.get()) > 0 || !object->generateBoundingBox(box)) {
+        return false;
+    }
+    const int32_t leaf = allocateNode();
+    nodes[leaf].bounds = box;
+    nodes[leaf].object = object;
+    leaves[object.get()] = leaf;
+    insertLeaf(leaf);
+    if (nodes[rootIndex].height >= DYNAMIC_BVH_STACK_SIZE) {
+        rebuild();
+    }
+    return true;
+}
+
+/*
+* Removes an object from the tree
+*
+* @param object The object
+*
+* @return True if it was removed, false if it wasn't in the tree
+*/
+bool DynamicBVH::remove(const Object& object)
+{
+    auto found = leaves.find(&object);
+    if (found == leaves.end()) {
+        return false;
+    }
+    const int32_t leaf = found->second;
+    leaves.erase(found);
+    removeLeaf(leaf);
+    freeNode(leaf);
+    return true;
+}
+
+/*
+* Moves an object's leaf to where its current bounding box belongs, after the object itself has moved
+*
+* @param object The object
+*
+* @return True if it was moved, false if it isn't in the tree
+*/
+bool DynamicBVH::update(const Object& object)
+{
+    auto found = leaves.find(&object);
+    if (found == leaves.end()) {
+        return false;
+    }
+    const int32_t leaf = found->second;
+    removeLeaf(leaf);
+    object.generateBoundingBox(nodes[leaf].bounds);
+    insertLeaf(leaf);
+    if (nodes[rootIndex].height >= DYNAMIC_BVH_STACK_SIZE) {
+        rebuild();
+    }
+    return true;
+}
+
+/*
+* @param object An object
+*
+* @return Whether the object is in the tree
+*/
+bool DynamicBVH::contains(const Object& object) const
+{
+    return leaves.count(&object) > 0;
+}
+
+/*
+* @return The number of objects in the tree
+*/
+size_t DynamicBVH::size() const
+{
+    return leaves.size();
+}
+
+/*
+* @return The height of the tree, 0 for a single leaf and -1 for an empty tree
+*/
+int32_t DynamicBVH::height() const
+{
+    return rootIndex == DYNAMIC_BVH_NULL ? -1 : nodes[rootIndex].height;
+}
+
+/*
+* @return The number of nodes in the tree
+*/
+size_t DynamicBVH::nodeCount() const
+{
+    return leaves.empty() ? 0 : 2 * leaves.size() - 1;
+}
+
+/*
+* Calculate the SAH cost of the tree, comparable with LinearBVH::sahCost
+*
+* @param params The traversal, leaf and intersection costs
+*
+* @return The SAH cost of the tree
+*/
+double DynamicBVH::sahCost(const BVHBuildParameters& params) const
+{
+    if (rootIndex == DYNAMIC_BVH_NULL) {
+        return 0;
+    }
+    return sahCostHelper(rootIndex, params);
+}
+
+/*
+* Helper method for recursive sahCost
+*
+* @param index The index of the subtree's root node
+* @param params The traversal, leaf and intersection costs
+*
+* @return The SAH cost of the subtree
+*/
+double DynamicBVH::sahCostHelper(int32_t index, const BVHBuildParameters& params) const
+{
+    const DynamicBVHNode& node = nodes[index];
+    if (node.isLeaf()) {
+        return params.leafCost + params.intersectionCost(*node.object);
+    }
+    double nodeArea = node.bounds.surfaceArea();
+    double cost = params.traversalCost;
+    for (int32_t child : node.child) {
+        double ratio = nodeArea > 0 ? nodes[child].bounds.surfaceArea() / nodeArea : 1.0;
+        cost += ratio * sahCostHelper(child, params);
+    }
+    return cost;
+}
+
+/*
+* Generate a bounding box for the BVH
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return True if a bounding box exists, false otherwise
+*/
+bool DynamicBVH::generateBoundingBox(AABB3D& output_box) const
+{
+    if (rootIndex == DYNAMIC_BVH_NULL) {
+        return false;
+    }
+    output_box = nodes[rootIndex].bounds;
+    return true;
+}
+
+/*
+* Find the closest object a ray intersects, visiting the nearer child first as LinearBVH does
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any object was hit, 0 otherwise
+*/
+int DynamicBVH::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    TraversalRay traversalRay(ray, t_min, t_max);
+
+    double t_entry = 0;
+    if (rootIndex == DYNAMIC_BVH_NULL || !traversalRay.hitBox(nodes[rootIndex].bounds.min(), nodes[rootIndex].bounds.max(), t_entry)) {
+        return 0;
+    }
+
+    struct StackEntry {
+        int32_t node;
+        double t_entry;
+    };
+    StackEntry stack[DYNAMIC_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    int32_t current = rootIndex;
+    double& closest = traversalRay.tMax;
+    bool hit = false;
+
+    while (true) {
+        const DynamicBVHNode& node = nodes[current];
+        if (node.isLeaf()) {
+            if (node.object->intersection(ray, t_min, closest, hitRecord)) {
+                hit = true;
+                closest = hitRecord.intT;
+            }
+        }
+        else {
+            int32_t nearChild = node.child[0];
+            int32_t farChild = node.child[1];
+            double t_near = 0;
+            double t_far = 0;
+            bool hitNear = traversalRay.hitBox(nodes[nearChild].bounds.min(), nodes[nearChild].bounds.max(), t_near);
+            bool hitFar = traversalRay.hitBox(nodes[farChild].bounds.min(), nodes[farChild].bounds.max(), t_far);
+            if (hitNear && hitFar) {
+                if (t_far < t_near) {
+                    std::swap(nearChild, farChild);
+                    std::swap(t_near, t_far);
+                }
+                stack[stackSize++] = { farChild, t_far };
+                current = nearChild;
+                continue;
+            }
+            if (hitNear || hitFar) {
+                current = hitNear ? nearChild : farChild;
+                continue;
+            }
+        }
+
+        while (stackSize > 0 && stack[stackSize - 1].t_entry > closest) {
+            stackSize--;
+        }
+        if (stackSize == 0) {
+            break;
+        }
+        current = stack[--stackSize].node;
+    }
+
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any object blocks a ray within [t_min, t_max]. Stops at the first hit found, in no particular order.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any object is hit, false otherwise
+*/
+bool DynamicBVH::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    if (rootIndex == DYNAMIC_BVH_NULL) {
+        return false;
+    }
+
+    const TraversalRay traversalRay(ray, t_min, t_max);
+
+    // Every node pushed is a child of a node popped before, so the stack never holds more than height + 1 entries
+    int32_t stack[DYNAMIC_BVH_STACK_SIZE + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = rootIndex;
+
+    while (stackSize > 0) {
+        const DynamicBVHNode& node = nodes[stack[--stackSize]];
+        double t_entry;
+        if (!traversalRay.hitBox(node.bounds.min(), node.bounds.max(), t_entry)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (node.object->occluded(ray, t_min, t_max)) {
+                return true;
+            }
+        }
+        else {
+            stack[stackSize++] = node.child[1];
+            stack[stackSize++] = node.child[0];
+        }
+    }
+
+    return false;
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& DynamicBVH::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& DynamicBVH::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& DynamicBVH::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& DynamicBVH::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D DynamicBVH::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
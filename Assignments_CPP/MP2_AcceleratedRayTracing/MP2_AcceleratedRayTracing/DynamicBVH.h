@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "Object.h"
+#include "SceneObject.h"
+#include "LinearBVH.h"
+#include "TraversalRay.h"
+
+constexpr int32_t DYNAMIC_BVH_NULL = -1;
+constexpr int32_t DYNAMIC_BVH_STACK_SIZE = 256;      // the tree is rebuilt before it grows this tall, so traversal never overflows its stack
+
+// Node of a DynamicBVH. Nodes live in a pool and link to each other by index, so an edit only touches the nodes on one path.
+struct DynamicBVHNode {
+    AABB3D bounds;
+    std::shared_ptr<Object> object;     // leaves only
+    int32_t parent;                     // next free node while the node is unused
+    int32_t child[2];                   // DYNAMIC_BVH_NULL for leaves
+    int32_t height;                     // 0 for leaves
+
+    bool isLeaf() const { return child[0] == DYNAMIC_BVH_NULL; }
+};
+
+// A BVH with one object per leaf that can be edited in place. Objects are inserted next to the sibling that adds the least
+// surface area to the tree, found by branch and bound (Bittner et al. 2015), and every node on the path back to the root
+// is refit and, where it lowers the surface area, rotated (Kopta et al. 2012). Removing or moving an object only touches
+// the path from its leaf to the root, so one edit costs O(log n) instead of a rebuild.
+class DynamicBVH :
+    public Object
+{
+private:
+    std::vector<DynamicBVHNode> nodes;
+    int32_t rootIndex;
+    int32_t freeList;
+    std::unordered_map<const Object*, int32_t> leaves;
+    BVHBuildParameters buildParameters;
+
+    int32_t allocateNode();
+    void freeNode(int32_t index);
+    int32_t convert(const LinearBVH& bvh, uint32_t binaryIndex, int32_t parent, std::vector<std::shared_ptr<Object>>& leftovers);
+    int32_t findBestSibling(const AABB3D& box) const;
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    void refitAndRotate(int32_t index);
+    void rotate(int32_t index);
+    double sahCostHelper(int32_t index, const BVHBuildParameters& params) const;
+
+public:
+    DynamicBVH();
+    DynamicBVH(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params = BVHBuildParameters(BVHSplitMethod::SAH));
+    DynamicBVH(const std::vector<std::shared_ptr<Object>>& list, const BVHBuildParameters& params = BVHBuildParameters(BVHSplitMethod::SAH));
+
+    void build(const std::vector<std::shared_ptr<Object>>& list);
+    void rebuild();
+
+    bool insert(const std::shared_ptr<Object>& object);
+    bool remove(const Object& object);
+    bool update(const Object& object);
+    bool contains(const Object& object) const;
+
+    size_t size() const;
+    int32_t height() const;
+    size_t nodeCount() const;
+    double sahCost(const BVHBuildParameters& params) const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
@@ -0,0 +1,446 @@
+#include "Grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/*
+* Default constructor for Grid (empty grid)
+*/
+Grid::Grid() : Object(ObjectType::Grid), twoLevel(false) {}
+
+/*
+* Constructor for Grid
+*
+* @param triangleMesh The TriangleMesh with which to build the grid
+* @param twoLevel Whether dense cells get a sub-grid
+*/
+Grid::Grid(const std::shared_ptr<TriangleMesh>& triangleMesh, bool twoLevel) : Object(ObjectType::Grid), twoLevel(twoLevel)
+{
+    const std::vector<std::shared_ptr<Triangle>> triangles = triangleMesh->getTriangles();
+    primitives.assign(triangles.begin(), triangles.end());
+    std::cout << "Objects to insert into grid: " << primitives.size() << std::endl;
+    build();
+    std::cout << std::endl << primitives.size() << " objects in grid!" << std::endl;
+}
+
+/*
+* Constructor for Grid
+*
+* @param list A list of SceneObjects to use to build the grid
+* @param twoLevel Whether dense cells get a sub-grid
+*/
+Grid::Grid(const std::vector<std::shared_ptr<SceneObject>>& list, bool twoLevel) : Object(ObjectType::Grid), twoLevel(twoLevel)
+{
+    primitives.assign(list.begin(), list.end());
+    std::cout << "Objects to insert into grid: " << primitives.size() << std::endl;
+    build();
+    std::cout << std::endl << primitives.size() << " objects in grid!" << std::endl;
+}
+
+/*
+* Constructor for Grid
+*
+* @param list A list of Objects to use to build the grid
+* @param twoLevel Whether dense cells get a sub-grid
+*/
+Grid::Grid(const std::vector<std::shared_ptr<Object>>& list, bool twoLevel) : Object(ObjectType::Grid), primitives(list), twoLevel(twoLevel)
+{
+    build();
+}
+
+/*
+* (Re)builds the grid over the primitives' current bounds. Linear in the number of primitive references, so a scene
+* whose primitives move can simply call this once per frame.
+*/
+void Grid::build()
+{
+    topLevel = GridLevel();
+    cellSubGrids.clear();
+    subGrids.clear();
+    trianglePacks.clear();
+    if (primitives.empty()) {
+        return;
+    }
+
+    AABB3D bounds = EMPTY_BOUNDING_BOX;
+    primitiveBounds.resize(primitives.size());
+    for (size_t i = 0; i < primitives.size(); i++) {
+        if (!primitives[i]->generateBoundingBox(primitiveBounds[i])) {
+            std::cerr << "No bounding box in grid build.\n";
+        }
+        bounds.expand(primitiveBounds[i]);
+    }
+
+    std::vector<uint32_t> allPrimitives(primitives.size());
+    std::iota(allPrimitives.begin(), allPrimitives.end(), 0);
+    buildLevel(topLevel, bounds, allPrimitives.data(), allPrimitives.size(), std::numeric_limits<size_t>::max());
+
+    if (twoLevel) {
+        cellSubGrids.assign(topLevel.cellCount(), -1);
+        for (int z = 0; z < topLevel.resolution[2]; z++) {
+            for (int y = 0; y < topLevel.resolution[1]; y++) {
+                for (int x = 0; x < topLevel.resolution[0]; x++) {
+                    const size_t cell = topLevel.cellIndex(x, y, z);
+                    const uint32_t first = topLevel.cellStart[cell];
+                    const uint32_t count = topLevel.cellStart[cell + 1] - first;
+                    if (count <= GRID_DENSE_CELL_PRIMITIVES) {
+                        continue;
+                    }
+                    const int c[3]{ x, y, z };
+                    Point3D cellMin;
+                    Point3D cellMax;
+                    for (int a = 0; a < 3; a++) {
+                        cellMin[a] = topLevel.bounds.min()[a] + c[a] * topLevel.cellSize[a];
+                        cellMax[a] = c[a] + 1 == topLevel.resolution[a] ? topLevel.bounds.max()[a] : topLevel.bounds.min()[a] + (c[a] + 1) * topLevel.cellSize[a];
+                    }
+                    // Primitives much larger than the cell would be copied into most sub-cells, so such cells stay flat
+                    GridLevel subGrid;
+                    if (buildLevel(subGrid, AABB3D(cellMin, cellMax), topLevel.cellPrimitives.data() + first, count, (size_t)(GRID_MAX_SUB_GRID_REFERENCES * count))) {
+                        cellSubGrids[cell] = (int32_t)subGrids.size();
+                        subGrids.push_back(std::move(subGrid));
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<AABB3D>().swap(primitiveBounds);
+    trianglePacks.build(primitives, allPrimitives);
+}
+
+/*
+* Fills one level over a box, choosing its resolution so it holds about GRID_DENSITY cells per primitive
+*
+* @param level The level to fill. Modified by function.
+* @param box The bounds of the level
+* @param levelPrimitives The primitives overlapping the box
+* @param count The number of primitives overlapping the box
+* @param maxReferences The most primitive references the level may hold
+*
+* @return True if the level was filled, false if it would have held more than maxReferences references
+*/
+bool Grid::buildLevel(GridLevel& level, const AABB3D& box, const uint32_t* levelPrimitives, size_t count, size_t maxReferences) const
+{
+    level.bounds = box;
+    double extent[3];
+    double volume = 1;
+    double maxExtent = 0;
+    for (int a = 0; a < 3; a++) {
+        extent[a] = box.max()[a] - box.min()[a];
+        volume *= extent[a];
+        maxExtent = std::max(maxExtent, extent[a]);
+    }
+
+    // Flat boxes have no volume, so their cell size follows from the longest side instead
+    double cellsPerUnit = volume > 0 ? std::cbrt(GRID_DENSITY * count / volume) : (maxExtent > 0 ? std::cbrt(GRID_DENSITY * count) / maxExtent : 0);
+    for (int a = 0; a < 3; a++) {
+        level.resolution[a] = std::max(1, std::min(GRID_MAX_RESOLUTION, (int)std::lround(extent[a] * cellsPerUnit)));
+        level.cellSize[a] = extent[a] / level.resolution[a];
+        level.invCellSize[a] = level.cellSize[a] > 0 ? 1.0 / level.cellSize[a] : 0;
+    }
+
+    // Count the references of every cell, turn the counts into offsets, then drop every primitive into its cells
+    level.cellStart.assign(level.cellCount() + 1, 0);
+    int lo[3];
+    int hi[3];
+    for (size_t i = 0; i < count; i++) {
+        cellRange(level, primitiveBounds[levelPrimitives[i]], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    level.cellStart[level.cellIndex(x, y, z) + 1]++;
+                }
+            }
+        }
+    }
+    std::partial_sum(level.cellStart.begin(), level.cellStart.end(), level.cellStart.begin());
+    if (level.cellStart.back() > maxReferences) {
+        return false;
+    }
+
+    level.cellPrimitives.resize(level.cellStart.back());
+    std::vector<uint32_t> cursor(level.cellStart.begin(), level.cellStart.end() - 1);
+    for (size_t i = 0; i < count; i++) {
+        cellRange(level, primitiveBounds[levelPrimitives[i]], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    level.cellPrimitives[cursor[level.cellIndex(x, y, z)]++] = levelPrimitives[i];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*
+* Finds the cells of a level a box overlaps, clamped to the level
+*
+* @param level The level
+* @param box The box
+* @param lo The lowest overlapped cell along each axis. Modified by function.
+* @param hi The highest overlapped cell along each axis. Modified by function.
+*/
+void Grid::cellRange(const GridLevel& level, const AABB3D& box, int(&lo)[3], int(&hi)[3]) const
+{
+    for (int a = 0; a < 3; a++) {
+        double origin = level.bounds.min()[a];
+        double last = level.resolution[a] - 1;
+        lo[a] = (int)std::max(0.0, std::min(last, std::floor((box.min()[a] - origin) * level.invCellSize[a])));
+        hi[a] = (int)std::max(0.0, std::min(last, std::floor((box.max()[a] - origin) * level.invCellSize[a])));
+    }
+}
+
+/*
+* Walks the cells of one level a ray passes through front to back with a 3D-DDA, testing the primitives of each cell
+* and descending into a cell's sub-grid if it has one. Stops once the closest hit lies inside the current cell.
+*
+* @param level The level to walk
+* @param levelSubGrids The sub-grid of each of the level's cells, nullptr if it has none
+* @param ray The Ray3D.
+* @param invDir The reciprocal of the ray's direction
+* @param t_min The minimum intersection t.
+* @param t_enter The t from which to walk
+* @param t_exit The t up to which to walk
+* @param closest The closest hit so far, or the maximum t of an any-hit query. Modified by function.
+* @param packHit The primitive and barycentric coordinates of the closest packed triangle hit. Modified by function.
+* @param hitRecord The HitRecord of the closest unpacked hit. Modified by function.
+* @param mailbox The primitives this ray already tested. Modified by function.
+* @param anyHit Whether to stop at the first hit rather than look for the closest one
+*
+* @return True if any primitive was hit
+*/
+bool Grid::walk(const GridLevel& level, const int32_t* levelSubGrids, const Ray3D& ray, const double(&invDir)[3], double t_min, double t_enter, double t_exit,
+    double& closest, TrianglePackHit& packHit, HitRecord& hitRecord, uint32_t(&mailbox)[GRID_MAILBOX_SIZE], bool anyHit) const
+{
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+
+    // Clip to the level's bounds
+    for (int a = 0; a < 3; a++) {
+        double t0 = (level.bounds.min()[a] - start[a]) * invDir[a];
+        double t1 = (level.bounds.max()[a] - start[a]) * invDir[a];
+        if (invDir[a] < 0) {
+            std::swap(t0, t1);
+        }
+        t_enter = t0 > t_enter ? t0 : t_enter;
+        t_exit = t1 < t_exit ? t1 : t_exit;
+        if (t_exit < t_enter) {
+            return false;
+        }
+    }
+
+    // Set up the DDA from the cell the ray enters in
+    int cell[3];
+    int step[3];
+    int out[3];
+    double t_next[3];
+    double t_delta[3];
+    for (int a = 0; a < 3; a++) {
+        const double origin = level.bounds.min()[a];
+        const double entry = start[a] + direction[a] * t_enter;
+        cell[a] = (int)std::max(0.0, std::min(level.resolution[a] - 1.0, std::floor((entry - origin) * level.invCellSize[a])));
+        if (direction[a] > 0) {
+            step[a] = 1;
+            out[a] = level.resolution[a];
+            t_next[a] = (origin + (cell[a] + 1) * level.cellSize[a] - start[a]) * invDir[a];
+            t_delta[a] = level.cellSize[a] * invDir[a];
+        }
+        else if (direction[a] < 0) {
+            step[a] = -1;
+            out[a] = -1;
+            t_next[a] = (origin + cell[a] * level.cellSize[a] - start[a]) * invDir[a];
+            t_delta[a] = -level.cellSize[a] * invDir[a];
+        }
+        else {
+            step[a] = 0;
+            out[a] = -1;
+            t_next[a] = std::numeric_limits<double>::infinity();
+            t_delta[a] = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    const bool packed = !trianglePacks.empty();
+    bool hit = false;
+    double t_cell = t_enter;
+    while (true) {
+        const int axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+        const double t_cellExit = std::min(t_next[axis], t_exit);
+        const size_t cellIndex = level.cellIndex(cell[0], cell[1], cell[2]);
+
+        if (levelSubGrids && levelSubGrids[cellIndex] >= 0) {
+            hit |= walk(subGrids[levelSubGrids[cellIndex]], nullptr, ray, invDir, t_min, t_cell, std::min(t_cellExit, closest), closest, packHit, hitRecord, mailbox, anyHit);
+        }
+        else {
+            for (uint32_t i = level.cellStart[cellIndex]; i < level.cellStart[cellIndex + 1]; i++) {
+                const uint32_t primitive = level.cellPrimitives[i];
+                if (mailbox[primitive % GRID_MAILBOX_SIZE] == primitive) {
+                    continue;
+                }
+                mailbox[primitive % GRID_MAILBOX_SIZE] = primitive;
+                if (anyHit) {
+                    if (packed ? trianglePacks.occluded(primitive, primitive + 1, start, direction, t_min, closest) : primitives[primitive]->occluded(ray, t_min, closest)) {
+                        return true;
+                    }
+                }
+                else if (packed) {
+                    hit |= trianglePacks.intersect(primitive, primitive + 1, start, direction, t_min, closest, packHit);
+                }
+                else if (primitives[primitive]->intersection(ray, t_min, closest, hitRecord)) {
+                    hit = true;
+                    closest = hitRecord.intT;
+                }
+            }
+        }
+        if (anyHit && hit) {
+            return true;
+        }
+
+        // A hit beyond this cell may still be beaten by a primitive in a later cell, so only one inside it ends the walk
+        if (closest <= t_cellExit || t_next[axis] >= t_exit) {
+            break;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] == out[axis]) {
+            break;
+        }
+        t_cell = t_next[axis];
+        t_next[axis] += t_delta[axis];
+    }
+
+    return hit;
+}
+
+/*
+* @return The top level of the grid
+*/
+const GridLevel& Grid::getTopLevel() const
+{
+    return topLevel;
+}
+
+/*
+* @return The sub-grids of the dense top-level cells
+*/
+const std::vector<GridLevel>& Grid::getSubGrids() const
+{
+    return subGrids;
+}
+
+/*
+* @return The bytes used by the cell offsets and references of every level, the primitive pointers and the triangle packs
+*/
+size_t Grid::memoryBytes() const
+{
+    size_t bytes = (topLevel.cellStart.size() + topLevel.cellPrimitives.size()) * sizeof(uint32_t) + cellSubGrids.size() * sizeof(int32_t);
+    for (const GridLevel& level : subGrids) {
+        bytes += sizeof(GridLevel) + (level.cellStart.size() + level.cellPrimitives.size()) * sizeof(uint32_t);
+    }
+    return bytes + primitives.size() * sizeof(std::shared_ptr<Object>) + trianglePacks.memoryBytes();
+}
+
+/*
+* Generate a bounding box for the grid
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return True if a bounding box exists, false otherwise
+*/
+bool Grid::generateBoundingBox(AABB3D& output_box) const
+{
+    if (topLevel.cellStart.empty()) {
+        return false;
+    }
+    output_box = topLevel.bounds;
+    return true;
+}
+
+/*
+* Find the closest primitive a ray intersects by walking the grid cell by cell
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+int Grid::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    if (topLevel.cellStart.empty()) {
+        return 0;
+    }
+
+    const Vec3D& direction = ray.getDirection();
+    double invDir[3]{ 1.0 / direction[0], 1.0 / direction[1], 1.0 / direction[2] };
+
+    // Primitives spanning several cells are referenced from each; a small mailbox skips the ones this ray already tested
+    uint32_t mailbox[GRID_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + GRID_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    // Packed triangles only track the closest slot; its HitRecord is filled once the walk is done
+    double closest = t_max;
+    TrianglePackHit packHit;
+    bool hit = walk(topLevel, cellSubGrids.empty() ? nullptr : cellSubGrids.data(), ray, invDir, t_min, t_min, t_max, closest, packHit, hitRecord, mailbox, false);
+
+    if (hit && !trianglePacks.empty()) {
+        static_cast<const Triangle&>(*primitives[packHit.slot]).makeHitRecord(ray, closest, packHit.u, packHit.v, hitRecord);
+    }
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any primitive blocks a ray within [t_min, t_max]. Stops at the first hit found.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any primitive is hit, false otherwise
+*/
+bool Grid::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    if (topLevel.cellStart.empty()) {
+        return false;
+    }
+
+    const Vec3D& direction = ray.getDirection();
+    double invDir[3]{ 1.0 / direction[0], 1.0 / direction[1], 1.0 / direction[2] };
+
+    uint32_t mailbox[GRID_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + GRID_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    double closest = t_max;
+    TrianglePackHit packHit;
+    HitRecord hitRecord;
+    return walk(topLevel, cellSubGrids.empty() ? nullptr : cellSubGrids.data(), ray, invDir, t_min, t_min, t_max, closest, packHit, hitRecord, mailbox, true);
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& Grid::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& Grid::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& Grid::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& Grid::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D Grid::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
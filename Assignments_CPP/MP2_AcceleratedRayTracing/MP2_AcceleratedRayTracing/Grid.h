@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "SceneObject.h"
+#include "TriangleMesh.h"
+#include "TrianglePacks.h"
+
+constexpr double GRID_DENSITY = 4.0;                    // cells per primitive, the cell resolution follows from it and the bounds
+constexpr int GRID_MAX_RESOLUTION = 128;                // cells along one axis of a level
+constexpr size_t GRID_DENSE_CELL_PRIMITIVES = 16;       // top-level cells holding more primitives get their own sub-grid
+constexpr double GRID_MAX_SUB_GRID_REFERENCES = 8.0;    // a sub-grid may hold at most this many references per primitive of its cell
+constexpr uint32_t GRID_MAILBOX_SIZE = 16;              // primitives remembered per ray so primitives spanning cells are tested once
+
+// One uniform level of a Grid. Cell primitives are stored compressed: the primitives of cell c are
+// cellPrimitives[cellStart[c], cellStart[c + 1]), with cells numbered x-fastest.
+struct GridLevel {
+    AABB3D bounds;
+    int resolution[3];
+    double cellSize[3];
+    double invCellSize[3];      // 0 along an axis the level is flat on
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellPrimitives;
+
+    size_t cellCount() const { return (size_t)resolution[0] * resolution[1] * resolution[2]; }
+    size_t cellIndex(int x, int y, int z) const { return x + (size_t)resolution[0] * (y + (size_t)resolution[1] * z); }
+};
+
+// A uniform grid over bounded primitives, traversed cell by cell with a 3D-DDA (Amanatides and Woo 1987).
+// The build is two linear passes (count, then fill), cheap enough to rebuild every frame for moving primitives.
+// With two levels, top-level cells holding many primitives get a sub-grid of their own, so clustered geometry
+// inside a mostly empty scene doesn't end up in a handful of overfull cells.
+class Grid :
+    public Object
+{
+private:
+    std::vector<std::shared_ptr<Object>> primitives;
+    std::vector<AABB3D> primitiveBounds;    // only kept while building
+    bool twoLevel;
+
+    GridLevel topLevel;
+    std::vector<int32_t> cellSubGrids;      // sub-grid of each top-level cell, -1 for none. Empty with one level.
+    std::vector<GridLevel> subGrids;
+    TrianglePacks trianglePacks;            // in primitive order, empty unless every primitive is a Triangle
+
+    bool buildLevel(GridLevel& level, const AABB3D& box, const uint32_t* levelPrimitives, size_t count, size_t maxReferences) const;
+    void cellRange(const GridLevel& level, const AABB3D& box, int(&lo)[3], int(&hi)[3]) const;
+    bool walk(const GridLevel& level, const int32_t* levelSubGrids, const Ray3D& ray, const double(&invDir)[3], double t_min, double t_enter, double t_exit,
+        double& closest, TrianglePackHit& packHit, HitRecord& hitRecord, uint32_t(&mailbox)[GRID_MAILBOX_SIZE], bool anyHit) const;
+
+public:
+    Grid();
+    Grid(const std::shared_ptr<TriangleMesh>& triangleMesh, bool twoLevel = true);
+    Grid(const std::vector<std::shared_ptr<SceneObject>>& list, bool twoLevel = true);
+    Grid(const std::vector<std::shared_ptr<Object>>& list, bool twoLevel = true);
+
+    void build();
+
+    const GridLevel& getTopLevel() const;
+    const std::vector<GridLevel>& getSubGrids() const;
+    size_t memoryBytes() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
@@ -0,0 +1,488 @@
+#include "KdTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/*
+* Default constructor for KdTree (empty tree)
+*/
+KdTree::KdTree() : Object(ObjectType::KdTree) {}
+
+/*
+* Constructor for KdTree
+*
+* @param triangleMesh The TriangleMesh with which to build the kd-tree
+*/
+KdTree::KdTree(const std::shared_ptr<TriangleMesh>& triangleMesh) : Object(ObjectType::KdTree)
+{
+    const std::vector<std::shared_ptr<Triangle>>& triangles = triangleMesh->getTriangles();
+    primitives.assign(triangles.begin(), triangles.end());
+    std::cout << "Objects to insert into kd-tree: " << primitives.size() << std::endl;
+    build();
+    std::cout << std::endl << primitives.size() << " objects in kd-tree!" << std::endl;
+}
+
+/*
+* Constructor for KdTree
+*
+* @param list A list of SceneObjects to use to build the kd-tree
+*/
+KdTree::KdTree(const std::vector<std::shared_ptr<SceneObject>>& list) : Object(ObjectType::KdTree)
+{
+    primitives.assign(list.begin(), list.end());
+    std::cout << "Objects to insert into kd-tree: " << primitives.size() << std::endl;
+    build();
+    std::cout << std::endl << primitives.size() << " objects in kd-tree!" << std::endl;
+}
+
+/*
+* Constructor for KdTree
+*
+* @param list A list of Objects to use to build the kd-tree
+*/
+KdTree::KdTree(const std::vector<std::shared_ptr<Object>>& list) : Object(ObjectType::KdTree), primitives(list)
+{
+    build();
+}
+
+/*
+* Builds the node array over the primitives
+*/
+void KdTree::build()
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    trianglePacks.clear();
+    bounds = EMPTY_BOUNDING_BOX;
+    if (primitives.empty()) {
+        return;
+    }
+
+    primitiveBounds.resize(primitives.size());
+    std::vector<uint32_t> rootPrimitives(primitives.size());
+    for (size_t i = 0; i < primitives.size(); i++) {
+        if (!primitives[i]->generateBoundingBox(primitiveBounds[i])) {
+            std::cerr << "No bounding box in kd-tree build.\n";
+        }
+        bounds.expand(primitiveBounds[i]);
+        rootPrimitives[i] = (uint32_t)i;
+    }
+
+    // Every axis keeps its own sorted edge array, so the best axis' edges are still in order after the other axes are tried
+    std::vector<BoundEdge> edges[3];
+    for (int a = 0; a < 3; a++) {
+        edges[a].resize(2 * primitives.size());
+    }
+
+    int maxDepth = (int)std::lround(8 + 1.3 * std::log2((double)primitives.size()));
+    buildNode(bounds, rootPrimitives, maxDepth, 0, edges);
+
+    std::vector<AABB3D>().swap(primitiveBounds);
+    nodes.shrink_to_fit();
+    primitiveIndices.shrink_to_fit();
+
+    // Straddling primitives are referenced from several leaves, so the packs are kept in primitive order rather than
+    // leaf order and every triangle is packed once
+    std::vector<uint32_t> packOrder(primitives.size());
+    std::iota(packOrder.begin(), packOrder.end(), 0);
+    trianglePacks.build(primitives, packOrder);
+}
+
+/*
+* Appends the subtree over nodePrimitives to the node array depth-first, splitting at the SAH-cheapest bound edge
+*
+* @param nodeBox The bounds of the node's region of space
+* @param nodePrimitives The primitives overlapping the node. Released by function once they are classified.
+* @param depth The number of levels still allowed below the node
+* @param badRefines The number of splits above the node that raised the cost
+* @param edges Scratch arrays of bound edges, one per axis, each with room for two edges per primitive
+*/
+void KdTree::buildNode(const AABB3D& nodeBox, std::vector<uint32_t>& nodePrimitives, int depth, int badRefines, std::vector<BoundEdge>(&edges)[3])
+{
+    const uint32_t nodeIndex = (uint32_t)nodes.size();
+    nodes.push_back(KdTreeNode());
+    const size_t n = nodePrimitives.size();
+    if (n <= KD_TREE_MAX_LEAF_PRIMITIVES || depth == 0) {
+        makeLeaf(nodeIndex, nodePrimitives);
+        return;
+    }
+
+    const Point3D& boxMin = nodeBox.min();
+    const Point3D& boxMax = nodeBox.max();
+    const double extent[3]{ boxMax[0] - boxMin[0], boxMax[1] - boxMin[1], boxMax[2] - boxMin[2] };
+    const double totalArea = nodeBox.surfaceArea();
+    const double invTotalArea = totalArea > 0 ? 1.0 / totalArea : 0;
+    const double leafCost = KD_TREE_INTERSECTION_COST * n;
+
+    int bestAxis = -1;
+    size_t bestOffset = 0;
+    double bestCost = std::numeric_limits<double>::infinity();
+
+    // Try the longest axis first and only fall back to the others when it has no edge inside the node
+    int axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+    for (int retries = 0; retries < 3 && bestAxis == -1; retries++, axis = (axis + 1) % 3) {
+        std::vector<BoundEdge>& axisEdges = edges[axis];
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t primitive = nodePrimitives[i];
+            axisEdges[2 * i] = { primitiveBounds[primitive].min()[axis], primitive, true };
+            axisEdges[2 * i + 1] = { primitiveBounds[primitive].max()[axis], primitive, false };
+        }
+        // Starts sort before ends at the same position, so a flat primitive lying on a plane is counted on both sides
+        std::sort(axisEdges.begin(), axisEdges.begin() + 2 * n, [](const BoundEdge& e0, const BoundEdge& e1) {
+            return e0.t == e1.t ? (e0.start && !e1.start) : e0.t < e1.t;
+        });
+
+        const int other0 = (axis + 1) % 3;
+        const int other1 = (axis + 2) % 3;
+        size_t below = 0;
+        size_t above = n;
+        for (size_t i = 0; i < 2 * n; i++) {
+            const BoundEdge& edge = axisEdges[i];
+            if (!edge.start) {
+                above--;
+            }
+            if (edge.t > boxMin[axis] && edge.t < boxMax[axis]) {
+                double belowArea = 2 * (extent[other0] * extent[other1] + (edge.t - boxMin[axis]) * (extent[other0] + extent[other1]));
+                double aboveArea = 2 * (extent[other0] * extent[other1] + (boxMax[axis] - edge.t) * (extent[other0] + extent[other1]));
+                double emptyBonus = (below == 0 || above == 0) ? KD_TREE_EMPTY_BONUS : 0;
+                double cost = KD_TREE_TRAVERSAL_COST + KD_TREE_INTERSECTION_COST * (1 - emptyBonus) * (belowArea * invTotalArea * below + aboveArea * invTotalArea * above);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestOffset = i;
+                }
+            }
+            if (edge.start) {
+                below++;
+            }
+        }
+    }
+
+    if (bestCost > leafCost) {
+        badRefines++;
+    }
+    if (bestAxis == -1 || badRefines == KD_TREE_MAX_BAD_REFINES || (bestCost > 4 * leafCost && n < 16)) {
+        makeLeaf(nodeIndex, nodePrimitives);
+        return;
+    }
+
+    // Primitives starting before the split go below and primitives ending after it go above; straddling ones go to both
+    const std::vector<BoundEdge>& axisEdges = edges[bestAxis];
+    std::vector<uint32_t> belowPrimitives;
+    std::vector<uint32_t> abovePrimitives;
+    for (size_t i = 0; i < bestOffset; i++) {
+        if (axisEdges[i].start) {
+            belowPrimitives.push_back(axisEdges[i].primitive);
+        }
+    }
+    for (size_t i = bestOffset + 1; i < 2 * n; i++) {
+        if (!axisEdges[i].start) {
+            abovePrimitives.push_back(axisEdges[i].primitive);
+        }
+    }
+    const double split = axisEdges[bestOffset].t;
+    std::vector<uint32_t>().swap(nodePrimitives);
+
+    AABB3D belowBox = nodeBox;
+    AABB3D aboveBox = nodeBox;
+    belowBox.max()[bestAxis] = split;
+    aboveBox.min()[bestAxis] = split;
+
+    buildNode(belowBox, belowPrimitives, depth - 1, badRefines, edges);
+    const uint32_t aboveChild = (uint32_t)nodes.size();
+    buildNode(aboveBox, abovePrimitives, depth - 1, badRefines, edges);
+
+    nodes[nodeIndex].split = split;
+    nodes[nodeIndex].offset = aboveChild;
+    nodes[nodeIndex].flags = (uint32_t)bestAxis;
+}
+
+/*
+* Turns nodes[nodeIndex] into a leaf referencing the given primitives
+*
+* @param nodeIndex The node to fill
+* @param nodePrimitives The primitives the leaf refers to
+*/
+void KdTree::makeLeaf(uint32_t nodeIndex, const std::vector<uint32_t>& nodePrimitives)
+{
+    KdTreeNode& node = nodes[nodeIndex];
+    node.split = 0;
+    node.offset = (uint32_t)primitiveIndices.size();
+    node.flags = KD_TREE_LEAF | ((uint32_t)nodePrimitives.size() << 2);
+    primitiveIndices.insert(primitiveIndices.end(), nodePrimitives.begin(), nodePrimitives.end());
+}
+
+/*
+* @return The node array, stored depth-first
+*/
+const std::vector<KdTreeNode>& KdTree::getNodes() const
+{
+    return nodes;
+}
+
+/*
+* @return The primitive indices referenced by the leaves
+*/
+const std::vector<uint32_t>& KdTree::getPrimitiveIndices() const
+{
+    return primitiveIndices;
+}
+
+/*
+* @return The bytes used by the nodes, the leaf references, the primitive pointers and the triangle packs
+*/
+size_t KdTree::memoryBytes() const
+{
+    return nodes.size() * sizeof(KdTreeNode) + primitiveIndices.size() * sizeof(uint32_t) + primitives.size() * sizeof(std::shared_ptr<Object>) + trianglePacks.memoryBytes();
+}
+
+/*
+* Generate a bounding box for the kd-tree
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return True if a bounding box exists, false otherwise
+*/
+bool KdTree::generateBoundingBox(AABB3D& output_box) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+    output_box = bounds;
+    return true;
+}
+
+/*
+* Clips a ray's parametric range to the tree's bounds
+*
+* @param start The ray's origin
+* @param invDir The reciprocal of the ray's direction
+* @param t_min The minimum t, raised to where the ray enters the bounds. Modified by function.
+* @param t_max The maximum t, lowered to where the ray leaves the bounds. Modified by function.
+*
+* @return True if the ray overlaps the bounds within [t_min, t_max]
+*/
+bool KdTree::clipToBounds(const Point3D& start, const double(&invDir)[3], double& t_min, double& t_max) const
+{
+    for (int a = 0; a < 3; a++) {
+        double t0 = (bounds.min()[a] - start[a]) * invDir[a];
+        double t1 = (bounds.max()[a] - start[a]) * invDir[a];
+        if (invDir[a] < 0) {
+            std::swap(t0, t1);
+        }
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_max < t_min) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+* Find the closest primitive a ray intersects by walking the tree front to back.
+* At every split the child on the ray origin's side is visited first and the other is pushed with the part of the ray
+* inside it; the walk stops as soon as the closest hit lies before the next pending region.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+int KdTree::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    double invDir[3]{ 1.0 / direction[0], 1.0 / direction[1], 1.0 / direction[2] };
+
+    double t_near = t_min;
+    double t_far = t_max;
+    if (nodes.empty() || !clipToBounds(start, invDir, t_near, t_far)) {
+        return 0;
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        double t_near;
+        double t_far;
+    };
+    StackEntry stack[KD_TREE_STACK_SIZE];
+    size_t stackSize = 0;
+    uint32_t current = 0;
+    double closest = t_max;
+    bool hit = false;
+
+    // Primitives straddling a split are referenced from several leaves; a small mailbox skips the ones this ray already tested
+    uint32_t mailbox[KD_TREE_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + KD_TREE_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    // Packed triangles only track the closest slot; its HitRecord is filled once the traversal is done
+    const bool packed = !trianglePacks.empty();
+    TrianglePackHit packHit;
+
+    while (true) {
+        // A hit in an earlier leaf may lie beyond that leaf; it is only final once no pending region starts before it
+        if (closest < t_near) {
+            break;
+        }
+        const KdTreeNode& node = nodes[current];
+        if (!node.isLeaf()) {
+            const uint32_t axis = node.axis();
+            const double t_plane = (node.split - start[axis]) * invDir[axis];
+            const bool belowFirst = start[axis] < node.split || (start[axis] == node.split && direction[axis] <= 0);
+            const uint32_t firstChild = belowFirst ? current + 1 : node.offset;
+            const uint32_t secondChild = belowFirst ? node.offset : current + 1;
+            if (t_plane > t_far || t_plane <= 0) {
+                current = firstChild;
+            }
+            else if (t_plane < t_near) {
+                current = secondChild;
+            }
+            else {
+                stack[stackSize++] = { secondChild, t_plane, t_far };
+                current = firstChild;
+                t_far = t_plane;
+            }
+            continue;
+        }
+
+        for (uint32_t i = node.offset; i < node.offset + node.primitiveCount(); i++) {
+            const uint32_t primitive = primitiveIndices[i];
+            if (mailbox[primitive % KD_TREE_MAILBOX_SIZE] == primitive) {
+                continue;
+            }
+            mailbox[primitive % KD_TREE_MAILBOX_SIZE] = primitive;
+            if (packed) {
+                hit |= trianglePacks.intersect(primitive, primitive + 1, start, direction, t_min, closest, packHit);
+            }
+            else if (primitives[primitive]->intersection(ray, t_min, closest, hitRecord)) {
+                hit = true;
+                closest = hitRecord.intT;
+            }
+        }
+
+        if (stackSize == 0) {
+            break;
+        }
+        stackSize--;
+        current = stack[stackSize].node;
+        t_near = stack[stackSize].t_near;
+        t_far = stack[stackSize].t_far;
+    }
+
+    if (hit && packed) {
+        static_cast<const Triangle&>(*primitives[packHit.slot]).makeHitRecord(ray, closest, packHit.u, packHit.v, hitRecord);
+    }
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any primitive blocks a ray within [t_min, t_max]. Stops at the first hit found.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any primitive is hit, false otherwise
+*/
+bool KdTree::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    double invDir[3]{ 1.0 / direction[0], 1.0 / direction[1], 1.0 / direction[2] };
+
+    double t_near = t_min;
+    double t_far = t_max;
+    if (nodes.empty() || !clipToBounds(start, invDir, t_near, t_far)) {
+        return false;
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        double t_near;
+        double t_far;
+    };
+    StackEntry stack[KD_TREE_STACK_SIZE];
+    size_t stackSize = 0;
+    uint32_t current = 0;
+
+    uint32_t mailbox[KD_TREE_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + KD_TREE_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    const bool packed = !trianglePacks.empty();
+
+    while (true) {
+        const KdTreeNode& node = nodes[current];
+        if (!node.isLeaf()) {
+            const uint32_t axis = node.axis();
+            const double t_plane = (node.split - start[axis]) * invDir[axis];
+            const bool belowFirst = start[axis] < node.split || (start[axis] == node.split && direction[axis] <= 0);
+            const uint32_t firstChild = belowFirst ? current + 1 : node.offset;
+            const uint32_t secondChild = belowFirst ? node.offset : current + 1;
+            if (t_plane > t_far || t_plane <= 0) {
+                current = firstChild;
+            }
+            else if (t_plane < t_near) {
+                current = secondChild;
+            }
+            else {
+                stack[stackSize++] = { secondChild, t_plane, t_far };
+                current = firstChild;
+                t_far = t_plane;
+            }
+            continue;
+        }
+
+        for (uint32_t i = node.offset; i < node.offset + node.primitiveCount(); i++) {
+            const uint32_t primitive = primitiveIndices[i];
+            if (mailbox[primitive % KD_TREE_MAILBOX_SIZE] == primitive) {
+                continue;
+            }
+            mailbox[primitive % KD_TREE_MAILBOX_SIZE] = primitive;
+            if (packed ? trianglePacks.occluded(primitive, primitive + 1, start, direction, t_min, t_max) : primitives[primitive]->occluded(ray, t_min, t_max)) {
+                return true;
+            }
+        }
+
+        if (stackSize == 0) {
+            break;
+        }
+        stackSize--;
+        current = stack[stackSize].node;
+        t_near = stack[stackSize].t_near;
+        t_far = stack[stackSize].t_far;
+    }
+
+    return false;
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& KdTree::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& KdTree::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& KdTree::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& KdTree::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D KdTree::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
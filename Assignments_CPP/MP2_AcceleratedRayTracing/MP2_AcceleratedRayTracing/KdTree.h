@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "SceneObject.h"
+#include "TriangleMesh.h"
+#include "TrianglePacks.h"
+
+constexpr double KD_TREE_TRAVERSAL_COST = 1.0;
+constexpr double KD_TREE_INTERSECTION_COST = 80.0;     // relative to one traversal step, as in pbrt
+constexpr double KD_TREE_EMPTY_BONUS = 0.5;            // a split leaving one side empty is this much cheaper
+constexpr size_t KD_TREE_MAX_LEAF_PRIMITIVES = 1;      // nodes this small always become leaves
+constexpr int KD_TREE_MAX_BAD_REFINES = 3;             // splits along one path that may raise the cost before giving up
+constexpr size_t KD_TREE_STACK_SIZE = 64;              // the tree is at most 8 + 1.3 log2(n) deep, which stays below this
+constexpr uint32_t KD_TREE_MAILBOX_SIZE = 8;          // primitives remembered per ray so straddling primitives are tested once
+constexpr uint32_t KD_TREE_LEAF = 3;                   // axis value marking a leaf
+
+// 16-byte kd-tree node. The below child of an interior node directly follows it; the above child is at offset.
+struct KdTreeNode {
+    double split;               // interior: position of the split plane
+    uint32_t offset;            // interior: index of the above child, leaf: index of the first primitive index
+    uint32_t flags;             // low 2 bits: split axis, or KD_TREE_LEAF; the remaining bits: leaf primitive count
+
+    uint32_t axis() const { return flags & 3; }
+    bool isLeaf() const { return axis() == KD_TREE_LEAF; }
+    uint32_t primitiveCount() const { return flags >> 2; }
+};
+
+static_assert(sizeof(KdTreeNode) == 16, "KdTreeNode must be 16 bytes");
+
+// A kd-tree over bounded primitives, built with the surface area heuristic over sorted bound edges (Wald and Havran 2006,
+// as in pbrt). Primitives straddling a split plane are referenced from both sides; a small per-ray mailbox keeps a ray from
+// testing the same primitive again in a later leaf.
+class KdTree :
+    public Object
+{
+private:
+    struct BoundEdge {
+        double t;
+        uint32_t primitive;
+        bool start;
+    };
+
+    std::vector<KdTreeNode> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<std::shared_ptr<Object>> primitives;
+    std::vector<AABB3D> primitiveBounds;        // only kept while building
+    TrianglePacks trianglePacks;    // in primitive order, empty unless every primitive is a Triangle
+    AABB3D bounds;
+
+    void build();
+    void buildNode(const AABB3D& nodeBox, std::vector<uint32_t>& nodePrimitives, int depth, int badRefines, std::vector<BoundEdge>(&edges)[3]);
+    void makeLeaf(uint32_t nodeIndex, const std::vector<uint32_t>& nodePrimitives);
+    bool clipToBounds(const Point3D& start, const double(&invDir)[3], double& t_min, double& t_max) const;
+
+public:
+    KdTree();
+    KdTree(const std::shared_ptr<TriangleMesh>& triangleMesh);
+    KdTree(const std::vector<std::shared_ptr<SceneObject>>& list);
+    KdTree(const std::vector<std::shared_ptr<Object>>& list);
+
+    const std::vector<KdTreeNode>& getNodes() const;
+    const std::vector<uint32_t>& getPrimitiveIndices() const;
+    size_t memoryBytes() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
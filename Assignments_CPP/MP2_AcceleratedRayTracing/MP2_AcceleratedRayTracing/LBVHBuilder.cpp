@@ -0,0 +1,260 @@
+#include "LBVHBuilder.h"
+
+/*
+* Constructor for LBVHBuilder
+*
+* @param pool The thread pool to run the build on
+*/
+LBVHBuilder::LBVHBuilder(ThreadPool& pool) : pool(pool) {}
+
+/*
+* Spreads the lowest 21 bits of a value out so that there are two zero bits between each of them
+*
+* @param v The value
+*
+* @return The spread value
+*/
+uint64_t LBVHBuilder::expandBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+/*
+* Computes the 63-bit Morton code of a point. Bits are interleaved as ...xyzxyz, so x holds the highest bit.
+*
+* @param normalizedPoint A point with every coordinate in [0, 1]
+*
+* @return The Morton code
+*/
+uint64_t LBVHBuilder::mortonCode(const Point3D& normalizedPoint)
+{
+    const double scale = (double)((1u << LBVH_MORTON_BITS_PER_AXIS) - 1);
+    uint64_t quantized[3];
+    for (int a = 0; a < 3; a++) {
+        double q = std::min(std::max(normalizedPoint[a] * scale, 0.0), scale);
+        quantized[a] = (uint64_t)q;
+    }
+    return (expandBits(quantized[0]) << 2) | (expandBits(quantized[1]) << 1) | expandBits(quantized[2]);
+}
+
+/*
+* Builds a LinearBVH over the primitives. Leaves hold a single primitive, so a subtree over n primitives always has 2n - 1 nodes,
+* which lets both children of a node be emitted concurrently into disjoint parts of the node array.
+*
+* @param primitives The primitives to build over
+* @param nodes The depth-first node array. Modified by function.
+* @param primitiveIndices The primitive indices referenced by the leaves. Modified by function.
+*/
+void LBVHBuilder::build(const std::vector<std::shared_ptr<Object>>& primitives, std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    if (primitives.empty()) {
+        return;
+    }
+
+    computeMortonCodes(primitives);
+    radixSort();
+
+    nodes.resize(2 * primitives.size() - 1);
+    primitiveIndices.resize(primitives.size());
+    emitSubtree(0, primitives.size(), 0, nodes, primitiveIndices);
+
+    primitiveBounds.clear();
+    primitiveBounds.shrink_to_fit();
+    mortonPrimitives.clear();
+    mortonPrimitives.shrink_to_fit();
+}
+
+/*
+* Computes the bounds of every primitive and the Morton code of its centroid, in parallel
+*
+* @param primitives The primitives to build over
+*/
+void LBVHBuilder::computeMortonCodes(const std::vector<std::shared_ptr<Object>>& primitives)
+{
+    size_t n = primitives.size();
+    primitiveBounds.resize(n);
+    mortonPrimitives.resize(n);
+
+    pool.parallelFor(0, n, LBVH_PARALLEL_GRAIN_SIZE, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            if (!primitives[i]->generateBoundingBox(primitiveBounds[i])) {
+                std::cerr << "No bounding box in LBVHBuilder.\n";
+            }
+        }
+    });
+
+    AABB3D centroidBox = EMPTY_BOUNDING_BOX;
+    for (size_t i = 0; i < n; i++) {
+        centroidBox.expand(primitiveBounds[i].centroid());
+    }
+    Vec3D extent = centroidBox.max() - centroidBox.min();
+
+    pool.parallelFor(0, n, LBVH_PARALLEL_GRAIN_SIZE, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            Point3D offset = primitiveBounds[i].centroid() - centroidBox.min();
+            for (int a = 0; a < 3; a++) {
+                offset[a] = extent[a] > 0 ? offset[a] / extent[a] : 0;
+            }
+            mortonPrimitives[i].code = mortonCode(offset);
+            mortonPrimitives[i].index = (uint32_t)i;
+        }
+    });
+}
+
+/*
+* Sorts the Morton primitives by code with a parallel least-significant-digit radix sort.
+* Every pass histograms and scatters disjoint chunks concurrently; passes whose digit is the same for every code are skipped.
+*/
+void LBVHBuilder::radixSort()
+{
+    size_t n = mortonPrimitives.size();
+    size_t chunkCount = std::max<size_t>(1, std::min(pool.getThreadCount() + 1, n / LBVH_PARALLEL_GRAIN_SIZE));
+    std::vector<MortonPrimitive> scratch(n);
+    std::vector<size_t> offsets(chunkCount * LBVH_RADIX_BUCKETS);
+    std::vector<MortonPrimitive>* source = &mortonPrimitives;
+    std::vector<MortonPrimitive>* destination = &scratch;
+
+    auto chunkStart = [&](size_t c) -> size_t { return c * n / chunkCount; };
+
+    for (size_t shift = 0; shift < 3 * LBVH_MORTON_BITS_PER_AXIS; shift += LBVH_RADIX_BITS) {
+        const uint64_t mask = LBVH_RADIX_BUCKETS - 1;
+        std::fill(offsets.begin(), offsets.end(), 0);
+
+        // Count the digits of every chunk
+        pool.parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                size_t* histogram = &offsets[c * LBVH_RADIX_BUCKETS];
+                for (size_t i = chunkStart(c); i < chunkStart(c + 1); i++) {
+                    histogram[((*source)[i].code >> shift) & mask]++;
+                }
+            }
+        });
+
+        // Turn the counts into scatter offsets, ordered by digit and then by chunk so the sort stays stable
+        size_t sum = 0;
+        bool trivialPass = false;
+        for (size_t d = 0; d < LBVH_RADIX_BUCKETS; d++) {
+            size_t digitTotal = 0;
+            for (size_t c = 0; c < chunkCount; c++) {
+                size_t count = offsets[c * LBVH_RADIX_BUCKETS + d];
+                offsets[c * LBVH_RADIX_BUCKETS + d] = sum;
+                sum += count;
+                digitTotal += count;
+            }
+            if (digitTotal == n) {
+                trivialPass = true;
+            }
+        }
+        if (trivialPass) {
+            continue;
+        }
+
+        pool.parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++) {
+                size_t* offset = &offsets[c * LBVH_RADIX_BUCKETS];
+                for (size_t i = chunkStart(c); i < chunkStart(c + 1); i++) {
+                    (*destination)[offset[((*source)[i].code >> shift) & mask]++] = (*source)[i];
+                }
+            }
+        });
+        std::swap(source, destination);
+    }
+
+    if (source != &mortonPrimitives) {
+        mortonPrimitives.swap(scratch);
+    }
+}
+
+/*
+* Finds where the highest bit that differs between the first and last code of a sorted range flips from 0 to 1
+*
+* @param start The left-bound index of the range
+* @param end The right-bound index of the range
+* @param axis The axis the differing bit belongs to. Modified by function.
+*
+* @return The index of the first primitive in the right half
+*/
+size_t LBVHBuilder::findSplit(size_t start, size_t end, int& axis) const
+{
+    uint64_t firstCode = mortonPrimitives[start].code;
+    uint64_t lastCode = mortonPrimitives[end - 1].code;
+
+    // Identical codes carry no spatial information, so just halve the range
+    if (firstCode == lastCode) {
+        axis = 0;
+        return start + (end - start) / 2;
+    }
+
+    uint64_t highestBit = firstCode ^ lastCode;
+    int bitIndex = 0;
+    while (highestBit >> 1) {
+        highestBit >>= 1;
+        bitIndex++;
+    }
+    highestBit <<= bitIndex;
+    axis = 2 - bitIndex % 3;
+
+    auto split = std::partition_point(mortonPrimitives.begin() + start, mortonPrimitives.begin() + end,
+        [highestBit](const MortonPrimitive& m) -> bool { return (m.code & highestBit) == 0; });
+    return split - mortonPrimitives.begin();
+}
+
+/*
+* Emits the subtree over the sorted primitives [start, end) at nodes[nodeIndex]. Large subtrees emit their left child on another thread.
+*
+* @param start The left-bound index of the primitives in the subtree
+* @param end The right-bound index of the primitives in the subtree
+* @param nodeIndex The depth-first position of the subtree's root
+* @param nodes The depth-first node array. Modified by function.
+* @param primitiveIndices The primitive indices referenced by the leaves. Modified by function.
+*
+* @return The bounding box of the subtree
+*/
+AABB3D LBVHBuilder::emitSubtree(size_t start, size_t end, uint32_t nodeIndex, std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices)
+{
+    LinearBVHNode& node = nodes[nodeIndex];
+    node.pad = 0;
+
+    if (end - start == 1) {
+        uint32_t primitive = mortonPrimitives[start].index;
+        primitiveIndices[start] = primitive;
+        node.offset = (uint32_t)start;
+        node.primitiveCount = 1;
+        node.axis = 0;
+        node.setBounds(primitiveBounds[primitive]);
+        return primitiveBounds[primitive];
+    }
+
+    int axis = 0;
+    size_t mid = findSplit(start, end, axis);
+    uint32_t leftIndex = nodeIndex + 1;
+    uint32_t rightIndex = nodeIndex + (uint32_t)(2 * (mid - start));
+
+    AABB3D leftBox;
+    AABB3D rightBox;
+    if (end - start >= LBVH_PARALLEL_SUBTREE_SIZE) {
+        std::future<void> leftTask = pool.submit([&] { leftBox = emitSubtree(start, mid, leftIndex, nodes, primitiveIndices); });
+        rightBox = emitSubtree(mid, end, rightIndex, nodes, primitiveIndices);
+        pool.wait(leftTask);
+    }
+    else {
+        leftBox = emitSubtree(start, mid, leftIndex, nodes, primitiveIndices);
+        rightBox = emitSubtree(mid, end, rightIndex, nodes, primitiveIndices);
+    }
+
+    AABB3D box = leftBox;
+    box.expand(rightBox);
+    node.offset = rightIndex;
+    node.primitiveCount = 0;
+    node.axis = (uint8_t)axis;
+    node.setBounds(box);
+    return box;
+}
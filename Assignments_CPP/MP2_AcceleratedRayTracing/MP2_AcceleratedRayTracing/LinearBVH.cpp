@@ -0,0 +1,757 @@
+#include "LinearBVH.h"
+#include "LBVHBuilder.h"
+#include "BVHBuildPrimitives.h"
+#include "SBVHBuilder.h"
+#include "BVHOptimizer.h"
+
+/*
+* Default constructor for LinearBVH (empty tree)
+*/
+LinearBVH::LinearBVH() : Object(ObjectType::LinearBVH), builtSAHCost(0) {}
+
+/*
+* Constructor for LinearBVH
+*
+* @param triangleMesh The TriangleMesh with which to build the BVH
+* @param params The split method and SAH costs to build with
+*/
+LinearBVH::LinearBVH(const std::shared_ptr<TriangleMesh>& triangleMesh, const BVHBuildParameters& params) : Object(ObjectType::LinearBVH)
+{
+    const std::vector<std::shared_ptr<Triangle>>& triangles = triangleMesh->getTriangles();
+    primitives.assign(triangles.begin(), triangles.end());
+    std::cout << "Objects to insert into BVH Tree: " << primitives.size() << std::endl;
+    build(params);
+    std::cout << std::endl << primitives.size() << " objects in BVH tree!" << std::endl;
+}
+
+/*
+* Constructor for LinearBVH
+*
+* @param list A list of SceneObjects to use to build the BVH
+* @param params The split method and SAH costs to build with
+*/
+LinearBVH::LinearBVH(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params) : Object(ObjectType::LinearBVH)
+{
+    primitives.assign(list.begin(), list.end());
+    std::cout << "Objects to insert into BVH: " << primitives.size() << std::endl;
+    build(params);
+    std::cout << std::endl << primitives.size() << " objects in BVH tree!" << std::endl;
+}
+
+/*
+* Constructor for LinearBVH
+*
+* @param list A list of Objects to use to build the BVH
+* @param params The split method and SAH costs to build with
+*/
+LinearBVH::LinearBVH(const std::vector<std::shared_ptr<Object>>& list, const BVHBuildParameters& params) : Object(ObjectType::LinearBVH), primitives(list)
+{
+    build(params);
+}
+
+/*
+* Constructor for LinearBVH from an already built node array, such as one loaded from a BVHCache. Nothing is rebuilt.
+*
+* @param list The primitives the leaves refer to
+* @param nodes The depth-first node array
+* @param primitiveIndices The primitive indices referenced by the leaves
+* @param params The split method and SAH costs the nodes were built with
+*/
+LinearBVH::LinearBVH(const std::vector<std::shared_ptr<Object>>& list, std::vector<LinearBVHNode>&& nodes, std::vector<uint32_t>&& primitiveIndices, const BVHBuildParameters& params)
+    : Object(ObjectType::LinearBVH), nodes(std::move(nodes)), primitiveIndices(std::move(primitiveIndices)), primitives(list), buildParameters(params)
+{
+    trianglePacks.build(primitives, this->primitiveIndices);
+    spherePacks.build(primitives, this->primitiveIndices);
+    builtSAHCost = sahCost(params);
+}
+
+/*
+* Builds the flattened node array over the primitives
+*
+* @param params The split method and SAH costs to build with
+*/
+void LinearBVH::build(const BVHBuildParameters& params)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    trianglePacks.clear();
+    spherePacks.clear();
+    buildParameters = params;
+    builtSAHCost = 0;
+    if (primitives.empty()) {
+        return;
+    }
+
+    if (params.splitMethod == BVHSplitMethod::LBVH) {
+        LBVHBuilder().build(primitives, nodes, primitiveIndices);
+    }
+    else if (params.splitMethod == BVHSplitMethod::SBVH) {
+        SBVHBuilder(primitives, params).build(nodes, primitiveIndices);
+    }
+    else {
+        // Cache every primitive's bounds once, the build only ever touches indices
+        BVHBuildPrimitives buildPrimitives(primitives, params);
+
+        // A binary tree over n primitives never has more than 2n - 1 nodes
+        nodes.reserve(2 * primitives.size() - 1);
+        buildRecursive(buildPrimitives, 0, primitives.size(), 0, params, nodes);
+        nodes.shrink_to_fit();
+        primitiveIndices.swap(buildPrimitives.indices);
+    }
+
+    if (params.optimizationSeconds > 0) {
+        optimize(params.optimizationSeconds);
+    }
+    trianglePacks.build(primitives, primitiveIndices);
+    spherePacks.build(primitives, primitiveIndices);
+    builtSAHCost = sahCost(params);
+}
+
+/*
+* Builds the subtree over indices[start, end), partitioning the indices in place and appending the nodes depth-first.
+* Subtrees above BVH_PARALLEL_BUILD_CUTOFF build their children concurrently into separate arrays which are then spliced in.
+*
+* @param buildPrimitives The cached primitive data and index array. Modified by function.
+* @param start The left-bound index of the primitives in the subtree
+* @param end The right-bound index of the primitives in the subtree
+* @param depth The depth of the subtree's root node
+* @param params The split method and SAH costs to build with
+* @param output The node array to append to. Modified by function.
+*
+* @return The index of the subtree's root node in output
+*/
+uint32_t LinearBVH::buildRecursive(BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, size_t depth, const BVHBuildParameters& params, std::vector<LinearBVHNode>& output) const
+{
+    AABB3D nodeBox;
+    AABB3D centroidBox;
+    buildPrimitives.rangeBounds(start, end, nodeBox, centroidBox);
+
+    uint32_t nodeIndex = (uint32_t)output.size();
+    output.push_back(LinearBVHNode());
+    output[nodeIndex].setBounds(nodeBox);
+    output[nodeIndex].pad = 0;
+
+    size_t span = end - start;
+    bool useSAH = params.splitMethod == BVHSplitMethod::SAH && depth < LINEAR_BVH_MAX_SAH_DEPTH;
+    bool fitsLeaf = span <= params.leafPrimitiveLimit();
+    auto makeLeaf = [&]() -> uint32_t {
+        output[nodeIndex].offset = (uint32_t)start;
+        output[nodeIndex].primitiveCount = (uint16_t)span;
+        output[nodeIndex].axis = 0;
+        return nodeIndex;
+    };
+    if (span == 1 || (fitsLeaf && !useSAH)) {
+        return makeLeaf();
+    }
+
+    // Split on the longest centroid axis at the median, unless the SAH finds something better.
+    // A range small enough for one leaf is only split if the SAH says the two children are cheaper than the leaf.
+    int axis = BVHBuildPrimitives::longestAxis(centroidBox);
+    size_t mid = start + span / 2;
+    if (useSAH && buildPrimitives.sahSplit(start, end, nodeBox, centroidBox, params, mid, axis)) {
+        if (fitsLeaf) {
+            AABB3D leftBox, rightBox, unusedBox;
+            buildPrimitives.rangeBounds(start, mid, leftBox, unusedBox);
+            buildPrimitives.rangeBounds(mid, end, rightBox, unusedBox);
+            double leftCost = buildPrimitives.rangeCost(start, mid);
+            double rightCost = buildPrimitives.rangeCost(mid, end);
+            double nodeArea = nodeBox.surfaceArea();
+            double splitCost = params.traversalCost
+                + (leftBox.surfaceArea() * (params.leafCost + leftCost) + rightBox.surfaceArea() * (params.leafCost + rightCost)) / nodeArea;
+            if (params.leafCost + leftCost + rightCost <= splitCost) {
+                return makeLeaf();
+            }
+        }
+    }
+    else if (fitsLeaf) {
+        return makeLeaf();
+    }
+    else {
+        mid = start + span / 2;
+        buildPrimitives.medianSplit(start, end, mid, axis);
+    }
+
+    output[nodeIndex].primitiveCount = 0;
+    output[nodeIndex].axis = (uint8_t)axis;
+
+    if (span < BVH_PARALLEL_BUILD_CUTOFF) {
+        buildRecursive(buildPrimitives, start, mid, depth + 1, params, output);
+        output[nodeIndex].offset = buildRecursive(buildPrimitives, mid, end, depth + 1, params, output);
+        return nodeIndex;
+    }
+
+    // Both halves own disjoint index ranges, so they can be split concurrently
+    std::vector<LinearBVHNode> leftNodes;
+    std::vector<LinearBVHNode> rightNodes;
+    std::future<void> leftTask = ThreadPool::global().submit([&] {
+        leftNodes.reserve(2 * (mid - start) - 1);
+        buildRecursive(buildPrimitives, start, mid, depth + 1, params, leftNodes);
+    });
+    rightNodes.reserve(2 * (end - mid) - 1);
+    buildRecursive(buildPrimitives, mid, end, depth + 1, params, rightNodes);
+    ThreadPool::global().wait(leftTask);
+
+    // Splice the children in after this node; leaf offsets index primitives and stay as they are
+    for (const std::vector<LinearBVHNode>* child : { &leftNodes, &rightNodes }) {
+        uint32_t base = (uint32_t)output.size();
+        for (const LinearBVHNode& node : *child) {
+            output.push_back(node);
+            if (node.primitiveCount == 0) {
+                output.back().offset += base;
+            }
+        }
+    }
+    output[nodeIndex].offset = nodeIndex + 1 + (uint32_t)leftNodes.size();
+    return nodeIndex;
+}
+
+/*
+* @return The flattened nodes, in depth-first order
+*/
+const std::vector<LinearBVHNode>& LinearBVH::getNodes() const
+{
+    return nodes;
+}
+
+/*
+* @return The primitive indices referenced by the leaves
+*/
+const std::vector<uint32_t>& LinearBVH::getPrimitiveIndices() const
+{
+    return primitiveIndices;
+}
+
+/*
+* @return The primitives stored in the BVH
+*/
+const std::vector<std::shared_ptr<Object>>& LinearBVH::getPrimitives() const
+{
+    return primitives;
+}
+
+/*
+* @return The split method and SAH costs the BVH was built with
+*/
+const BVHBuildParameters& LinearBVH::getBuildParameters() const
+{
+    return buildParameters;
+}
+
+/*
+* @return The leaf-ordered triangle packs, empty unless every primitive is a Triangle
+*/
+const TrianglePacks& LinearBVH::getTrianglePacks() const
+{
+    return trianglePacks;
+}
+
+/*
+* @return The leaf-ordered sphere packs, empty unless every primitive is a Sphere
+*/
+const SpherePacks& LinearBVH::getSpherePacks() const
+{
+    return spherePacks;
+}
+
+/*
+* @return The number of leaf references beyond one per primitive, added by spatial splits
+*/
+size_t LinearBVH::getDuplicatedReferences() const
+{
+    return primitiveIndices.size() > primitives.size() ? primitiveIndices.size() - primitives.size() : 0;
+}
+
+/*
+* Retrieve the bounding box of the whole BVH
+*
+* @param output_box The variable to hold the bounding box. Modified by function.
+*
+* @return False if the BVH is empty, true otherwise
+*/
+bool LinearBVH::generateBoundingBox(AABB3D& output_box) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+    output_box = nodes[0].getBounds();
+    return true;
+}
+
+/*
+* Computes the surface area heuristic cost of the BVH
+*
+* @param params The traversal, leaf and intersection costs
+*
+* @return The expected cost of tracing a ray which hits the root's bounding box
+*/
+double LinearBVH::sahCost(const BVHBuildParameters& params) const
+{
+    if (nodes.empty()) {
+        return 0;
+    }
+    return sahCostHelper(0, params);
+}
+
+/*
+* Helper method for recursive sahCost
+*
+* @param nodeIndex The index of the subtree's root node
+* @param params The traversal, leaf and intersection costs
+*
+* @return The SAH cost of the subtree
+*/
+double LinearBVH::sahCostHelper(uint32_t nodeIndex, const BVHBuildParameters& params) const
+{
+    const LinearBVHNode& node = nodes[nodeIndex];
+    if (node.primitiveCount > 0) {
+        double cost = params.leafCost;
+        for (uint32_t i = node.offset; i < node.offset + node.primitiveCount; i++) {
+            cost += params.intersectionCost(*primitives[primitiveIndices[i]]);
+        }
+        return cost;
+    }
+
+    auto area = [](const LinearBVHNode& n) -> double {
+        double dx = n.boundsMax[0] - n.boundsMin[0];
+        double dy = n.boundsMax[1] - n.boundsMin[1];
+        double dz = n.boundsMax[2] - n.boundsMin[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    };
+
+    double nodeArea = area(node);
+    double cost = params.traversalCost;
+    for (uint32_t child : { nodeIndex + 1, node.offset }) {
+        double ratio = nodeArea > 0 ? area(nodes[child]) / nodeArea : 1.0;
+        cost += ratio * sahCostHelper(child, params);
+    }
+    return cost;
+}
+
+/*
+* Recomputes every node's bounds bottom-up after the primitives have moved, keeping the tree's topology
+*/
+void LinearBVH::refit()
+{
+    if (!nodes.empty()) {
+        refitHelper(0, (uint32_t)nodes.size());
+        trianglePacks.build(primitives, primitiveIndices);
+        spherePacks.build(primitives, primitiveIndices);
+    }
+}
+
+/*
+* Lowers the SAH cost of the built tree by treelet restructuring (see BVHOptimizer). Leaves and the primitive order are kept,
+* only the interior nodes are rearranged. The result is dropped if it got too deep for the traversal stack.
+*
+* @param timeBudgetSeconds The wall-clock time the optimization may take
+*/
+void LinearBVH::optimize(double timeBudgetSeconds)
+{
+    if (nodes.empty()) {
+        return;
+    }
+    BVHOptimizer optimizer(*this, buildParameters);
+    optimizer.optimize(timeBudgetSeconds);
+
+    std::vector<LinearBVHNode> optimizedNodes;
+    if (optimizer.flatten(optimizedNodes) < LINEAR_BVH_STACK_SIZE) {
+        nodes.swap(optimizedNodes);
+    }
+    builtSAHCost = sahCost(buildParameters);
+}
+
+/*
+* Helper method for recursive refit. Large subtrees refit their first child on the thread pool.
+*
+* @param nodeIndex The index of the subtree's root node
+* @param subtreeEnd One past the index of the subtree's last node
+*
+* @return The new bounding box of the subtree
+*/
+AABB3D LinearBVH::refitHelper(uint32_t nodeIndex, uint32_t subtreeEnd)
+{
+    LinearBVHNode& node = nodes[nodeIndex];
+    AABB3D box = EMPTY_BOUNDING_BOX;
+
+    if (node.primitiveCount > 0) {
+        for (uint32_t i = node.offset; i < node.offset + node.primitiveCount; i++) {
+            AABB3D primitiveBox;
+            primitives[primitiveIndices[i]]->generateBoundingBox(primitiveBox);
+            box.expand(primitiveBox);
+        }
+    }
+    else if (subtreeEnd - nodeIndex >= LINEAR_BVH_PARALLEL_REFIT_NODES) {
+        AABB3D leftBox;
+        std::future<void> leftTask = ThreadPool::global().submit([&] { leftBox = refitHelper(nodeIndex + 1, node.offset); });
+        box = refitHelper(node.offset, subtreeEnd);
+        ThreadPool::global().wait(leftTask);
+        box.expand(leftBox);
+    }
+    else {
+        box = refitHelper(nodeIndex + 1, node.offset);
+        box.expand(refitHelper(node.offset, subtreeEnd));
+    }
+
+    node.setBounds(box);
+    return box;
+}
+
+/*
+* Refits the BVH after its primitives have moved, and rebuilds it from scratch if the refit tree has degraded too far
+*
+* @param rebuildThreshold The factor by which the SAH cost may grow over the cost of the last build before rebuilding
+*
+* @return True if the BVH was rebuilt, false if a refit was enough
+*/
+bool LinearBVH::update(double rebuildThreshold)
+{
+    refit();
+    double cost = sahCost(buildParameters);
+    if (cost <= builtSAHCost * rebuildThreshold) {
+        return false;
+    }
+    build(buildParameters);
+    return true;
+}
+
+/*
+* Find the closest primitive a ray intersects by walking the node array front to back.
+* Both children of a node are slab-tested together; the nearer one is visited next and the farther one is pushed
+* with its entry distance, so it is dropped without being fetched again if a closer hit turns up first.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+int LinearBVH::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    size_t nodeVisits = 0;
+    return intersection(ray, t_min, t_max, hitRecord, nodeVisits);
+}
+
+/*
+* Find the closest primitive a ray intersects, counting the nodes the traversal visits
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+* @param nodeVisits The number of nodes visited, incremented by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+int LinearBVH::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord, size_t& nodeVisits) const
+{
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    TraversalRay traversalRay(ray, t_min, t_max);
+
+    double t_entry = 0;
+    if (nodes.empty() || !traversalRay.hitBox(nodes[0].boundsMin, nodes[0].boundsMax, t_entry)) {
+        return 0;
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        double t_entry;
+    };
+    StackEntry stack[LINEAR_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    uint32_t current = 0;
+    double& closest = traversalRay.tMax;
+    bool hit = false;
+
+    // Spatial splits put a primitive in several leaves; a small mailbox skips the ones this ray already tested
+    const bool dedupe = primitiveIndices.size() > primitives.size();
+    uint32_t mailbox[LINEAR_BVH_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + LINEAR_BVH_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    // Packed triangle leaves only track the closest slot; its HitRecord is filled once the traversal is done
+    const bool packed = !trianglePacks.empty();
+    const bool spherePacked = !spherePacks.empty();
+    TrianglePackHit packHit;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        nodeVisits++;
+        if (node.primitiveCount > 0 && packed && !dedupe) {
+            hit |= trianglePacks.intersect(node.offset, node.offset + node.primitiveCount, start, direction, t_min, closest, packHit);
+        }
+        else if (node.primitiveCount > 0 && spherePacked && !dedupe) {
+            hit |= spherePacks.intersect(node.offset, node.offset + node.primitiveCount, ray, t_min, closest, hitRecord);
+        }
+        else if (node.primitiveCount > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.primitiveCount; i++) {
+                const uint32_t primitive = primitiveIndices[i];
+                if (dedupe) {
+                    if (mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] == primitive) {
+                        continue;
+                    }
+                    mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] = primitive;
+                }
+                if (packed) {
+                    hit |= trianglePacks.intersect(i, i + 1, start, direction, t_min, closest, packHit);
+                }
+                else if (primitives[primitive]->intersection(ray, t_min, closest, hitRecord)) {
+                    hit = true;
+                    closest = hitRecord.intT;
+                }
+            }
+        }
+        else {
+            uint32_t nearChild = current + 1;
+            uint32_t farChild = node.offset;
+            double t_near = 0;
+            double t_far = 0;
+            bool hitNear = traversalRay.hitBox(nodes[nearChild].boundsMin, nodes[nearChild].boundsMax, t_near);
+            bool hitFar = traversalRay.hitBox(nodes[farChild].boundsMin, nodes[farChild].boundsMax, t_far);
+            if (hitNear && hitFar) {
+                if (t_far < t_near) {
+                    std::swap(nearChild, farChild);
+                    std::swap(t_near, t_far);
+                }
+                stack[stackSize++] = { farChild, t_far };
+                current = nearChild;
+                continue;
+            }
+            if (hitNear || hitFar) {
+                current = hitNear ? nearChild : farChild;
+                continue;
+            }
+        }
+
+        // Pop the next subtree the ray can still reach before the closest hit
+        while (stackSize > 0 && stack[stackSize - 1].t_entry > closest) {
+            stackSize--;
+        }
+        if (stackSize == 0) {
+            break;
+        }
+        current = stack[--stackSize].node;
+    }
+
+    if (hit && packed) {
+        static_cast<const Triangle&>(*primitives[primitiveIndices[packHit.slot]]).makeHitRecord(ray, closest, packHit.u, packHit.v, hitRecord);
+    }
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any primitive blocks a ray within [t_min, t_max]. Stops at the first hit found, in no particular order.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any primitive is hit, false otherwise
+*/
+bool LinearBVH::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    const TraversalRay traversalRay(ray, t_min, t_max);
+
+    uint32_t stack[LINEAR_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    const bool dedupe = primitiveIndices.size() > primitives.size();
+    uint32_t mailbox[LINEAR_BVH_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + LINEAR_BVH_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    const bool packed = !trianglePacks.empty();
+    const bool spherePacked = !spherePacks.empty();
+
+    while (stackSize > 0) {
+        const uint32_t current = stack[--stackSize];
+        const LinearBVHNode& node = nodes[current];
+        double t_entry;
+        if (!traversalRay.hitBox(node.boundsMin, node.boundsMax, t_entry)) {
+            continue;
+        }
+        if (node.primitiveCount > 0 && packed) {
+            // Testing a duplicated reference twice cannot change an any-hit answer, so packed leaves skip the mailbox
+            if (trianglePacks.occluded(node.offset, node.offset + node.primitiveCount, start, direction, t_min, t_max)) {
+                return true;
+            }
+        }
+        else if (node.primitiveCount > 0 && spherePacked) {
+            if (spherePacks.occluded(node.offset, node.offset + node.primitiveCount, ray, t_min, t_max)) {
+                return true;
+            }
+        }
+        else if (node.primitiveCount > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.primitiveCount; i++) {
+                const uint32_t primitive = primitiveIndices[i];
+                if (dedupe) {
+                    if (mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] == primitive) {
+                        continue;
+                    }
+                    mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] = primitive;
+                }
+                if (primitives[primitive]->occluded(ray, t_min, t_max)) {
+                    return true;
+                }
+            }
+        }
+        else {
+            stack[stackSize++] = node.offset;
+            stack[stackSize++] = current + 1;
+        }
+    }
+
+    return false;
+}
+
+/*
+* Finds the closest primitive for every ray of a packet in one traversal. A node is first culled for the whole packet
+* with interval arithmetic; when that fails, the rays are tested one by one from the first active one, and the rays
+* before the first that hits are dropped for the whole subtree (ranged traversal, Overbeck et al. 2008). As the rays
+* diverge the active range shrinks, until the packet is traversed like its last ray alone. Incoherent packets are
+* traced one ray at a time.
+*
+* @param packet The RayPacket. Each ray's tMax is lowered to its closest hit, and its hit flag set. Modified by function.
+* @param hitRecords One HitRecord per ray, filled for the rays that hit a primitive. Modified by function.
+*
+* @return The number of rays that hit a primitive
+*/
+int LinearBVH::intersectPacket(RayPacket& packet, HitRecord* hitRecords) const
+{
+    int hitCount = 0;
+    if (nodes.empty() || packet.size == 0) {
+        return 0;
+    }
+    if (!packet.coherent) {
+        for (size_t r = 0; r < packet.size; r++) {
+            TraversalRay& traversalRay = packet.traversalRays[r];
+            if (intersection(packet.rays[r], traversalRay.tMin, traversalRay.tMax, hitRecords[r])) {
+                packet.hit[r] = true;
+                traversalRay.tMax = hitRecords[r].intT;
+                hitCount++;
+            }
+        }
+        return hitCount;
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        uint32_t firstRay;
+    };
+    StackEntry stack[LINEAR_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = { 0, 0 };
+
+    // The packet's t-interval, for the interval arithmetic cull
+    double packetTMin = packet.traversalRays[0].tMin;
+    double packetTMax = packet.traversalRays[0].tMax;
+    for (size_t r = 1; r < packet.size; r++) {
+        packetTMin = std::min(packetTMin, packet.traversalRays[r].tMin);
+        packetTMax = std::max(packetTMax, packet.traversalRays[r].tMax);
+    }
+
+    const bool packed = !trianglePacks.empty();
+    const bool spherePacked = !spherePacks.empty();
+    TrianglePackHit packHits[RAY_PACKET_MAX_RAYS];
+
+    while (stackSize > 0) {
+        const StackEntry entry = stack[--stackSize];
+        const LinearBVHNode& node = nodes[entry.node];
+        if (packet.missesBox(node.boundsMin, node.boundsMax, packetTMin, packetTMax)) {
+            continue;
+        }
+
+        // The first active ray that hits the node, the ones before it can't hit anything below it
+        uint32_t first = entry.firstRay;
+        double t_entry = 0;
+        while (first < packet.size && !packet.traversalRays[first].hitBox(node.boundsMin, node.boundsMax, t_entry)) {
+            first++;
+        }
+        if (first == packet.size) {
+            continue;
+        }
+
+        if (node.primitiveCount == 0) {
+            // Visit the nearer child first, as seen by the first active ray
+            uint32_t nearChild = entry.node + 1;
+            uint32_t farChild = node.offset;
+            if (packet.traversalRays[first].sign[node.axis]) {
+                std::swap(nearChild, farChild);
+            }
+            stack[stackSize++] = { farChild, first };
+            stack[stackSize++] = { nearChild, first };
+            continue;
+        }
+
+        for (uint32_t r = first; r < packet.size; r++) {
+            TraversalRay& traversalRay = packet.traversalRays[r];
+            if (r > first && !traversalRay.hitBox(node.boundsMin, node.boundsMax, t_entry)) {
+                continue;
+            }
+            const Ray3D& ray = packet.rays[r];
+            if (packed) {
+                packet.hit[r] |= trianglePacks.intersect(node.offset, node.offset + node.primitiveCount, ray.getStart(), ray.getDirection(), traversalRay.tMin, traversalRay.tMax, packHits[r]);
+            }
+            else if (spherePacked) {
+                packet.hit[r] |= spherePacks.intersect(node.offset, node.offset + node.primitiveCount, ray, traversalRay.tMin, traversalRay.tMax, hitRecords[r]);
+            }
+            else {
+                for (uint32_t i = node.offset; i < node.offset + node.primitiveCount; i++) {
+                    if (primitives[primitiveIndices[i]]->intersection(ray, traversalRay.tMin, traversalRay.tMax, hitRecords[r])) {
+                        packet.hit[r] = true;
+                        traversalRay.tMax = hitRecords[r].intT;
+                    }
+                }
+            }
+        }
+        packetTMax = packet.traversalRays[0].tMax;
+        for (size_t r = 1; r < packet.size; r++) {
+            packetTMax = std::max(packetTMax, packet.traversalRays[r].tMax);
+        }
+    }
+
+    for (size_t r = 0; r < packet.size; r++) {
+        if (!packet.hit[r]) {
+            continue;
+        }
+        if (packed) {
+            static_cast<const Triangle&>(*primitives[primitiveIndices[packHits[r].slot]]).makeHitRecord(packet.rays[r], packet.traversalRays[r].tMax, packHits[r].u, packHits[r].v, hitRecords[r]);
+        }
+        hitCount++;
+    }
+    return hitCount;
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& LinearBVH::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& LinearBVH::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& LinearBVH::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& LinearBVH::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D LinearBVH::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "BVHNode.h"
+#include "TrianglePacks.h"
+#include "SpherePacks.h"
+#include "RayPacket.h"
+#include "TraversalRay.h"
+
+constexpr size_t LINEAR_BVH_STACK_SIZE = 128;     // LBVH trees are at most 63 Morton bits + 32 halvings of identical codes deep
+constexpr size_t LINEAR_BVH_MAX_SAH_DEPTH = 32;   // below this depth only median splits are made, which bounds the tree depth by the stack size
+constexpr size_t LINEAR_BVH_PARALLEL_REFIT_NODES = 8192;      // subtrees with fewer nodes are refit on the current thread
+constexpr double DEFAULT_BVH_REBUILD_THRESHOLD = 1.5;         // rebuild once a refit tree's SAH cost exceeds its built cost by this factor
+constexpr uint32_t LINEAR_BVH_MAILBOX_SIZE = 8;               // primitives remembered per ray so spatial-split duplicates are tested once
+
+// 32-byte node of a flattened BVH, stored depth-first so the first child of an interior node directly follows it
+struct LinearBVHNode {
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t offset;            // leaf: index of the first primitive index, interior: index of the second child
+    uint16_t primitiveCount;    // 0 for interior nodes
+    uint8_t axis;               // split axis of interior nodes
+    uint8_t pad;
+
+    /*
+    * Stores a box in the node's float bounds, rounding outward so the node never shrinks
+    *
+    * @param box The bounding box
+    */
+    void setBounds(const AABB3D& box) {
+        for (int a = 0; a < 3; a++) {
+            float lo = (float)box.min()[a];
+            float hi = (float)box.max()[a];
+            boundsMin[a] = ((double)lo > box.min()[a]) ? std::nextafter(lo, -std::numeric_limits<float>::infinity()) : lo;
+            boundsMax[a] = ((double)hi < box.max()[a]) ? std::nextafter(hi, std::numeric_limits<float>::infinity()) : hi;
+        }
+    }
+
+    /*
+    * @return The node's bounds as a double-precision AABB3D
+    */
+    AABB3D getBounds() const {
+        return AABB3D(Point3D(boundsMin[0], boundsMin[1], boundsMin[2]), Point3D(boundsMax[0], boundsMax[1], boundsMax[2]));
+    }
+};
+
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must be 32 bytes");
+
+struct BVHBuildPrimitives;
+
+class LinearBVH :
+    public Object
+{
+private:
+    std::vector<LinearBVHNode> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<std::shared_ptr<Object>> primitives;
+    TrianglePacks trianglePacks;    // leaf-ordered copy of the triangles, empty unless every primitive is a Triangle
+    SpherePacks spherePacks;        // leaf-ordered copy of the spheres, empty unless every primitive is a Sphere
+
+    BVHBuildParameters buildParameters;
+    double builtSAHCost;
+
+    void build(const BVHBuildParameters& params);
+    uint32_t buildRecursive(BVHBuildPrimitives& buildPrimitives, size_t start, size_t end, size_t depth, const BVHBuildParameters& params, std::vector<LinearBVHNode>& output) const;
+    double sahCostHelper(uint32_t nodeIndex, const BVHBuildParameters& params) const;
+    AABB3D refitHelper(uint32_t nodeIndex, uint32_t subtreeEnd);
+
+public:
+    LinearBVH();
+    LinearBVH(const std::shared_ptr<TriangleMesh>& triangleMesh, const BVHBuildParameters& params = BVHBuildParameters());
+    LinearBVH(const std::vector<std::shared_ptr<SceneObject>>& list, const BVHBuildParameters& params = BVHBuildParameters());
+    LinearBVH(const std::vector<std::shared_ptr<Object>>& list, const BVHBuildParameters& params = BVHBuildParameters());
+    LinearBVH(const std::vector<std::shared_ptr<Object>>& list, std::vector<LinearBVHNode>&& nodes, std::vector<uint32_t>&& primitiveIndices, const BVHBuildParameters& params);
+
+    const std::vector<LinearBVHNode>& getNodes() const;
+    const std::vector<uint32_t>& getPrimitiveIndices() const;
+    const std::vector<std::shared_ptr<Object>>& getPrimitives() const;
+    const BVHBuildParameters& getBuildParameters() const;
+    const TrianglePacks& getTrianglePacks() const;
+    const SpherePacks& getSpherePacks() const;
+    size_t getDuplicatedReferences() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+    double sahCost(const BVHBuildParameters& params) const;
+
+    void optimize(double timeBudgetSeconds);
+    void refit();
+    bool update(double rebuildThreshold = DEFAULT_BVH_REBUILD_THRESHOLD);
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord, size_t& nodeVisits) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+    int intersectPacket(RayPacket& packet, HitRecord* hitRecords) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
@@ -3,8 +3,10 @@
 #include <fstream>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 
 #include "World.h"
+#include "AllocationCounter.h"
 #include "TriangleMesh.h"
 
 #define PI 3.14159265
@@ -68,9 +70,13 @@
 //
 //}
 
-void perspectiveTest() {
+void perspectiveTest(bool useBVH = false) {
     // SETUP WORLD
     World world;
+    if (useBVH) {
+        world.addRenderOption(RenderOption::BVH);
+        world.addRenderOption(RenderOption::BVH_SAH);
+    }
     int rows = 500;
     int cols = 500;
     double width = 2.0;  // higher value = zoom out, lower value = zoom in
@@ -184,6 +190,7 @@ void sphereTest(int sphereCount=10) {
     world.addLightSource(std::shared_ptr<LightSource>(new PointLightSource(Point3D(-12, 20, 2), WHITE_COLOR, WHITE_COLOR)));
 
     //world.addRenderOption(RenderOption::BVH);
+    //world.addRenderOption(RenderOption::TWO_LEVEL_GRID);    // traced through a grid instead, together with BVH
 
     // RENDER
     std::cout << "Rendering ...\n" << std::endl;
@@ -193,9 +200,8 @@ void sphereTest(int sphereCount=10) {
     im.writeToFile(filepath);
 }
 
-void objTest(const std::string& objFilepath) {
+void setupObjWorld(World& world, const std::string& objFilepath, bool useBVHCache = false) {
     // SETUP WORLD    
-    World world;
     int rows = 500;
     int cols = 500;
     double width = 1.0;  // higher value = zoom out, lower value = zoom in
@@ -217,10 +223,25 @@ void objTest(const std::string& objFilepath) {
 
     // BUILD WORLD
     std::shared_ptr<TriangleMesh> tm{ new TriangleMesh };
-    tm->loadFromOBJFile(objFilepath);
-    world.setTriangleMesh(tm);
+    if (useBVHCache) {
+        // Reuse the parsed mesh and its optimized SAH BVH from an earlier run if the OBJ file hasn't changed
+        BVHBuildParameters params = world.getBVHBuildParameters();
+        params.splitMethod = BVHSplitMethod::SAH;
+        params.optimizationSeconds = DEFAULT_BVH_OPTIMIZATION_SECONDS;
+        world.setTriangleMesh(tm, BVHCache(objFilepath, params).loadOrBuild(tm));
+        world.addRenderOption(RenderOption::TRIANGLE_MESH);
+    }
+    else {
+        tm->loadFromOBJFile(objFilepath);
+        world.setTriangleMesh(tm);
+    }
 
     world.addLightSource(std::shared_ptr<LightSource>(new PointLightSource(Point3D(-12, -30, 12), WHITE_COLOR, WHITE_COLOR)));
+}
+
+void objTest(const std::string& objFilepath, bool useBVHCache = false) {
+    World world;
+    setupObjWorld(world, objFilepath, useBVHCache);
 
     //world.addRenderOption(RenderOption::TRIANGLE_MESH);
 
@@ -232,6 +253,547 @@ void objTest(const std::string& objFilepath) {
     im.writeToFile(filepath);
 }
 
+// Renders a mesh once per acceleration structure, and prints the build and trace times side by side
+void bvhBenchmark(const std::string& objFilepath) {
+    const std::vector<std::pair<std::string, std::vector<RenderOption>>> configurations{
+        { "SAH", { RenderOption::BVH_SAH } },
+        { "LBVH", { RenderOption::LBVH } },
+        { "SAH+BVH4", { RenderOption::BVH_SAH, RenderOption::BVH4 } },
+        { "SAH+BVH8", { RenderOption::BVH_SAH, RenderOption::BVH8 } },
+        { "SAH+COMPRESSED", { RenderOption::BVH_SAH, RenderOption::COMPRESSED_BVH } },
+        { "SAH+OPT", { RenderOption::BVH_SAH, RenderOption::OPTIMIZE_BVH } },
+        { "LBVH+OPT", { RenderOption::LBVH, RenderOption::OPTIMIZE_BVH } },
+    };
+    std::vector<double> buildSeconds;
+    std::vector<double> traceSeconds;
+    std::vector<BVHStatistics> statistics;
+
+    for (const auto& configuration : configurations) {
+        World world;
+        setupObjWorld(world, objFilepath);
+        world.addRenderOption(RenderOption::TRIANGLE_MESH);
+        for (const RenderOption& option : configuration.second) {
+            world.addRenderOption(option);
+        }
+        world.setBVHStatisticsFilepath(objFilepath.substr(0, objFilepath.size() - 4) + "_" + configuration.first + "_bvh.json");
+        world.render();
+        buildSeconds.push_back(world.getBVHConstructionSeconds());
+        traceSeconds.push_back(world.getRayTracingSeconds());
+        statistics.push_back(world.getBVHStatistics());
+    }
+
+    std::cout << std::endl << "BVH Benchmark: " << objFilepath << std::endl;
+    std::cout << "Structure\tBuild (s)\tTrace (s)\tSAH Cost\tMax Depth\tOverlap\tMemory (bytes)" << std::endl;
+    for (size_t i = 0; i < configurations.size(); i++) {
+        std::cout << configurations[i].first << "\t" << buildSeconds[i] << "\t" << traceSeconds[i] << "\t" << statistics[i].sahCost << "\t"
+            << statistics[i].maxDepth << "\t" << statistics[i].meanSiblingOverlap << "\t" << statistics[i].memoryBytes << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// Renders a mesh spinning about the y-axis, refitting the BVH between frames instead of rebuilding it
+void turntableTest(const std::string& objFilepath, int frameCount = 8) {
+    World world;
+    setupObjWorld(world, objFilepath);
+    world.addRenderOption(RenderOption::TRIANGLE_MESH);
+    world.addRenderOption(RenderOption::BVH_SAH);
+    world.addRenderOption(RenderOption::REFIT_BVH);
+
+    const std::shared_ptr<TriangleMesh>& tm = world.getTriangleMesh();
+    for (int frame = 0; frame < frameCount; frame++) {
+        if (frame > 0) {
+            tm->addTransformation(Mat4().fromRotation(2 * PI / frameCount, Vec3D(0, 1, 0)), Transformation::ROTATE);
+            tm->applyModelViewMatrix();
+        }
+        Image im{ world.render() };
+        std::cout << "Frame " << frame << ": BVH update took " << world.getBVHConstructionSeconds() << " seconds." << std::endl;
+        im.writeToFile(objFilepath.substr(0, objFilepath.size() - 4) + "Turntable" + std::to_string(frame) + ".ppm");
+    }
+}
+
+// Compares the plain SAH tree with a spatial-split tree over a mesh standing on a large ground quad, counting node visits of every camera ray
+void sbvhBenchmark(const std::string& objFilepath, double spatialSplitBudget = DEFAULT_SBVH_MEMORY_BUDGET) {
+    World world;
+    setupObjWorld(world, objFilepath);
+
+    const std::vector<std::shared_ptr<Triangle>> triangles = world.getTriangleMesh()->getTriangles();
+    std::vector<std::shared_ptr<Object>> primitives(triangles.begin(), triangles.end());
+    const Point3D ground[4]{ Point3D(-50, -1, 50), Point3D(50, -1, 50), Point3D(50, -1, -50), Point3D(-50, -1, -50) };
+    const Point3D groundTriangles[2][3]{ { ground[0], ground[1], ground[2] }, { ground[0], ground[2], ground[3] } };
+    for (const auto& vertices : groundTriangles) {
+        primitives.push_back(std::make_shared<Triangle>(vertices));
+    }
+
+    BVHBuildParameters sahParameters(BVHSplitMethod::SAH);
+    BVHBuildParameters sbvhParameters(BVHSplitMethod::SBVH);
+    sbvhParameters.spatialSplitBudget = spatialSplitBudget;
+    LinearBVH sah(primitives, sahParameters);
+    LinearBVH sbvh(primitives, sbvhParameters);
+
+    Camera& camera = world.getCamera();
+    camera.ready();
+    size_t rayCount = 0;
+    size_t sahVisits = 0;
+    size_t sbvhVisits = 0;
+    for (int i = 0; i < camera.getViewWindowRows(); i++) {
+        for (int j = 0; j < camera.getViewWindowCols(); j++) {
+            Point3D start;
+            Vec3D direction;
+            camera.getRay(i, j, 0.5, 0.5, start, direction);
+            Ray3D ray{ start, direction };
+            HitRecord hitRecord;
+            sah.intersection(ray, 0, MAX_T, hitRecord, sahVisits);
+            sbvh.intersection(ray, 0, MAX_T, hitRecord, sbvhVisits);
+            rayCount++;
+        }
+    }
+
+    std::cout << std::endl << "SBVH Benchmark: " << objFilepath << " (" << primitives.size() << " primitives)" << std::endl;
+    std::cout << "Duplicated references: " << sbvh.getDuplicatedReferences() << std::endl;
+    std::cout << "Nodes: SAH " << sah.getNodes().size() << ", SBVH " << sbvh.getNodes().size() << std::endl;
+    std::cout << "SAH cost: SAH " << sah.sahCost(sahParameters) << ", SBVH " << sbvh.sahCost(sbvhParameters) << std::endl;
+    std::cout << "Node visits per ray: SAH " << (double)sahVisits / rayCount << ", SBVH " << (double)sbvhVisits / rayCount
+        << " (" << (double)((long long)sahVisits - (long long)sbvhVisits) / rayCount << " saved)" << std::endl << std::endl;
+}
+
+// Traces one primary ray through the center of every pixel of a camera against an acceleration structure
+//
+// @return The number of rays traced per second
+double traceCameraRays(const Object& accelerator, Camera& camera) {
+    camera.ready();
+    auto trace_start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < camera.getViewWindowRows(); i++) {
+        for (int j = 0; j < camera.getViewWindowCols(); j++) {
+            Point3D start;
+            Vec3D direction;
+            camera.getRay(i, j, 0.5, 0.5, start, direction);
+            Ray3D ray{ start, direction };
+            HitRecord hitRecord;
+            accelerator.intersection(ray, 0, MAX_T, hitRecord);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - trace_start_time).count();
+    return (double)camera.getViewWindowRows() * camera.getViewWindowCols() / seconds;
+}
+
+// The camera of sphereTest, looking into the box the spheres are scattered in
+Camera sphereFieldCamera() {
+    int rows = 500;
+    int cols = 500;
+    double width = 3.0;
+    Camera camera;
+    camera.setPosition({ 0,0,0 });
+    camera.setViewWindowPosition(Point3D(0, 0, -1));
+    camera.setUpVector(Vec3D(0, 1, 0));
+    camera.setViewWindowRows(rows);
+    camera.setViewWindowCols(cols);
+    camera.setPixelSize(width / rows);
+    camera.setProjectionType(ProjectionType::PERSPECTIVE);
+    camera.setWorldPosition({ 0,0,0 });
+    return camera;
+}
+
+// The spheres of sphereTest, radius 0.2 and scattered uniformly in [-10, 10] x [-10, 10] x [-10, -5]
+std::vector<std::shared_ptr<Object>> sphereField(int sphereCount) {
+    Point3D lowerLimit{ -10, -10, -10 };
+    Point3D upperLimit{ 10, 10, -5 };
+    std::vector<std::shared_ptr<Object>> spheres;
+    for (int i = 0; i < sphereCount; i++) {
+        spheres.push_back(std::make_shared<Sphere>(Arithmetic::randomVec3D(lowerLimit, upperLimit), 0.2, WHITE_COLOR, WHITE_COLOR, WHITE_COLOR));
+    }
+    return spheres;
+}
+
+// Builds a SAH LinearBVH and a kd-tree over the same primitives, and prints the build time, memory and camera rays per second of each
+void compareKdTree(const std::string& sceneName, const std::vector<std::shared_ptr<Object>>& primitives, Camera& camera) {
+    auto bvh_start_time = std::chrono::high_resolution_clock::now();
+    LinearBVH bvh(primitives, BVHBuildParameters(BVHSplitMethod::SAH));
+    auto kd_start_time = std::chrono::high_resolution_clock::now();
+    KdTree kdTree(primitives);
+    auto kd_finish_time = std::chrono::high_resolution_clock::now();
+    double bvhSeconds = std::chrono::duration<double>(kd_start_time - bvh_start_time).count();
+    double kdSeconds = std::chrono::duration<double>(kd_finish_time - kd_start_time).count();
+
+    double bvhRaysPerSecond = traceCameraRays(bvh, camera);
+    double kdRaysPerSecond = traceCameraRays(kdTree, camera);
+
+    std::cout << std::endl << "kd-tree Benchmark: " << sceneName << " (" << primitives.size() << " primitives)" << std::endl;
+    std::cout << "Build seconds: BVH " << bvhSeconds << ", kd-tree " << kdSeconds << std::endl;
+    std::cout << "Memory bytes: BVH " << BVHStatistics(bvh, bvh.getBuildParameters()).memoryBytes << ", kd-tree " << kdTree.memoryBytes() << std::endl;
+    std::cout << "Nodes: BVH " << bvh.getNodes().size() << ", kd-tree " << kdTree.getNodes().size() << " (" << kdTree.getPrimitiveIndices().size() << " references)" << std::endl;
+    std::cout << "Rays per second: BVH " << bvhRaysPerSecond << ", kd-tree " << kdRaysPerSecond << std::endl << std::endl;
+}
+
+// Compares the kd-tree against the SAH BVH on two meshes and on a field of random spheres
+void kdTreeBenchmark(const std::string& teapotFilepath, const std::string& dragonFilepath, int sphereCount = 10000) {
+    for (const std::string& objFilepath : { teapotFilepath, dragonFilepath }) {
+        World world;
+        setupObjWorld(world, objFilepath);
+        const std::vector<std::shared_ptr<Triangle>> triangles = world.getTriangleMesh()->getTriangles();
+        compareKdTree(objFilepath, std::vector<std::shared_ptr<Object>>(triangles.begin(), triangles.end()), world.getCamera());
+    }
+
+    Camera camera = sphereFieldCamera();
+    compareKdTree("spheres" + std::to_string(sphereCount), sphereField(sphereCount), camera);
+}
+
+// Compares the build and trace times of the grids against the SAH BVH and the LBVH on the sphere field of sphereTest.
+// The grid is rebuilt a second time in place, as a scene of moving spheres would every frame.
+void gridBenchmark(int sphereCount = 100000) {
+    std::vector<std::shared_ptr<Object>> spheres = sphereField(sphereCount);
+    Camera camera = sphereFieldCamera();
+
+    auto seconds_since = [](std::chrono::high_resolution_clock::time_point start_time) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    };
+    auto start_time = std::chrono::high_resolution_clock::now();
+    LinearBVH sah(spheres, BVHBuildParameters(BVHSplitMethod::SAH));
+    double sahSeconds = seconds_since(start_time);
+    start_time = std::chrono::high_resolution_clock::now();
+    LinearBVH lbvh(spheres, BVHBuildParameters(BVHSplitMethod::LBVH));
+    double lbvhSeconds = seconds_since(start_time);
+    start_time = std::chrono::high_resolution_clock::now();
+    Grid grid(spheres, false);
+    double gridSeconds = seconds_since(start_time);
+    start_time = std::chrono::high_resolution_clock::now();
+    Grid twoLevelGrid(spheres, true);
+    double twoLevelGridSeconds = seconds_since(start_time);
+    start_time = std::chrono::high_resolution_clock::now();
+    grid.build();
+    double gridRebuildSeconds = seconds_since(start_time);
+
+    const GridLevel& topLevel = grid.getTopLevel();
+    std::cout << std::endl << "Grid Benchmark: " << sphereCount << " spheres, " << topLevel.resolution[0] << " x " << topLevel.resolution[1] << " x " << topLevel.resolution[2]
+        << " cells, " << twoLevelGrid.getSubGrids().size() << " sub-grids" << std::endl;
+    std::cout << "Build seconds: SAH " << sahSeconds << ", LBVH " << lbvhSeconds << ", grid " << gridSeconds << " (rebuild " << gridRebuildSeconds << "), two-level grid " << twoLevelGridSeconds << std::endl;
+    std::cout << "Memory bytes: SAH " << BVHStatistics(sah, sah.getBuildParameters()).memoryBytes << ", LBVH " << BVHStatistics(lbvh, lbvh.getBuildParameters()).memoryBytes
+        << ", grid " << grid.memoryBytes() << ", two-level grid " << twoLevelGrid.memoryBytes() << std::endl;
+    std::cout << "Rays per second: SAH " << traceCameraRays(sah, camera) << ", LBVH " << traceCameraRays(lbvh, camera) << ", grid " << traceCameraRays(grid, camera)
+        << ", two-level grid " << traceCameraRays(twoLevelGrid, camera) << std::endl << std::endl;
+}
+
+// Nudges spheres of the sphereTest field one at a time, as an interactive layout tool would, editing a DynamicBVH in place.
+// Prints the time per edit next to the time of one full SAH rebuild, and the tree quality after the edits.
+void dynamicBVHBenchmark(int sphereCount = 100000, int editCount = 10000) {
+    std::vector<std::shared_ptr<Object>> spheres = sphereField(sphereCount);
+    Camera camera = sphereFieldCamera();
+    BVHBuildParameters params(BVHSplitMethod::SAH);
+
+    auto seconds_since = [](std::chrono::high_resolution_clock::time_point start_time) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    };
+    auto start_time = std::chrono::high_resolution_clock::now();
+    DynamicBVH dynamicBVH(spheres, params);
+    double buildSeconds = seconds_since(start_time);
+    double builtCost = dynamicBVH.sahCost(params);
+
+    // Half the edits nudge a sphere by up to a unit, the other half remove one and add it back somewhere else entirely
+    Point3D lowerLimit{ -10, -10, -10 };
+    Point3D upperLimit{ 10, 10, -5 };
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < editCount; i++) {
+        std::shared_ptr<Sphere> sphere = std::static_pointer_cast<Sphere>(spheres[rand() % spheres.size()]);
+        if (i % 2 == 0) {
+            sphere->setCenter(sphere->getCenter() + Arithmetic::randomVec3D(Point3D(-1, -1, -1), Point3D(1, 1, 1)));
+            dynamicBVH.update(*sphere);
+        }
+        else {
+            dynamicBVH.remove(*sphere);
+            sphere->setCenter(Arithmetic::randomVec3D(lowerLimit, upperLimit));
+            dynamicBVH.insert(sphere);
+        }
+    }
+    double editSeconds = seconds_since(start_time);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    LinearBVH rebuilt(spheres, params);
+    double rebuildSeconds = seconds_since(start_time);
+
+    std::cout << std::endl << "Dynamic BVH Benchmark: " << sphereCount << " spheres, " << editCount << " edits" << std::endl;
+    std::cout << "Seconds: initial build " << buildSeconds << ", per edit " << editSeconds / editCount << ", full SAH rebuild " << rebuildSeconds << std::endl;
+    std::cout << "SAH cost: built " << builtCost << ", after edits " << dynamicBVH.sahCost(params) << ", rebuilt " << rebuilt.sahCost(params) << std::endl;
+    std::cout << "Height: " << dynamicBVH.height() << std::endl;
+    std::cout << "Rays per second: edited " << traceCameraRays(dynamicBVH, camera) << ", rebuilt " << traceCameraRays(rebuilt, camera) << std::endl << std::endl;
+}
+
+// Traces gridSize^3 copies of one mesh next to analytic spheres. Every copy is a MeshInstance of the same bottom-level BVH.
+void instanceTest(const std::string& objFilepath, int gridSize = 10) {
+    World world;
+    setupObjWorld(world, objFilepath);
+
+    const std::shared_ptr<TriangleMesh>& tm = world.getTriangleMesh();
+    std::shared_ptr<LinearBVH> blas = std::make_shared<LinearBVH>(tm, world.getBVHBuildParameters());
+    for (int x = 0; x < gridSize; x++) {
+        for (int y = 0; y < gridSize; y++) {
+            for (int z = 0; z < gridSize; z++) {
+                std::shared_ptr<MeshInstance> instance = std::make_shared<MeshInstance>(blas, Mat4(), Mat4());
+                instance->addTransformation(Mat4().fromScale(Vec3D(0.3, 0.3, 0.3)), Transformation::SCALE);
+                instance->addTransformation(Mat4().fromRotation(2 * PI * (x + y + z) / gridSize, Vec3D(0, 1, 0)), Transformation::ROTATE);
+                instance->addTransformation(Mat4().fromTranslation(Vec3D(2.0 * x - gridSize, 2.0 * y - gridSize + 2, -4.0 * z - 4)), Transformation::TRANSLATE);
+                world.addMeshInstance(instance);
+            }
+        }
+    }
+    world.addSceneObject(std::shared_ptr<SceneObject>(new Sphere(Point3D(0, 2, 2), 0.75, RED_COLOR, RED_COLOR, WHITE_COLOR)));
+    world.addSceneObject(std::shared_ptr<SceneObject>(new Sphere(Point3D(-1.5, 1, 2), 0.5, BLUE_COLOR, BLUE_COLOR, WHITE_COLOR)));
+    world.addRenderOption(RenderOption::BVH_SAH);
+
+    size_t blasBytes = blas->getNodes().size() * sizeof(LinearBVHNode) + tm->getTriangles().size() * sizeof(Triangle);
+    size_t instanceBytes = world.getMeshInstances().size() * sizeof(MeshInstance);
+    std::cout << "Bottom-level BVH and triangles: " << blasBytes << " bytes, shared by " << world.getMeshInstances().size() << " instances (" << instanceBytes << " bytes)" << std::endl;
+
+    Image im{ world.render() };
+    im.writeToFile(objFilepath.substr(0, objFilepath.size() - 4) + "Instances.ppm");
+}
+
+// Fires rays at points on small triangles far from the origin, a third of them on an edge, and checks that the packed
+// intersect and occluded queries find the same hits as testing every slot with intersectSlot, at every SimdLevel the
+// CPU supports. Rounding in the float lanes grows with the distance, so this is where a filter that isn't conservative drops hits.
+void simdFilterTest(double distance = 1e4, double triangleSize = 0.01, int triangleCount = 64, int rayCount = 20000) {
+    const Point3D unitLower{ -1, -1, -1 };
+    const Point3D unitUpper{ 1, 1, 1 };
+    std::vector<std::shared_ptr<Object>> triangles;
+    std::vector<uint32_t> primitiveIndices;
+    for (int i = 0; i < triangleCount; i++) {
+        Vec3D direction = Arithmetic::randomVec3D(unitLower, unitUpper);
+        direction.normalize();
+        Point3D center = direction * distance;
+        Point3D vertices[3];
+        for (Point3D& vertex : vertices) {
+            vertex = center + Arithmetic::randomVec3D(unitLower, unitUpper) * triangleSize;
+        }
+        triangles.push_back(std::make_shared<Triangle>(vertices, WHITE_COLOR, WHITE_COLOR, WHITE_COLOR));
+        primitiveIndices.push_back(i);
+    }
+    TrianglePacks packs;
+    packs.build(triangles, primitiveIndices);
+
+    int totalMismatches = 0;
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+        if (level > SimdKernels::detectedLevel()) {
+            continue;
+        }
+        SimdKernels::setLevel(level);
+        int hits = 0;
+        int mismatches = 0;
+        for (int r = 0; r < rayCount; r++) {
+            const Triangle& triangle = static_cast<const Triangle&>(*triangles[rand() % triangleCount]);
+            Vec3D weights = Arithmetic::randomVec3D(Point3D(0, 0, 0), Point3D(1, 1, 1));
+            double u = weights[0];
+            double v = (r % 3 == 0) ? 1 - u : weights[1] * (1 - u);
+            Point3D target = triangle.vertex0() + (triangle.vertex1() - triangle.vertex0()) * u + (triangle.vertex2() - triangle.vertex0()) * v;
+            Point3D origin = (r % 2 == 0) ? Point3D(0, 0, 0) : target + Arithmetic::randomVec3D(unitLower, unitUpper) * (3 * triangleSize);
+            Vec3D direction = target - origin;
+
+            double exhaustiveClosest = MAX_T;
+            TrianglePackHit exhaustiveHit;
+            bool exhaustive = false;
+            for (uint32_t i = 0; i < (uint32_t)packs.size(); i++) {
+                exhaustive |= packs.intersectSlot(i, origin, direction, 0, exhaustiveClosest, exhaustiveHit);
+            }
+            double closest = MAX_T;
+            TrianglePackHit packHit;
+            bool filtered = packs.intersect(0, (uint32_t)packs.size(), origin, direction, 0, closest, packHit);
+            bool occluded = packs.occluded(0, (uint32_t)packs.size(), origin, direction, 0, MAX_T);
+
+            hits += exhaustive;
+            if (filtered != exhaustive || occluded != exhaustive || closest != exhaustiveClosest || packHit.slot != exhaustiveHit.slot) {
+                mismatches++;
+            }
+        }
+        std::cout << "SIMD filter (" << SimdKernels::levelName(level) << "): " << hits << " hits, " << mismatches << " mismatches" << std::endl;
+        totalMismatches += mismatches;
+    }
+    SimdKernels::setLevel(SimdKernels::detectedLevel());
+
+    if (totalMismatches != 0) {
+        std::cerr << "SIMD filter test failed: " << totalMismatches << " hits differ from testing every triangle at distance " << distance << std::endl;
+        std::abort();
+    }
+}
+
+// Renders the perspective test scene with each way of tracing rays and checks that none of them allocate on the heap
+// while tracing. Counting needs COUNT_HEAP_ALLOCATIONS, which the Debug configurations define.
+void allocationTest(int size = 100) {
+    if (!AllocationCounter::enabled()) {
+        std::cout << "Allocation test skipped, define COUNT_HEAP_ALLOCATIONS to count heap allocations" << std::endl;
+        return;
+    }
+    const std::vector<std::vector<RenderOption>> optionSets{
+        {},
+        { RenderOption::BVH },
+        { RenderOption::BVH, RenderOption::BVH_SAH, RenderOption::ANTI_ALIASING },
+        { RenderOption::BVH, RenderOption::RAY_PACKETS },
+        { RenderOption::BVH, RenderOption::BVH4 },
+        { RenderOption::BVH, RenderOption::COMPRESSED_BVH },
+        { RenderOption::BVH, RenderOption::KD_TREE },
+        { RenderOption::BVH, RenderOption::TWO_LEVEL_GRID },
+        { RenderOption::BVH, RenderOption::DYNAMIC_BVH },
+    };
+    for (const std::vector<RenderOption>& options : optionSets) {
+        World world;
+        for (const RenderOption& option : options) {
+            world.addRenderOption(option);
+        }
+
+        Camera camera;
+        camera.setPosition({ 0,0,0 });
+        camera.setViewWindowPosition(Point3D(0, 0, -1));
+        camera.setUpVector(Vec3D(0, 1, 0));
+        camera.setViewWindowRows(size);
+        camera.setViewWindowCols(size);
+        camera.setPixelSize(2.0 / size);
+        camera.setProjectionType(ProjectionType::PERSPECTIVE);
+        camera.setWorldPosition({ 0,0,0 });
+        world.setCamera(camera);
+
+        Image backgroundImage{ size, size, ColorRGB(255, 219, 247) };
+        world.setBackgroundImage(std::move(backgroundImage));
+        world.setAmbientLight(WHITE_COLOR * 0.2);
+
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Plane({ 0,-2,0 }, { 0,1,0 }, BLUE_COLOR, BLUE_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Plane({ 6,0,0 }, { -1,0,0 }, GREEN_COLOR, GREEN_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Sphere(Point3D(1, 1, -7), 3, RED_COLOR, RED_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Sphere(Point3D(-2, -1.5, -3), 0.5, PINK_COLOR, PINK_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Triangle({ Point3D(0, -2, -3.5), Point3D(2.5, -0.5, -3.0), Point3D(2.0, -2, -3.0) }, ORANGE_COLOR, ORANGE_COLOR)));
+        world.addLightSource(std::shared_ptr<LightSource>(new PointLightSource(Point3D(-12, 20, 2), WHITE_COLOR, WHITE_COLOR)));
+
+        world.render();
+        if (world.getRayTracingAllocations() != 0) {
+            std::cerr << "Allocation test failed: " << world.getRayTracingAllocations() << " heap allocations while tracing rays with " << options.size() << " render options" << std::endl;
+            std::abort();
+        }
+    }
+    std::cout << "Allocation test passed: no heap allocations while tracing rays" << std::endl;
+}
+
+// Renders spheres over planes with and without RAY_PACKETS, for each BVH build, and checks that the images match. The
+// planes are unbounded, so they're tested outside the BVH and lower each ray's t_max before the packet is traversed.
+void packetTest(int size = 160, int sphereCount = 50) {
+    std::vector<Point3D> centers;
+    std::vector<ColorRGB> colors;
+    for (int i = 0; i < sphereCount; i++) {
+        centers.push_back(Arithmetic::randomVec3D(Point3D(-4, -2, -12), Point3D(4, 2, -4)));
+        colors.push_back(Arithmetic::randomVec3D(BLACK_COLOR, WHITE_COLOR));
+    }
+    auto render = [&](const std::vector<RenderOption>& options) {
+        World world;
+        for (const RenderOption& option : options) {
+            world.addRenderOption(option);
+        }
+
+        Camera camera;
+        camera.setPosition({ 0,0,0 });
+        camera.setViewWindowPosition(Point3D(0, 0, -1));
+        camera.setUpVector(Vec3D(0, 1, 0));
+        camera.setViewWindowRows(size);
+        camera.setViewWindowCols(size);
+        camera.setPixelSize(2.0 / size);
+        camera.setProjectionType(ProjectionType::PERSPECTIVE);
+        camera.setWorldPosition({ 0,0,0 });
+        world.setCamera(camera);
+
+        Image backgroundImage{ size, size, ColorRGB(255, 219, 247) };
+        world.setBackgroundImage(std::move(backgroundImage));
+        world.setAmbientLight(WHITE_COLOR * 0.2);
+
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Plane({ 0,-2,0 }, { 0,1,0 }, BLUE_COLOR, BLUE_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Plane({ 3,0,0 }, { -1,0,0 }, GREEN_COLOR, GREEN_COLOR)));
+        world.addSceneObject(std::shared_ptr<SceneObject>(new Plane({ 0,0,-10 }, { 0,0,1 }, YELLOW_COLOR, YELLOW_COLOR)));
+        for (int i = 0; i < sphereCount; i++) {
+            world.addSceneObject(std::shared_ptr<SceneObject>(new Sphere(centers[i], 0.5, colors[i], colors[i])));
+        }
+        world.addLightSource(std::shared_ptr<LightSource>(new PointLightSource(Point3D(-12, 20, 2), WHITE_COLOR, WHITE_COLOR)));
+        return world.render();
+    };
+
+    for (RenderOption build : { RenderOption::BVH, RenderOption::BVH_SAH, RenderOption::SBVH }) {
+        Image single{ render({ RenderOption::BVH, build }) };
+        Image packets{ render({ RenderOption::BVH, build, RenderOption::RAY_PACKETS }) };
+        int differences = 0;
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                const ColorRGB difference = single.get(i, j) - packets.get(i, j);
+                if (std::fabs(difference[0]) > 1 || std::fabs(difference[1]) > 1 || std::fabs(difference[2]) > 1) {
+                    differences++;
+                }
+            }
+        }
+        if (differences != 0) {
+            std::cerr << "Packet test failed: " << differences << " pixels differ between the packet and single-ray renders" << std::endl;
+            std::abort();
+        }
+    }
+    std::cout << "Packet test passed: packet renders match single-ray renders" << std::endl;
+}
+
+// Renders spheres with REFIT_BVH, then edits the scene between renders and checks each image against a world built from
+// scratch over the same spheres. Adding and removing spheres must rebuild the BVH; moving one only refits it.
+void refitTest(int size = 160, int sphereCount = 50) {
+    std::vector<std::shared_ptr<Sphere>> spheres;
+    for (int i = 0; i <= sphereCount; i++) {
+        ColorRGB color = Arithmetic::randomVec3D(BLACK_COLOR, WHITE_COLOR);
+        spheres.push_back(std::make_shared<Sphere>(Arithmetic::randomVec3D(Point3D(-4, -2, -12), Point3D(4, 2, -4)), 0.5, color, color));
+    }
+    auto setup = [&](World& world) {
+        Camera camera;
+        camera.setPosition({ 0,0,0 });
+        camera.setViewWindowPosition(Point3D(0, 0, -1));
+        camera.setUpVector(Vec3D(0, 1, 0));
+        camera.setViewWindowRows(size);
+        camera.setViewWindowCols(size);
+        camera.setPixelSize(2.0 / size);
+        camera.setProjectionType(ProjectionType::PERSPECTIVE);
+        camera.setWorldPosition({ 0,0,0 });
+        world.setCamera(camera);
+
+        Image backgroundImage{ size, size, ColorRGB(255, 219, 247) };
+        world.setBackgroundImage(std::move(backgroundImage));
+        world.setAmbientLight(WHITE_COLOR * 0.2);
+        world.addLightSource(std::shared_ptr<LightSource>(new PointLightSource(Point3D(-12, 20, 2), WHITE_COLOR, WHITE_COLOR)));
+    };
+    auto check = [&](const Image& refit, int first, int last, const std::string& edit) {
+        World rebuiltWorld;
+        rebuiltWorld.addRenderOption(RenderOption::BVH);
+        setup(rebuiltWorld);
+        for (int i = first; i <= last; i++) {
+            rebuiltWorld.addSceneObject(spheres[i]);
+        }
+        Image rebuilt{ rebuiltWorld.render() };
+        int differences = 0;
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                const ColorRGB difference = refit.get(i, j) - rebuilt.get(i, j);
+                if (std::fabs(difference[0]) > 1 || std::fabs(difference[1]) > 1 || std::fabs(difference[2]) > 1) {
+                    differences++;
+                }
+            }
+        }
+        if (differences != 0) {
+            std::cerr << "Refit test failed: after " << edit << ", " << differences << " pixels differ from a rebuilt BVH" << std::endl;
+            std::abort();
+        }
+    };
+
+    World world;
+    world.addRenderOption(RenderOption::BVH);
+    world.addRenderOption(RenderOption::REFIT_BVH);
+    setup(world);
+    for (int i = 0; i < sphereCount; i++) {
+        world.addSceneObject(spheres[i]);
+    }
+    world.render();
+
+    world.addSceneObject(spheres[sphereCount]);
+    world.removeSceneObject(spheres[0]);
+    check(world.render(), 1, sphereCount, "adding and removing a sphere");
+
+    spheres[1]->setCenter(Point3D(0, 0, -5));
+    world.updateSceneObject(spheres[1]);
+    check(world.render(), 1, sphereCount, "moving a sphere");
+    std::cout << "Refit test passed: refit and rebuilt BVHs render the same" << std::endl;
+}
+
 void intTest() {
     std::vector<Point3D> intPoints;
     AABB3D bb(Point3D(-5, -5, -5), Point3D(5, 5, -10));
@@ -255,6 +817,21 @@ int main()
 
     //objTest("teapotObj.txt");
     //objTest("dragonObj.txt");
+    //objTest("dragonObj.txt", true);
+
+    //bvhBenchmark("teapotObj.txt");
+    //bvhBenchmark("dragonObj.txt");
+    //turntableTest("teapotObj.txt");
+    //instanceTest("teapotObj.txt");
+    //sbvhBenchmark("teapotObj.txt");
+    //kdTreeBenchmark("teapotObj.txt", "dragonObj.txt");
+    //gridBenchmark(100000);
+    //dynamicBVHBenchmark(100000);
+    simdFilterTest(1e4);
+    simdFilterTest(5e4);
+    allocationTest();
+    packetTest();
+    refitTest();
 
 
 }
\ No newline at end of file
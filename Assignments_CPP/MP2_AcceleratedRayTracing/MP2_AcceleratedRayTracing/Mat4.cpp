@@ -9,7 +9,7 @@ void Mat4::copy(const Mat4& other)
 {
 	for (size_t row = 0; row < AFFINE_DIMS; row++) {
 		for (size_t col = 0; col < AFFINE_DIMS; col++) {
-			this->set(col, row, other.get(row, col));
+			this->set(row, col, other.get(row, col));
 		}
 	}
 }
@@ -255,6 +255,38 @@ void Mat4::scale(const Vec3D& scaleAmount)
 	(*this) = scaleMatrix * (*this);
 }
 
+/*
+* Transforms a point (w = 1), so translations apply
+* 
+* @param p The point
+* 
+* @return this * p
+*/
+Point3D Mat4::transformPoint(const Point3D& p) const
+{
+	Point3D result;
+	for (size_t row = 0; row < 3; row++) {
+		result[row] = get(row, 0) * p[0] + get(row, 1) * p[1] + get(row, 2) * p[2] + get(row, 3);
+	}
+	return result;
+}
+
+/*
+* Transforms a direction (w = 0), so translations are ignored
+* 
+* @param v The direction
+* 
+* @return this * v
+*/
+Vec3D Mat4::transformVector(const Vec3D& v) const
+{
+	Vec3D result;
+	for (size_t row = 0; row < 3; row++) {
+		result[row] = get(row, 0) * v[0] + get(row, 1) * v[1] + get(row, 2) * v[2];
+	}
+	return result;
+}
+
 /*
 * @return The transpose of this
 */
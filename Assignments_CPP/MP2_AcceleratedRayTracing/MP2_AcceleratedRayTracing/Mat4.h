@@ -39,6 +39,9 @@ public:
 	void rotate(const double& rotationAmount, const Vec3D& axis);
 	void scale(const Vec3D& scaleAmount);
 
+	Point3D transformPoint(const Point3D& p) const;
+	Vec3D transformVector(const Vec3D& v) const;
+
 	Mat4 getTranspose() const;
 	Mat4 getSingleTransformationInverse(const Transformation& transformationType) const;
 };
@@ -0,0 +1,177 @@
+#include "MeshInstance.h"
+
+/*
+* Constructor for MeshInstance
+*
+* @param blas The bottom-level BVH over the mesh's model-space triangles, shared between instances
+* @param transform The transformation from model space to world space
+* @param inverseTransform The inverse of transform
+*/
+MeshInstance::MeshInstance(const std::shared_ptr<LinearBVH>& blas, const Mat4& transform, const Mat4& inverseTransform)
+    : Object(ObjectType::MeshInstance), blas(blas), transform(transform), inverseTransform(inverseTransform), normalMatrix(inverseTransform.getTranspose())
+{
+    updateBounds();
+}
+
+/*
+* Constructor for MeshInstance. Places the BVH with the model view matrices of a TriangleMesh.
+*
+* @param blas The bottom-level BVH over the mesh's model-space triangles, shared between instances
+* @param triangleMesh The TriangleMesh whose model view matrix places the instance
+*/
+MeshInstance::MeshInstance(const std::shared_ptr<LinearBVH>& blas, const TriangleMesh& triangleMesh)
+    : MeshInstance(blas, triangleMesh.getModelViewMatrix(), triangleMesh.getInverseModelViewMatrix()) {}
+
+/*
+* @return The bottom-level BVH
+*/
+const std::shared_ptr<LinearBVH>& MeshInstance::getBLAS() const
+{
+    return blas;
+}
+
+/*
+* @return The transformation from model space to world space
+*/
+const Mat4& MeshInstance::getTransform() const
+{
+    return transform;
+}
+
+/*
+* @return The transformation from world space to model space
+*/
+const Mat4& MeshInstance::getInverseTransform() const
+{
+    return inverseTransform;
+}
+
+/*
+* Add a transformation from the model space to the world space, in the same way as TriangleMesh::addTransformation.
+* A top-level BVH holding the instance must be refit or rebuilt afterwards.
+*
+* @param transformationMatrix The transformation matrix
+* @param transformationType The type of transformation being performed (ROTATE, SCALE, TRANSLATE)
+*/
+void MeshInstance::addTransformation(const Mat4& transformationMatrix, const Transformation& transformationType)
+{
+    transform = transformationMatrix * transform;
+    inverseTransform = inverseTransform * transformationMatrix.getSingleTransformationInverse(transformationType);
+    normalMatrix = inverseTransform.getTranspose();
+    updateBounds();
+}
+
+/*
+* Recomputes the world-space box by transforming the eight corners of the bottom-level BVH's box
+*/
+void MeshInstance::updateBounds()
+{
+    worldBox = EMPTY_BOUNDING_BOX;
+    AABB3D modelBox;
+    if (!blas || !blas->generateBoundingBox(modelBox)) {
+        return;
+    }
+    for (int corner = 0; corner < 8; corner++) {
+        Point3D p((corner & 1) ? modelBox.max()[0] : modelBox.min()[0],
+            (corner & 2) ? modelBox.max()[1] : modelBox.min()[1],
+            (corner & 4) ? modelBox.max()[2] : modelBox.min()[2]);
+        worldBox.expand(transform.transformPoint(p));
+    }
+}
+
+/*
+* Moves a ray into model space. Ray3D normalizes its direction, so a distance along the model-space ray is
+* the world-space distance times tScale.
+*
+* @param ray The world-space Ray3D
+* @param tScale The factor from world-space to model-space t. Modified by function.
+*
+* @return The model-space Ray3D
+*/
+Ray3D MeshInstance::toModelSpace(const Ray3D& ray, double& tScale) const
+{
+    Vec3D modelDirection = inverseTransform.transformVector(ray.getDirection());
+    tScale = modelDirection.magnitude();
+    return Ray3D(inverseTransform.transformPoint(ray.getStart()), modelDirection);
+}
+
+/*
+* @param output_box The world-space bounding box of the instance. Modified by function.
+*
+* @return True if the instance has a bounding box
+*/
+bool MeshInstance::generateBoundingBox(AABB3D& output_box) const
+{
+    if (!blas || blas->getNodes().empty()) {
+        return false;
+    }
+    output_box = worldBox;
+    return true;
+}
+
+/*
+* Intersects the instance's mesh in model space and moves the closest hit back to world space
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord The HitRecord, in world space. Modified by function.
+*
+* @return 1 if the instance is hit, 0 otherwise
+*/
+int MeshInstance::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    double tScale;
+    Ray3D modelRay = toModelSpace(ray, tScale);
+    if (!blas->intersection(modelRay, t_min * tScale, t_max * tScale, hitRecord)) {
+        return 0;
+    }
+    hitRecord.intT /= tScale;
+    hitRecord.intPoint = ray.pos(hitRecord.intT);
+    hitRecord.normal = normalMatrix.transformVector(hitRecord.normal).get_normalized();
+    return 1;
+}
+
+/*
+* Checks whether the instance's mesh blocks a ray within [t_min, t_max]
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if the instance is hit, false otherwise
+*/
+bool MeshInstance::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    double tScale;
+    Ray3D modelRay = toModelSpace(ray, tScale);
+    return blas->occluded(modelRay, t_min * tScale, t_max * tScale);
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+const ColorRGB& MeshInstance::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& MeshInstance::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+const ColorRGB& MeshInstance::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+const double& MeshInstance::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+Vec3D MeshInstance::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
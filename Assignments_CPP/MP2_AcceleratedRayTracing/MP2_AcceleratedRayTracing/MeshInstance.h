@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Object.h"
+#include "LinearBVH.h"
+#include "TriangleMesh.h"
+#include "Mat4.h"
+
+// A placement of a shared bottom-level mesh BVH in the world. Rays are moved into the mesh's model space with the
+// inverse transform, so any number of instances cost one copy of the mesh plus a few matrices each.
+class MeshInstance :
+    public Object
+{
+private:
+    std::shared_ptr<LinearBVH> blas;
+    Mat4 transform;             // model space to world space
+    Mat4 inverseTransform;      // world space to model space
+    Mat4 normalMatrix;          // transpose of inverseTransform, carries model-space normals to world space
+    AABB3D worldBox;
+
+    void updateBounds();
+    Ray3D toModelSpace(const Ray3D& ray, double& tScale) const;
+
+public:
+    MeshInstance(const std::shared_ptr<LinearBVH>& blas, const Mat4& transform, const Mat4& inverseTransform);
+    MeshInstance(const std::shared_ptr<LinearBVH>& blas, const TriangleMesh& triangleMesh);
+
+    const std::shared_ptr<LinearBVH>& getBLAS() const;
+    const Mat4& getTransform() const;
+    const Mat4& getInverseTransform() const;
+
+    void addTransformation(const Mat4& transformationMatrix, const Transformation& transformationType);
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
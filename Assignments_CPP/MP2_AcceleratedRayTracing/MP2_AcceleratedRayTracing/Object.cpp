@@ -15,3 +15,18 @@ const ObjectType& Object::getObjectType() const
 	return type;
 }
 
+/*
+* Checks whether a ray hits the Object anywhere in [t_min, t_max], without finding the closest hit.
+* Subclasses override this to skip computing the hit point, normal and material; this fallback runs a full intersection.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if the ray hits the Object in [t_min, t_max], false otherwise
+*/
+bool Object::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	HitRecord hitRecord;
+	return intersection(ray, t_min, t_max, hitRecord) != 0;
+}
@@ -9,7 +9,7 @@
 
 const ColorRGB DEFAULT_COLOR = WHITE_COLOR;
 
-enum class ObjectType { Camera, Plane, Sphere, Triangle, Cone, PointLightSource, SquareLightSource, BVHNode, None };
+enum class ObjectType { Camera, Plane, Sphere, Triangle, Cone, PointLightSource, SquareLightSource, BVHNode, LinearBVH, WideBVH, CompressedBVH, MeshInstance, KdTree, Grid, DynamicBVH, None };
 
 struct Material {
 	ColorRGB ambient;
@@ -120,6 +120,7 @@ public:
 	virtual const double& getAlpha() const = 0;
 
 	virtual int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const = 0;
+	virtual bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
 	virtual Vec3D normal(const Point3D& intersection) const = 0;
 	virtual bool generateBoundingBox(AABB3D& bb) const = 0;
 };
@@ -55,6 +55,25 @@ int Plane::intersection(const Ray3D& ray, const double& t_min, const double& t_m
 	return 0;
 }
 
+/*
+* Checks whether a Ray3D hits the Plane in [t_min, t_max], without building a HitRecord
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return True if the ray hits the Plane in [t_min, t_max]
+*/
+bool Plane::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	double denom = normal_vector.dotProduct(ray.getDirection());
+	if (abs(denom) < Arithmetic::EPSILON) {
+		return false;
+	}
+	double intT = (point - ray.getStart()).dotProduct(normal_vector) / denom;
+	return intT >= Arithmetic::EPSILON && intT >= t_min && intT <= t_max;
+}
+
 /*
 * Find the normal vector at a given point (irregardless of position on the surface)
 * Overridden virtual function
@@ -17,6 +17,7 @@ public:
     Vec3D getNormal() const;
 
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
     Vec3D normal(const Point3D& intersection) const;
     bool generateBoundingBox(AABB3D& bb) const;
 };
@@ -0,0 +1,105 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+* Default constructor for RayPacket (an empty packet)
+*/
+RayPacket::RayPacket()
+{
+    clear();
+}
+
+/*
+* Empties the packet
+*/
+void RayPacket::clear()
+{
+    size = 0;
+    coherent = false;
+}
+
+/*
+* Adds a ray to the packet. finalize() has to be called once every ray is in.
+*
+* @param ray The Ray3D
+* @param t_min The minimum intersection t of the ray
+* @param t_max The maximum intersection t of the ray
+*
+* @return False if the packet is already full
+*/
+bool RayPacket::add(const Ray3D& ray, double t_min, double t_max)
+{
+    if (size == RAY_PACKET_MAX_RAYS) {
+        return false;
+    }
+    rays[size] = ray;
+    traversalRays[size].set(ray, t_min, t_max);
+    hit[size] = false;
+    size++;
+    return true;
+}
+
+/*
+* Computes the packet's interval bounds, and checks whether the packet is coherent
+*/
+void RayPacket::finalize()
+{
+    coherent = size > 0;
+    for (int a = 0; a < 3; a++) {
+        originMin[a] = originMax[a] = size > 0 ? traversalRays[0].origin[a] : 0;
+        invDirMin[a] = invDirMax[a] = size > 0 ? traversalRays[0].invDir[a] : 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        const TraversalRay& ray = traversalRays[i];
+        for (int a = 0; a < 3; a++) {
+            originMin[a] = std::min(originMin[a], ray.origin[a]);
+            originMax[a] = std::max(originMax[a], ray.origin[a]);
+            invDirMin[a] = std::min(invDirMin[a], ray.invDir[a]);
+            invDirMax[a] = std::max(invDirMax[a], ray.invDir[a]);
+        }
+    }
+    // A sign change (or a zero component, whose reciprocal is infinite) leaves the reciprocal interval unbounded
+    for (int a = 0; a < 3; a++) {
+        if (!(invDirMin[a] > 0 || invDirMax[a] < 0) || std::isinf(invDirMin[a]) || std::isinf(invDirMax[a])) {
+            coherent = false;
+        }
+    }
+}
+
+/*
+* Interval arithmetic slab test: bounds every ray's entry and exit t over the ranges of the packet's origins and
+* reciprocal directions. Only meaningful for coherent packets.
+*
+* @param boundsMin The minimum corner of the box
+* @param boundsMax The maximum corner of the box
+* @param t_min The minimum intersection t.
+* @param t_max The largest maximum intersection t of any ray still in the packet
+*
+* @return True if no ray of the packet can hit the box within [t_min, t_max]
+*/
+bool RayPacket::missesBox(const float(&boundsMin)[3], const float(&boundsMax)[3], double t_min, double t_max) const
+{
+    double entryLower = t_min;
+    double exitUpper = t_max;
+    for (int a = 0; a < 3; a++) {
+        // The near slab is the minimum plane for rays moving up the axis, the maximum plane otherwise
+        const bool positive = invDirMin[a] > 0;
+        const double nearPlane = positive ? boundsMin[a] : boundsMax[a];
+        const double farPlane = positive ? boundsMax[a] : boundsMin[a];
+
+        // [plane - originMax, plane - originMin] * [invDirMin, invDirMax], extremes are at the corners
+        double near0 = (nearPlane - originMax[a]) * invDirMin[a], near1 = (nearPlane - originMax[a]) * invDirMax[a];
+        double near2 = (nearPlane - originMin[a]) * invDirMin[a], near3 = (nearPlane - originMin[a]) * invDirMax[a];
+        double far0 = (farPlane - originMax[a]) * invDirMin[a], far1 = (farPlane - originMax[a]) * invDirMax[a];
+        double far2 = (farPlane - originMin[a]) * invDirMin[a], far3 = (farPlane - originMin[a]) * invDirMax[a];
+
+        entryLower = std::max(entryLower, std::min(std::min(near0, near1), std::min(near2, near3)));
+        exitUpper = std::min(exitUpper, std::max(std::max(far0, far1), std::max(far2, far3)));
+        if (entryLower > exitUpper) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Ray3D.h"
+#include "TraversalRay.h"
+
+constexpr size_t RAY_PACKET_MAX_RAYS = 64;      // an 8x8 pixel block
+
+// Up to RAY_PACKET_MAX_RAYS coherent rays (e.g. the primary rays of a block of neighboring pixels) traced together.
+// The packet keeps interval bounds on its origins and reciprocal directions, so a whole node can be culled for every
+// ray at once with interval arithmetic. Packets whose directions don't share a sign on every axis can't be bounded
+// that way, and are traced one ray at a time.
+struct RayPacket {
+    size_t size;
+    Ray3D rays[RAY_PACKET_MAX_RAYS];
+    TraversalRay traversalRays[RAY_PACKET_MAX_RAYS];    // tMax is lowered to each ray's closest hit
+    bool hit[RAY_PACKET_MAX_RAYS];
+    double originMin[3];
+    double originMax[3];
+    double invDirMin[3];
+    double invDirMax[3];
+    bool coherent;                          // every axis has one non-zero direction sign across the packet
+
+    RayPacket();
+
+    void clear();
+    bool add(const Ray3D& ray, double t_min, double t_max);
+    void finalize();
+
+    bool missesBox(const float(&boundsMin)[3], const float(&boundsMax)[3], double t_min, double t_max) const;
+};
@@ -0,0 +1,504 @@
+#include "SBVHBuilder.h"
+#include "BVHBuildPrimitives.h"
+
+/*
+* @param box A bounding box
+*
+* @return True if the box contains no point
+*/
+static bool isEmptyBox(const AABB3D& box)
+{
+    return box.min()[0] > box.max()[0] || box.min()[1] > box.max()[1] || box.min()[2] > box.max()[2];
+}
+
+/*
+* @param box A bounding box
+*
+* @return The surface area of the box, 0 if it is empty
+*/
+static double boxArea(const AABB3D& box)
+{
+    return isEmptyBox(box) ? 0 : box.surfaceArea();
+}
+
+/*
+* @param a The first bounding box
+* @param b The second bounding box
+*
+* @return The overlap of the two boxes (possibly empty)
+*/
+static AABB3D intersectBoxes(const AABB3D& a, const AABB3D& b)
+{
+    AABB3D overlap;
+    for (int axis = 0; axis < 3; axis++) {
+        overlap.min()[axis] = std::max(a.min()[axis], b.min()[axis]);
+        overlap.max()[axis] = std::min(a.max()[axis], b.max()[axis]);
+    }
+    return overlap;
+}
+
+/*
+* Constructor for SBVHBuilder
+*
+* @param primitives The primitives to build over
+* @param params The SAH costs and spatial split budget to build with
+*/
+SBVHBuilder::SBVHBuilder(const std::vector<std::shared_ptr<Object>>& primitives, const BVHBuildParameters& params)
+    : primitives(primitives), params(params), rootArea(0), referenceCount(0), maxReferences(0), duplicatedReferences(0) {}
+
+/*
+* Builds the node array depth-first. Leaves of a spatially split tree may refer to the same primitive, so primitiveIndices
+* can be longer than the primitive list.
+*
+* @param nodes The depth-first node array. Modified by function.
+* @param primitiveIndices The primitive indices referenced by the leaves. Modified by function.
+*/
+void SBVHBuilder::build(std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    duplicatedReferences = 0;
+    if (primitives.empty()) {
+        return;
+    }
+
+    // Start from the same cached bounds and costs as the object-split builder
+    BVHBuildPrimitives buildPrimitives(primitives, params);
+    costs.swap(buildPrimitives.costs);
+    std::vector<SBVHReference> references(primitives.size());
+    AABB3D rootBox = EMPTY_BOUNDING_BOX;
+    for (size_t i = 0; i < primitives.size(); i++) {
+        references[i].box = buildPrimitives.bounds[i];
+        references[i].primitive = (uint32_t)i;
+        rootBox.expand(references[i].box);
+    }
+
+    rootArea = boxArea(rootBox);
+    referenceCount = primitives.size();
+    maxReferences = std::max(referenceCount, (size_t)(params.spatialSplitBudget * primitives.size()));
+
+    buildNode(references, 0, nodes, primitiveIndices);
+    costs.clear();
+    costs.shrink_to_fit();
+}
+
+/*
+* @return The number of primitive references added by spatial splits in the last build
+*/
+size_t SBVHBuilder::getDuplicatedReferences() const
+{
+    return duplicatedReferences;
+}
+
+/*
+* Builds the subtree over a set of references, appending its nodes depth-first
+*
+* @param references The references in the subtree. Consumed by function.
+* @param depth The depth of the subtree's root node
+* @param nodes The depth-first node array. Modified by function.
+* @param primitiveIndices The primitive indices referenced by the leaves. Modified by function.
+*
+* @return The index of the subtree's root node
+*/
+uint32_t SBVHBuilder::buildNode(std::vector<SBVHReference>& references, size_t depth, std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices)
+{
+    AABB3D nodeBox = EMPTY_BOUNDING_BOX;
+    AABB3D centroidBox = EMPTY_BOUNDING_BOX;
+    for (const SBVHReference& reference : references) {
+        nodeBox.expand(reference.box);
+        centroidBox.expand(reference.box.centroid());
+    }
+
+    uint32_t nodeIndex = (uint32_t)nodes.size();
+    nodes.push_back(LinearBVHNode());
+    nodes[nodeIndex].setBounds(nodeBox);
+    nodes[nodeIndex].pad = 0;
+
+    bool fitsLeaf = references.size() <= params.leafPrimitiveLimit();
+    auto makeLeaf = [&]() -> uint32_t {
+        nodes[nodeIndex].offset = (uint32_t)primitiveIndices.size();
+        nodes[nodeIndex].primitiveCount = (uint16_t)references.size();
+        nodes[nodeIndex].axis = 0;
+        for (const SBVHReference& reference : references) {
+            primitiveIndices.push_back(reference.primitive);
+        }
+        return nodeIndex;
+    };
+    if (references.size() == 1 || (fitsLeaf && depth >= LINEAR_BVH_MAX_SAH_DEPTH)) {
+        return makeLeaf();
+    }
+
+    // Prefer the cheaper of the best object split and, where its children overlap, the best spatial split.
+    // Below LINEAR_BVH_MAX_SAH_DEPTH only median splits are made, which never duplicate and so always terminate.
+    std::vector<SBVHReference> left;
+    std::vector<SBVHReference> right;
+    int axis = BVHBuildPrimitives::longestAxis(centroidBox);
+    if (depth < LINEAR_BVH_MAX_SAH_DEPTH) {
+        SBVHObjectSplit objectSplit = findObjectSplit(references, nodeBox, centroidBox);
+        SBVHSpatialSplit spatialSplit{ std::numeric_limits<double>::infinity(), -1, 0 };
+        if (rootArea > 0 && boxArea(intersectBoxes(objectSplit.leftBox, objectSplit.rightBox)) / rootArea > SBVH_OVERLAP_THRESHOLD) {
+            spatialSplit = findSpatialSplit(references, nodeBox);
+        }
+
+        // A node small enough for one leaf is only split if that is cheaper than intersecting all of it
+        if (fitsLeaf) {
+            double leafCost = params.leafCost;
+            for (const SBVHReference& reference : references) {
+                leafCost += costs[reference.primitive];
+            }
+            if (leafCost <= std::min(objectSplit.cost, spatialSplit.cost)) {
+                return makeLeaf();
+            }
+        }
+
+        if (spatialSplit.axis >= 0 && spatialSplit.cost < objectSplit.cost) {
+            performSpatialSplit(references, spatialSplit, left, right);
+            axis = spatialSplit.axis;
+        }
+        else if (objectSplit.axis >= 0) {
+            performObjectSplit(references, objectSplit, centroidBox, left, right);
+            axis = objectSplit.axis;
+        }
+    }
+    if (left.empty() || right.empty()) {
+        left.clear();
+        right.clear();
+        performMedianSplit(references, centroidBox, left, right);
+    }
+    std::vector<SBVHReference>().swap(references);
+
+    nodes[nodeIndex].primitiveCount = 0;
+    nodes[nodeIndex].axis = (uint8_t)axis;
+    buildNode(left, depth + 1, nodes, primitiveIndices);
+    uint32_t rightIndex = buildNode(right, depth + 1, nodes, primitiveIndices);
+    nodes[nodeIndex].offset = rightIndex;
+    return nodeIndex;
+}
+
+/*
+* Finds the cheapest binned SAH split of the references' centroids over all three axes
+*
+* @param references The references in the node
+* @param nodeBox The bounding box of the references
+* @param centroidBox The bounding box of the references' centroids
+*
+* @return The split, with axis -1 if every centroid falls into the same bin
+*/
+SBVHObjectSplit SBVHBuilder::findObjectSplit(const std::vector<SBVHReference>& references, const AABB3D& nodeBox, const AABB3D& centroidBox) const
+{
+    SBVHObjectSplit best{ std::numeric_limits<double>::infinity(), -1, 0, EMPTY_BOUNDING_BOX, EMPTY_BOUNDING_BOX };
+    const size_t binCount = std::max<size_t>(params.binCount, 2);
+    double nodeArea = boxArea(nodeBox);
+    if (nodeArea <= 0) {
+        return best;
+    }
+
+    std::vector<AABB3D> binBoxes(binCount);
+    std::vector<double> binCosts(binCount);
+    std::vector<AABB3D> rightBoxes(binCount);
+    std::vector<double> rightCosts(binCount);
+    for (int a = 0; a < 3; a++) {
+        double extent = centroidBox.max()[a] - centroidBox.min()[a];
+        if (extent <= 0) {
+            continue;
+        }
+        double scale = binCount / extent;
+        std::fill(binBoxes.begin(), binBoxes.end(), EMPTY_BOUNDING_BOX);
+        std::fill(binCosts.begin(), binCosts.end(), 0.0);
+        for (const SBVHReference& reference : references) {
+            size_t b = std::min(binCount - 1, (size_t)((reference.box.centroid()[a] - centroidBox.min()[a]) * scale));
+            binBoxes[b].expand(reference.box);
+            binCosts[b] += costs[reference.primitive];
+        }
+
+        AABB3D runningBox = EMPTY_BOUNDING_BOX;
+        double runningCost = 0;
+        for (size_t b = binCount - 1; b > 0; b--) {
+            runningBox.expand(binBoxes[b]);
+            runningCost += binCosts[b];
+            rightBoxes[b] = runningBox;
+            rightCosts[b] = runningCost;
+        }
+        runningBox = EMPTY_BOUNDING_BOX;
+        runningCost = 0;
+        for (size_t b = 1; b < binCount; b++) {
+            runningBox.expand(binBoxes[b - 1]);
+            runningCost += binCosts[b - 1];
+            if (runningCost == 0 || rightCosts[b] == 0) {
+                continue;
+            }
+            double cost = params.traversalCost
+                + (boxArea(runningBox) * (params.leafCost + runningCost) + boxArea(rightBoxes[b]) * (params.leafCost + rightCosts[b])) / nodeArea;
+            if (cost < best.cost) {
+                best = { cost, a, b, runningBox, rightBoxes[b] };
+            }
+        }
+    }
+    return best;
+}
+
+/*
+* Finds the cheapest split plane between equally sized spatial bins of the node. Every reference is clipped to each bin
+* it overlaps, so the bins' boxes are tight; planes that would duplicate more references than the budget has left are skipped.
+*
+* @param references The references in the node
+* @param nodeBox The bounding box of the references
+*
+* @return The split, with axis -1 if no plane fits the budget
+*/
+SBVHSpatialSplit SBVHBuilder::findSpatialSplit(const std::vector<SBVHReference>& references, const AABB3D& nodeBox) const
+{
+    SBVHSpatialSplit best{ std::numeric_limits<double>::infinity(), -1, 0 };
+    const size_t binCount = std::max<size_t>(params.binCount, 2);
+    double nodeArea = boxArea(nodeBox);
+    if (nodeArea <= 0) {
+        return best;
+    }
+    const size_t budgetLeft = maxReferences - referenceCount;
+
+    std::vector<AABB3D> binBoxes(binCount);
+    std::vector<double> entryCosts(binCount);
+    std::vector<double> exitCosts(binCount);
+    std::vector<size_t> entryCounts(binCount);
+    std::vector<size_t> exitCounts(binCount);
+    std::vector<AABB3D> rightBoxes(binCount);
+    std::vector<double> rightCosts(binCount);
+    std::vector<size_t> rightCounts(binCount);
+    for (int a = 0; a < 3; a++) {
+        double origin = nodeBox.min()[a];
+        double extent = nodeBox.max()[a] - origin;
+        if (extent <= 0) {
+            continue;
+        }
+        double width = extent / binCount;
+        auto binOf = [&](double x) -> size_t {
+            return std::min(binCount - 1, (size_t)std::max(0.0, (x - origin) / width));
+        };
+        std::fill(binBoxes.begin(), binBoxes.end(), EMPTY_BOUNDING_BOX);
+        std::fill(entryCosts.begin(), entryCosts.end(), 0.0);
+        std::fill(exitCosts.begin(), exitCosts.end(), 0.0);
+        std::fill(entryCounts.begin(), entryCounts.end(), 0);
+        std::fill(exitCounts.begin(), exitCounts.end(), 0);
+
+        for (const SBVHReference& reference : references) {
+            size_t first = binOf(reference.box.min()[a]);
+            size_t last = binOf(reference.box.max()[a]);
+            for (size_t b = first; b <= last; b++) {
+                double low = origin + b * width;
+                double high = (b == binCount - 1) ? nodeBox.max()[a] : low + width;
+                binBoxes[b].expand(first == last ? reference.box : clipReference(reference, a, low, high));
+            }
+            entryCosts[first] += costs[reference.primitive];
+            exitCosts[last] += costs[reference.primitive];
+            entryCounts[first]++;
+            exitCounts[last]++;
+        }
+
+        AABB3D runningBox = EMPTY_BOUNDING_BOX;
+        double runningCost = 0;
+        size_t runningCount = 0;
+        for (size_t b = binCount - 1; b > 0; b--) {
+            runningBox.expand(binBoxes[b]);
+            runningCost += exitCosts[b];
+            runningCount += exitCounts[b];
+            rightBoxes[b] = runningBox;
+            rightCosts[b] = runningCost;
+            rightCounts[b] = runningCount;
+        }
+        runningBox = EMPTY_BOUNDING_BOX;
+        runningCost = 0;
+        size_t leftCount = 0;
+        for (size_t b = 1; b < binCount; b++) {
+            runningBox.expand(binBoxes[b - 1]);
+            runningCost += entryCosts[b - 1];
+            leftCount += entryCounts[b - 1];
+            if (leftCount == 0 || rightCounts[b] == 0 || leftCount + rightCounts[b] - references.size() > budgetLeft) {
+                continue;
+            }
+            double cost = params.traversalCost
+                + (boxArea(runningBox) * (params.leafCost + runningCost) + boxArea(rightBoxes[b]) * (params.leafCost + rightCosts[b])) / nodeArea;
+            if (cost < best.cost) {
+                best = { cost, a, origin + b * width };
+            }
+        }
+    }
+    return best;
+}
+
+/*
+* Moves every reference to the side of the object split its centroid bin lies on
+*
+* @param references The references in the node
+* @param split The object split
+* @param centroidBox The bounding box of the references' centroids
+* @param left The references of the left child. Modified by function.
+* @param right The references of the right child. Modified by function.
+*/
+void SBVHBuilder::performObjectSplit(std::vector<SBVHReference>& references, const SBVHObjectSplit& split, const AABB3D& centroidBox, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right) const
+{
+    const size_t binCount = std::max<size_t>(params.binCount, 2);
+    double scale = binCount / (centroidBox.max()[split.axis] - centroidBox.min()[split.axis]);
+    for (const SBVHReference& reference : references) {
+        size_t b = std::min(binCount - 1, (size_t)((reference.box.centroid()[split.axis] - centroidBox.min()[split.axis]) * scale));
+        (b < split.bin ? left : right).push_back(reference);
+    }
+}
+
+/*
+* Splits the references at the spatial split plane. A reference straddling the plane is either clipped into both children
+* or, when that is cheaper by the SAH, kept whole in one of them ("reference unsplitting").
+*
+* @param references The references in the node
+* @param split The spatial split
+* @param left The references of the left child. Modified by function.
+* @param right The references of the right child. Modified by function.
+*/
+void SBVHBuilder::performSpatialSplit(std::vector<SBVHReference>& references, const SBVHSpatialSplit& split, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right)
+{
+    const int a = split.axis;
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // First pass: assign the references that lie on one side and total up both children as if every straddler were split
+    AABB3D leftBox = EMPTY_BOUNDING_BOX;
+    AABB3D rightBox = EMPTY_BOUNDING_BOX;
+    double leftCost = 0;
+    double rightCost = 0;
+    std::vector<SBVHReference> straddling;
+    std::vector<AABB3D> straddlingParts;
+    for (const SBVHReference& reference : references) {
+        double cost = costs[reference.primitive];
+        if (reference.box.max()[a] <= split.position) {
+            left.push_back(reference);
+            leftBox.expand(reference.box);
+            leftCost += cost;
+        }
+        else if (reference.box.min()[a] >= split.position) {
+            right.push_back(reference);
+            rightBox.expand(reference.box);
+            rightCost += cost;
+        }
+        else {
+            AABB3D leftPart = clipReference(reference, a, -infinity, split.position);
+            AABB3D rightPart = clipReference(reference, a, split.position, infinity);
+            straddling.push_back(reference);
+            straddlingParts.push_back(leftPart);
+            straddlingParts.push_back(rightPart);
+            leftBox.expand(leftPart);
+            rightBox.expand(rightPart);
+            leftCost += cost;
+            rightCost += cost;
+        }
+    }
+
+    // Second pass: split each straddler, or move it whole to whichever side is cheaper
+    for (size_t i = 0; i < straddling.size(); i++) {
+        const SBVHReference& reference = straddling[i];
+        const AABB3D& leftPart = straddlingParts[2 * i];
+        const AABB3D& rightPart = straddlingParts[2 * i + 1];
+        double cost = costs[reference.primitive];
+
+        AABB3D leftUnsplit = leftBox;
+        leftUnsplit.expand(reference.box);
+        AABB3D rightUnsplit = rightBox;
+        rightUnsplit.expand(reference.box);
+        double splitCost = boxArea(leftBox) * leftCost + boxArea(rightBox) * rightCost;
+        double leftOnlyCost = boxArea(leftUnsplit) * leftCost + boxArea(rightBox) * (rightCost - cost);
+        double rightOnlyCost = boxArea(leftBox) * (leftCost - cost) + boxArea(rightUnsplit) * rightCost;
+
+        if (isEmptyBox(rightPart) || (!isEmptyBox(leftPart) && leftOnlyCost < splitCost && leftOnlyCost <= rightOnlyCost)) {
+            left.push_back(reference);
+            leftBox = leftUnsplit;
+            rightCost -= cost;
+        }
+        else if (isEmptyBox(leftPart) || rightOnlyCost < splitCost) {
+            right.push_back(reference);
+            rightBox = rightUnsplit;
+            leftCost -= cost;
+        }
+        else {
+            left.push_back({ leftPart, reference.primitive });
+            right.push_back({ rightPart, reference.primitive });
+            referenceCount++;
+            duplicatedReferences++;
+        }
+    }
+}
+
+/*
+* Splits the references at their median centroid along the longest centroid axis
+*
+* @param references The references in the node
+* @param centroidBox The bounding box of the references' centroids
+* @param left The references of the left child. Modified by function.
+* @param right The references of the right child. Modified by function.
+*/
+void SBVHBuilder::performMedianSplit(std::vector<SBVHReference>& references, const AABB3D& centroidBox, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right) const
+{
+    int axis = BVHBuildPrimitives::longestAxis(centroidBox);
+    size_t mid = references.size() / 2;
+    std::nth_element(references.begin(), references.begin() + mid, references.end(),
+        [axis](const SBVHReference& a, const SBVHReference& b) -> bool { return a.box.centroid()[axis] < b.box.centroid()[axis]; });
+    left.assign(references.begin(), references.begin() + mid);
+    right.assign(references.begin() + mid, references.end());
+}
+
+/*
+* Clips a reference to the slab low <= x[axis] <= high. Triangles are clipped exactly by intersecting their edges with the
+* slab; any other primitive only has its box cut.
+*
+* @param reference The reference
+* @param axis The axis the slab is perpendicular to
+* @param low The lower bound of the slab
+* @param high The upper bound of the slab
+*
+* @return The bounds of the part of the reference inside the slab (possibly empty)
+*/
+AABB3D SBVHBuilder::clipReference(const SBVHReference& reference, int axis, double low, double high) const
+{
+    AABB3D slab = reference.box;
+    slab.min()[axis] = std::max(slab.min()[axis], low);
+    slab.max()[axis] = std::min(slab.max()[axis], high);
+
+    const Object& primitive = *primitives[reference.primitive];
+    if (primitive.getObjectType() != ObjectType::Triangle) {
+        return slab;
+    }
+
+    // Clipping runs for every reference in every bin it spans, so it works on plain doubles
+    const Point3D* vertices = static_cast<const Triangle&>(primitive).getVertices();
+    double v[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int a = 0; a < 3; a++) {
+            v[i][a] = vertices[i][a];
+        }
+    }
+    double clippedMin[3]{ std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+    double clippedMax[3]{ -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+    auto expand = [&](const double(&point)[3]) {
+        for (int a = 0; a < 3; a++) {
+            clippedMin[a] = std::min(clippedMin[a], point[a]);
+            clippedMax[a] = std::max(clippedMax[a], point[a]);
+        }
+    };
+
+    for (int i = 0; i < 3; i++) {
+        const double(&p)[3] = v[i];
+        const double(&q)[3] = v[(i + 1) % 3];
+        if (p[axis] >= low && p[axis] <= high) {
+            expand(p);
+        }
+        for (double plane : { low, high }) {
+            if ((p[axis] < plane && q[axis] > plane) || (p[axis] > plane && q[axis] < plane)) {
+                double t = (plane - p[axis]) / (q[axis] - p[axis]);
+                double crossing[3]{ p[0] + (q[0] - p[0]) * t, p[1] + (q[1] - p[1]) * t, p[2] + (q[2] - p[2]) * t };
+                crossing[axis] = plane;
+                expand(crossing);
+            }
+        }
+    }
+    for (int a = 0; a < 3; a++) {
+        slab.min()[a] = std::max(slab.min()[a], clippedMin[a]);
+        slab.max()[a] = std::min(slab.max()[a], clippedMax[a]);
+    }
+    return slab;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "LinearBVH.h"
+
+constexpr double SBVH_OVERLAP_THRESHOLD = 1e-5;     // spatial splits are only tried where the object split's children overlap by this fraction of the root's area
+
+// A primitive reference: the part of a primitive's bounds that lies inside the node holding it
+struct SBVHReference {
+    AABB3D box;
+    uint32_t primitive;
+};
+
+struct SBVHObjectSplit {
+    double cost;
+    int axis;
+    size_t bin;
+    AABB3D leftBox;
+    AABB3D rightBox;
+};
+
+struct SBVHSpatialSplit {
+    double cost;
+    int axis;
+    double position;
+};
+
+// Builds a LinearBVH with spatial splits (Stich et al. 2009). Besides binned object splits, a node may be split by a
+// plane that clips the references straddling it, so a large or thin primitive can end up in several leaves.
+// Reference duplication is limited to BVHBuildParameters::spatialSplitBudget times the primitive count.
+class SBVHBuilder
+{
+private:
+    const std::vector<std::shared_ptr<Object>>& primitives;
+    const BVHBuildParameters& params;
+    std::vector<double> costs;
+
+    double rootArea;
+    size_t referenceCount;
+    size_t maxReferences;
+    size_t duplicatedReferences;
+
+    uint32_t buildNode(std::vector<SBVHReference>& references, size_t depth, std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices);
+    SBVHObjectSplit findObjectSplit(const std::vector<SBVHReference>& references, const AABB3D& nodeBox, const AABB3D& centroidBox) const;
+    SBVHSpatialSplit findSpatialSplit(const std::vector<SBVHReference>& references, const AABB3D& nodeBox) const;
+    void performObjectSplit(std::vector<SBVHReference>& references, const SBVHObjectSplit& split, const AABB3D& centroidBox, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right) const;
+    void performSpatialSplit(std::vector<SBVHReference>& references, const SBVHSpatialSplit& split, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right);
+    void performMedianSplit(std::vector<SBVHReference>& references, const AABB3D& centroidBox, std::vector<SBVHReference>& left, std::vector<SBVHReference>& right) const;
+    AABB3D clipReference(const SBVHReference& reference, int axis, double low, double high) const;
+
+public:
+    SBVHBuilder(const std::vector<std::shared_ptr<Object>>& primitives, const BVHBuildParameters& params);
+
+    void build(std::vector<LinearBVHNode>& nodes, std::vector<uint32_t>& primitiveIndices);
+    size_t getDuplicatedReferences() const;
+};
@@ -0,0 +1,599 @@
+#include "SimdKernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define SIMD_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles intrinsics of any instruction set anywhere; GCC and Clang only inside functions built for that set
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+typedef uint32_t(*TriangleKernel)(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates);
+typedef uint32_t(*SphereKernel)(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates);
+
+// The kernels of one SimdLevel
+struct KernelTable {
+    SimdLevel level;
+    uint32_t laneCount;
+    TriangleKernel triangles;
+    SphereKernel spheres;
+};
+
+/*
+* Constructor for SimdRay
+*
+* @param origin The origin of the ray
+* @param direction The direction of the ray
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*/
+SimdRay::SimdRay(const Point3D& origin, const Vec3D& direction, double t_min, double t_max)
+{
+    for (int a = 0; a < 3; a++) {
+        this->origin[a] = origin[a];
+        this->direction[a] = (float)direction[a];
+    }
+    this->t_min = (float)(t_min - SIMD_T_PADDING * (std::fabs(t_min) + 1.0));
+    this->t_max = (float)(t_max + SIMD_T_PADDING * (std::fabs(t_max) + 1.0));
+}
+
+/*
+* Appends the slot of every set bit of a lane mask to the candidates
+*
+* @param bits The lane mask, bit i for slot base + i
+* @param base The slot of lane 0
+* @param candidates The candidate buffer. Modified by function.
+* @param count The number of candidates so far
+*
+* @return The number of candidates after appending
+*/
+static inline uint32_t appendCandidates(uint32_t bits, uint32_t base, uint32_t* candidates, uint32_t count)
+{
+    while (bits != 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long lane;
+        _BitScanForward(&lane, bits);
+#else
+        uint32_t lane = (uint32_t)__builtin_ctz(bits);
+#endif
+        candidates[count++] = base + (uint32_t)lane;
+        bits &= bits - 1;
+    }
+    return count;
+}
+
+/*
+* @param remaining Slots left in the range
+* @param width Lanes per vector
+*
+* @return A mask of the lanes that fall inside the range
+*/
+static inline uint32_t liveLanes(uint32_t remaining, uint32_t width)
+{
+    return remaining >= width ? (uint32_t)((1ull << width) - 1) : (1u << remaining) - 1;
+}
+
+/*
+* Scalar fallback: no filtering at all, every slot is a candidate for the exact test
+*/
+static uint32_t triangleCandidatesScalar(const TriangleLanes&, uint32_t first, uint32_t last, const SimdRay&, uint32_t* candidates)
+{
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i++) {
+        candidates[count++] = i;
+    }
+    return count;
+}
+
+/*
+* Scalar fallback: no filtering at all, every slot is a candidate for the exact test
+*/
+static uint32_t sphereCandidatesScalar(const SphereLanes&, uint32_t first, uint32_t last, const SimdRay&, uint32_t* candidates)
+{
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i++) {
+        candidates[count++] = i;
+    }
+    return count;
+}
+
+#if defined(SIMD_KERNELS_X86)
+
+/*
+* Subtracts four double positions from a ray origin coordinate and rounds the offsets to float. Done in double, the
+* offsets are as precise as the exact test's, however far the primitives are from the world origin.
+*
+* @param origin The ray origin coordinate, in both lanes
+* @param positions The positions, slots i to i + 3
+*
+* @return The four offsets origin - position
+*/
+SIMD_TARGET("sse4.1")
+static inline __m128 offsetsSSE41(__m128d origin, const double* positions)
+{
+    __m128 low = _mm_cvtpd_ps(_mm_sub_pd(origin, _mm_loadu_pd(positions)));
+    __m128 high = _mm_cvtpd_ps(_mm_sub_pd(origin, _mm_loadu_pd(positions + 2)));
+    return _mm_movelh_ps(low, high);
+}
+
+/*
+* @return |x| + |y| + |z| in every lane
+*/
+SIMD_TARGET("sse4.1")
+static inline __m128 normSSE41(__m128 x, __m128 y, __m128 z)
+{
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    return _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signBit, x), _mm_andnot_ps(signBit, y)), _mm_andnot_ps(signBit, z));
+}
+
+/*
+* Moller-Trumbore on four triangles at a time, dropping the lanes whose barycentric coordinates or t fall outside the
+* bounds by more than the rounding error of the float lanes could explain. The error is bounded per lane from the
+* magnitudes of the operands (Higham 2002), so small triangles far from the ray origin are padded as much as they need.
+* Lanes the bound doesn't hold for, where the determinant may be mostly rounding error (nearly parallel rays, degenerate
+* triangles, NaNs), are kept for the exact test.
+*/
+SIMD_TARGET("sse4.1")
+static uint32_t triangleCandidatesSSE41(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m128 dx = _mm_set1_ps(ray.direction[0]), dy = _mm_set1_ps(ray.direction[1]), dz = _mm_set1_ps(ray.direction[2]);
+    const __m128d ox = _mm_set1_pd(ray.origin[0]), oy = _mm_set1_pd(ray.origin[1]), oz = _mm_set1_pd(ray.origin[2]);
+    const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), signBit = _mm_set1_ps(-0.0f);
+    const __m128 directionNorm = normSSE41(dx, dy, dz);
+    const __m128 rounding = _mm_set1_ps(SIMD_ROUNDING_PADDING), illConditioned = _mm_set1_ps(SIMD_ILL_CONDITIONED);
+    const __m128 tLower = _mm_set1_ps(ray.t_min), tUpper = _mm_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 4) {
+        __m128 e1x = _mm_loadu_ps(lanes.edge1[0] + i), e1y = _mm_loadu_ps(lanes.edge1[1] + i), e1z = _mm_loadu_ps(lanes.edge1[2] + i);
+        __m128 e2x = _mm_loadu_ps(lanes.edge2[0] + i), e2y = _mm_loadu_ps(lanes.edge2[1] + i), e2z = _mm_loadu_ps(lanes.edge2[2] + i);
+
+        __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+        __m128 f = _mm_div_ps(one, a);
+
+        __m128 sx = offsetsSSE41(ox, lanes.vertex0[0] + i);
+        __m128 sy = offsetsSSE41(oy, lanes.vertex0[1] + i);
+        __m128 sz = offsetsSSE41(oz, lanes.vertex0[2] + i);
+        __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+        __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+        __m128 offsetNorm = normSSE41(sx, sy, sz);
+        __m128 edgeNorm = _mm_loadu_ps(lanes.edgeNorm + i);
+        __m128 error = _mm_mul_ps(_mm_mul_ps(rounding, _mm_andnot_ps(signBit, f)), edgeNorm);
+        __m128 directionError = _mm_mul_ps(error, directionNorm);
+        __m128 conditioning = _mm_mul_ps(directionError, edgeNorm);
+        __m128 uvPadding = _mm_mul_ps(directionError, _mm_add_ps(offsetNorm, edgeNorm));
+        __m128 tPadding = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(error, edgeNorm), offsetNorm), _mm_mul_ps(conditioning, _mm_andnot_ps(signBit, t)));
+
+        __m128 miss = _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(u, uvPadding), zero), _mm_cmplt_ps(_mm_add_ps(v, uvPadding), zero));
+        miss = _mm_or_ps(miss, _mm_cmpgt_ps(_mm_sub_ps(_mm_add_ps(u, v), _mm_add_ps(uvPadding, uvPadding)), one));
+        miss = _mm_or_ps(miss, _mm_cmplt_ps(_mm_add_ps(t, tPadding), tLower));
+        miss = _mm_or_ps(miss, _mm_cmpgt_ps(_mm_sub_ps(t, tPadding), tUpper));
+        miss = _mm_andnot_ps(_mm_cmpge_ps(conditioning, illConditioned), miss);
+        uint32_t bits = ~(uint32_t)_mm_movemask_ps(miss) & liveLanes(last - i, 4);
+        count = appendCandidates(bits, i, candidates, count);
+    }
+    return count;
+}
+
+/*
+* Ray-sphere discriminant on four spheres at a time, keeping the lanes whose padded root interval overlaps the ray's
+*/
+SIMD_TARGET("sse4.1")
+static uint32_t sphereCandidatesSSE41(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m128 dx = _mm_set1_ps(ray.direction[0]), dy = _mm_set1_ps(ray.direction[1]), dz = _mm_set1_ps(ray.direction[2]);
+    const __m128d ox = _mm_set1_pd(ray.origin[0]), oy = _mm_set1_pd(ray.origin[1]), oz = _mm_set1_pd(ray.origin[2]);
+    const float lengthSquared = ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1] + ray.direction[2] * ray.direction[2];
+    const __m128 a = _mm_set1_ps(lengthSquared), invA = _mm_set1_ps(1.0f / lengthSquared);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 padding = _mm_set1_ps(SIMD_DISCRIMINANT_PADDING);
+    const __m128 tLower = _mm_set1_ps(ray.t_min), tUpper = _mm_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 4) {
+        __m128 ocx = offsetsSSE41(ox, lanes.center[0] + i);
+        __m128 ocy = offsetsSSE41(oy, lanes.center[1] + i);
+        __m128 ocz = offsetsSSE41(oz, lanes.center[2] + i);
+        __m128 r2 = _mm_loadu_ps(lanes.radiusSquared + i);
+
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ocx), _mm_mul_ps(dy, ocy)), _mm_mul_ps(dz, ocz));
+        __m128 ocSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+        __m128 bSquared = _mm_mul_ps(b, b);
+        __m128 discriminant = _mm_sub_ps(bSquared, _mm_mul_ps(a, _mm_sub_ps(ocSquared, r2)));
+        discriminant = _mm_add_ps(discriminant, _mm_mul_ps(padding, _mm_add_ps(bSquared, _mm_mul_ps(a, _mm_add_ps(ocSquared, r2)))));
+
+        __m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        __m128 tNear = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(zero, b), root), invA);
+        __m128 tFar = _mm_mul_ps(_mm_sub_ps(root, b), invA);
+
+        __m128 mask = _mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_and_ps(_mm_cmpge_ps(tFar, tLower), _mm_cmple_ps(tNear, tUpper)));
+        uint32_t bits = (uint32_t)_mm_movemask_ps(mask) & liveLanes(last - i, 4);
+        count = appendCandidates(bits, i, candidates, count);
+    }
+    return count;
+}
+
+/*
+* Eight-lane offsetsSSE41
+*/
+SIMD_TARGET("avx2")
+static inline __m256 offsetsAVX2(__m256d origin, const double* positions)
+{
+    __m128 low = _mm256_cvtpd_ps(_mm256_sub_pd(origin, _mm256_loadu_pd(positions)));
+    __m128 high = _mm256_cvtpd_ps(_mm256_sub_pd(origin, _mm256_loadu_pd(positions + 4)));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+/*
+* @return |x| + |y| + |z| in every lane
+*/
+SIMD_TARGET("avx2")
+static inline __m256 normAVX2(__m256 x, __m256 y, __m256 z)
+{
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signBit, x), _mm256_andnot_ps(signBit, y)), _mm256_andnot_ps(signBit, z));
+}
+
+/*
+* Moller-Trumbore on eight triangles at a time, see triangleCandidatesSSE41
+*/
+SIMD_TARGET("avx2")
+static uint32_t triangleCandidatesAVX2(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m256 dx = _mm256_set1_ps(ray.direction[0]), dy = _mm256_set1_ps(ray.direction[1]), dz = _mm256_set1_ps(ray.direction[2]);
+    const __m256d ox = _mm256_set1_pd(ray.origin[0]), oy = _mm256_set1_pd(ray.origin[1]), oz = _mm256_set1_pd(ray.origin[2]);
+    const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps(), signBit = _mm256_set1_ps(-0.0f);
+    const __m256 directionNorm = normAVX2(dx, dy, dz);
+    const __m256 rounding = _mm256_set1_ps(SIMD_ROUNDING_PADDING), illConditioned = _mm256_set1_ps(SIMD_ILL_CONDITIONED);
+    const __m256 tLower = _mm256_set1_ps(ray.t_min), tUpper = _mm256_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 8) {
+        __m256 e1x = _mm256_loadu_ps(lanes.edge1[0] + i), e1y = _mm256_loadu_ps(lanes.edge1[1] + i), e1z = _mm256_loadu_ps(lanes.edge1[2] + i);
+        __m256 e2x = _mm256_loadu_ps(lanes.edge2[0] + i), e2y = _mm256_loadu_ps(lanes.edge2[1] + i), e2z = _mm256_loadu_ps(lanes.edge2[2] + i);
+
+        __m256 hx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        __m256 hy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        __m256 hz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+        __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)), _mm256_mul_ps(e1z, hz));
+        __m256 f = _mm256_div_ps(one, a);
+
+        __m256 sx = offsetsAVX2(ox, lanes.vertex0[0] + i);
+        __m256 sy = offsetsAVX2(oy, lanes.vertex0[1] + i);
+        __m256 sz = offsetsAVX2(oz, lanes.vertex0[2] + i);
+        __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)), _mm256_mul_ps(sz, hz)));
+
+        __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+        __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+        __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+        __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+        __m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+
+        __m256 offsetNorm = normAVX2(sx, sy, sz);
+        __m256 edgeNorm = _mm256_loadu_ps(lanes.edgeNorm + i);
+        __m256 error = _mm256_mul_ps(_mm256_mul_ps(rounding, _mm256_andnot_ps(signBit, f)), edgeNorm);
+        __m256 directionError = _mm256_mul_ps(error, directionNorm);
+        __m256 conditioning = _mm256_mul_ps(directionError, edgeNorm);
+        __m256 uvPadding = _mm256_mul_ps(directionError, _mm256_add_ps(offsetNorm, edgeNorm));
+        __m256 tPadding = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(error, edgeNorm), offsetNorm), _mm256_mul_ps(conditioning, _mm256_andnot_ps(signBit, t)));
+
+        __m256 miss = _mm256_or_ps(_mm256_cmp_ps(_mm256_add_ps(u, uvPadding), zero, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_add_ps(v, uvPadding), zero, _CMP_LT_OQ));
+        miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_sub_ps(_mm256_add_ps(u, v), _mm256_add_ps(uvPadding, uvPadding)), one, _CMP_GT_OQ));
+        miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_add_ps(t, tPadding), tLower, _CMP_LT_OQ));
+        miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_sub_ps(t, tPadding), tUpper, _CMP_GT_OQ));
+        miss = _mm256_andnot_ps(_mm256_cmp_ps(conditioning, illConditioned, _CMP_GE_OQ), miss);
+        uint32_t bits = ~(uint32_t)_mm256_movemask_ps(miss) & liveLanes(last - i, 8);
+        count = appendCandidates(bits, i, candidates, count);
+    }
+    return count;
+}
+
+/*
+* Ray-sphere discriminant on eight spheres at a time, see sphereCandidatesSSE41
+*/
+SIMD_TARGET("avx2")
+static uint32_t sphereCandidatesAVX2(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m256 dx = _mm256_set1_ps(ray.direction[0]), dy = _mm256_set1_ps(ray.direction[1]), dz = _mm256_set1_ps(ray.direction[2]);
+    const __m256d ox = _mm256_set1_pd(ray.origin[0]), oy = _mm256_set1_pd(ray.origin[1]), oz = _mm256_set1_pd(ray.origin[2]);
+    const float lengthSquared = ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1] + ray.direction[2] * ray.direction[2];
+    const __m256 a = _mm256_set1_ps(lengthSquared), invA = _mm256_set1_ps(1.0f / lengthSquared);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 padding = _mm256_set1_ps(SIMD_DISCRIMINANT_PADDING);
+    const __m256 tLower = _mm256_set1_ps(ray.t_min), tUpper = _mm256_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 8) {
+        __m256 ocx = offsetsAVX2(ox, lanes.center[0] + i);
+        __m256 ocy = offsetsAVX2(oy, lanes.center[1] + i);
+        __m256 ocz = offsetsAVX2(oz, lanes.center[2] + i);
+        __m256 r2 = _mm256_loadu_ps(lanes.radiusSquared + i);
+
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ocx), _mm256_mul_ps(dy, ocy)), _mm256_mul_ps(dz, ocz));
+        __m256 ocSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+        __m256 bSquared = _mm256_mul_ps(b, b);
+        __m256 discriminant = _mm256_sub_ps(bSquared, _mm256_mul_ps(a, _mm256_sub_ps(ocSquared, r2)));
+        discriminant = _mm256_add_ps(discriminant, _mm256_mul_ps(padding, _mm256_add_ps(bSquared, _mm256_mul_ps(a, _mm256_add_ps(ocSquared, r2)))));
+
+        __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        __m256 tNear = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), root), invA);
+        __m256 tFar = _mm256_mul_ps(_mm256_sub_ps(root, b), invA);
+
+        __m256 mask = _mm256_and_ps(_mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ), _mm256_and_ps(_mm256_cmp_ps(tFar, tLower, _CMP_GE_OQ), _mm256_cmp_ps(tNear, tUpper, _CMP_LE_OQ)));
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(mask) & liveLanes(last - i, 8);
+        count = appendCandidates(bits, i, candidates, count);
+    }
+    return count;
+}
+
+/*
+* Sixteen-lane offsetsSSE41. The maskz forms of the conversion and the insert take zeros where the plain ones take an
+* undefined vector, which GCC warns about.
+*/
+SIMD_TARGET("avx512f")
+static inline __m512 offsetsAVX512(__m512d origin, const double* positions)
+{
+    const __mmask8 all = 0xFF;
+    __m256 low = _mm512_maskz_cvtpd_ps(all, _mm512_sub_pd(origin, _mm512_loadu_pd(positions)));
+    __m256 high = _mm512_maskz_cvtpd_ps(all, _mm512_sub_pd(origin, _mm512_loadu_pd(positions + 8)));
+    return _mm512_castpd_ps(_mm512_maskz_insertf64x4(all, _mm512_castps_pd(_mm512_castps256_ps512(low)), _mm256_castps_pd(high), 1));
+}
+
+/*
+* @return |x| + |y| + |z| in every lane
+*/
+SIMD_TARGET("avx512f")
+static inline __m512 normAVX512(__m512 x, __m512 y, __m512 z)
+{
+    return _mm512_add_ps(_mm512_add_ps(_mm512_abs_ps(x), _mm512_abs_ps(y)), _mm512_abs_ps(z));
+}
+
+/*
+* Moller-Trumbore on sixteen triangles at a time, see triangleCandidatesSSE41
+*/
+SIMD_TARGET("avx512f")
+static uint32_t triangleCandidatesAVX512(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m512 dx = _mm512_set1_ps(ray.direction[0]), dy = _mm512_set1_ps(ray.direction[1]), dz = _mm512_set1_ps(ray.direction[2]);
+    const __m512d ox = _mm512_set1_pd(ray.origin[0]), oy = _mm512_set1_pd(ray.origin[1]), oz = _mm512_set1_pd(ray.origin[2]);
+    const __m512 one = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+    const __m512 directionNorm = normAVX512(dx, dy, dz);
+    const __m512 rounding = _mm512_set1_ps(SIMD_ROUNDING_PADDING), illConditioned = _mm512_set1_ps(SIMD_ILL_CONDITIONED);
+    const __m512 tLower = _mm512_set1_ps(ray.t_min), tUpper = _mm512_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 16) {
+        __m512 e1x = _mm512_loadu_ps(lanes.edge1[0] + i), e1y = _mm512_loadu_ps(lanes.edge1[1] + i), e1z = _mm512_loadu_ps(lanes.edge1[2] + i);
+        __m512 e2x = _mm512_loadu_ps(lanes.edge2[0] + i), e2y = _mm512_loadu_ps(lanes.edge2[1] + i), e2z = _mm512_loadu_ps(lanes.edge2[2] + i);
+
+        __m512 hx = _mm512_sub_ps(_mm512_mul_ps(dy, e2z), _mm512_mul_ps(dz, e2y));
+        __m512 hy = _mm512_sub_ps(_mm512_mul_ps(dz, e2x), _mm512_mul_ps(dx, e2z));
+        __m512 hz = _mm512_sub_ps(_mm512_mul_ps(dx, e2y), _mm512_mul_ps(dy, e2x));
+        __m512 a = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(e1x, hx), _mm512_mul_ps(e1y, hy)), _mm512_mul_ps(e1z, hz));
+        __m512 f = _mm512_div_ps(one, a);
+
+        __m512 sx = offsetsAVX512(ox, lanes.vertex0[0] + i);
+        __m512 sy = offsetsAVX512(oy, lanes.vertex0[1] + i);
+        __m512 sz = offsetsAVX512(oz, lanes.vertex0[2] + i);
+        __m512 u = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, hx), _mm512_mul_ps(sy, hy)), _mm512_mul_ps(sz, hz)));
+
+        __m512 qx = _mm512_sub_ps(_mm512_mul_ps(sy, e1z), _mm512_mul_ps(sz, e1y));
+        __m512 qy = _mm512_sub_ps(_mm512_mul_ps(sz, e1x), _mm512_mul_ps(sx, e1z));
+        __m512 qz = _mm512_sub_ps(_mm512_mul_ps(sx, e1y), _mm512_mul_ps(sy, e1x));
+        __m512 v = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, qx), _mm512_mul_ps(dy, qy)), _mm512_mul_ps(dz, qz)));
+        __m512 t = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(e2x, qx), _mm512_mul_ps(e2y, qy)), _mm512_mul_ps(e2z, qz)));
+
+        __m512 offsetNorm = normAVX512(sx, sy, sz);
+        __m512 edgeNorm = _mm512_loadu_ps(lanes.edgeNorm + i);
+        __m512 error = _mm512_mul_ps(_mm512_mul_ps(rounding, _mm512_abs_ps(f)), edgeNorm);
+        __m512 directionError = _mm512_mul_ps(error, directionNorm);
+        __m512 conditioning = _mm512_mul_ps(directionError, edgeNorm);
+        __m512 uvPadding = _mm512_mul_ps(directionError, _mm512_add_ps(offsetNorm, edgeNorm));
+        __m512 tPadding = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(error, edgeNorm), offsetNorm), _mm512_mul_ps(conditioning, _mm512_abs_ps(t)));
+
+        __mmask16 miss = _mm512_cmp_ps_mask(_mm512_add_ps(u, uvPadding), zero, _CMP_LT_OQ);
+        miss |= _mm512_cmp_ps_mask(_mm512_add_ps(v, uvPadding), zero, _CMP_LT_OQ);
+        miss |= _mm512_cmp_ps_mask(_mm512_sub_ps(_mm512_add_ps(u, v), _mm512_add_ps(uvPadding, uvPadding)), one, _CMP_GT_OQ);
+        miss |= _mm512_cmp_ps_mask(_mm512_add_ps(t, tPadding), tLower, _CMP_LT_OQ);
+        miss |= _mm512_cmp_ps_mask(_mm512_sub_ps(t, tPadding), tUpper, _CMP_GT_OQ);
+        miss &= ~_mm512_cmp_ps_mask(conditioning, illConditioned, _CMP_GE_OQ);
+        uint32_t bits = ~(uint32_t)miss & liveLanes(last - i, 16);
+        count = appendCandidates(bits, i, candidates, count);
+    }
+    return count;
+}
+
+/*
+* Ray-sphere discriminant on sixteen spheres at a time, see sphereCandidatesSSE41
+*/
+SIMD_TARGET("avx512f")
+static uint32_t sphereCandidatesAVX512(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    const __m512 dx = _mm512_set1_ps(ray.direction[0]), dy = _mm512_set1_ps(ray.direction[1]), dz = _mm512_set1_ps(ray.direction[2]);
+    const __m512d ox = _mm512_set1_pd(ray.origin[0]), oy = _mm512_set1_pd(ray.origin[1]), oz = _mm512_set1_pd(ray.origin[2]);
+    const float lengthSquared = ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1] + ray.direction[2] * ray.direction[2];
+    const __m512 a = _mm512_set1_ps(lengthSquared), invA = _mm512_set1_ps(1.0f / lengthSquared);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 padding = _mm512_set1_ps(SIMD_DISCRIMINANT_PADDING);
+    const __m512 tLower = _mm512_set1_ps(ray.t_min), tUpper = _mm512_set1_ps(ray.t_max);
+
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; i += 16) {
+        __m512 ocx = offsetsAVX512(ox, lanes.center[0] + i);
+        __m512 ocy = offsetsAVX512(oy, lanes.center[1] + i);
+        __m512 ocz = offsetsAVX512(oz, lanes.center[2] + i);
+        __m512 r2 = _mm512_loadu_ps(lanes.radiusSquared + i);
+
+        __m512 b = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, ocx), _mm512_mul_ps(dy, ocy)), _mm512_mul_ps(dz, ocz));
+        __m512 ocSquared = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, ocx), _mm512_mul_ps(ocy, ocy)), _mm512_mul_ps(ocz, ocz));
+        __m512 bSquared = _mm512_mul_ps(b, b);
+        __m512 discriminant = _mm512_sub_ps(bSquared, _mm512_mul_ps(a, _mm512_sub_ps(ocSquared, r2)));
+        discriminant = _mm512_add_ps(discriminant, _mm512_mul_ps(padding, _mm512_add_ps(bSquared, _mm512_mul_ps(a, _mm512_add_ps(ocSquared, r2)))));
+
+        // maskz_sqrt zeroes the other lanes itself, and unlike a plain sqrt gives GCC no undefined vector to warn about
+        __mmask16 mask = _mm512_mask_cmp_ps_mask((__mmask16)liveLanes(last - i, 16), discriminant, zero, _CMP_GE_OQ);
+        __m512 root = _mm512_maskz_sqrt_ps(mask, discriminant);
+        __m512 tNear = _mm512_mul_ps(_mm512_sub_ps(_mm512_sub_ps(zero, b), root), invA);
+        __m512 tFar = _mm512_mul_ps(_mm512_sub_ps(root, b), invA);
+
+        mask = _mm512_mask_cmp_ps_mask(mask, tFar, tLower, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, tNear, tUpper, _CMP_LE_OQ);
+        count = appendCandidates((uint32_t)mask, i, candidates, count);
+    }
+    return count;
+}
+
+#endif
+
+/*
+* @param level A SimdLevel
+*
+* @return The kernels built for that level
+*/
+static KernelTable kernelTable(SimdLevel level)
+{
+#if defined(SIMD_KERNELS_X86)
+    switch (level) {
+    case SimdLevel::AVX512:
+        return { level, 16, triangleCandidatesAVX512, sphereCandidatesAVX512 };
+    case SimdLevel::AVX2:
+        return { level, 8, triangleCandidatesAVX2, sphereCandidatesAVX2 };
+    case SimdLevel::SSE41:
+        return { level, 4, triangleCandidatesSSE41, sphereCandidatesSSE41 };
+    default:
+        break;
+    }
+#endif
+    return { SimdLevel::Scalar, 1, triangleCandidatesScalar, sphereCandidatesScalar };
+}
+
+/*
+* @return The kernels in use, the widest the CPU supports unless lowered with SimdKernels::setLevel
+*/
+static KernelTable& activeKernels()
+{
+    static KernelTable table = kernelTable(SimdKernels::detectedLevel());
+    return table;
+}
+
+/*
+* Asks the CPU (and the OS, which has to save the wider registers) which instruction sets can be used. Only runs once.
+*
+* @return The widest SimdLevel this machine supports
+*/
+SimdLevel SimdKernels::detectedLevel()
+{
+    static const SimdLevel detected = []() {
+#if defined(SIMD_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        const bool sse41 = (info[2] & (1 << 19)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        const bool ymmSaved = (xcr0 & 0x6) == 0x6;
+        const bool zmmSaved = (xcr0 & 0xE6) == 0xE6;
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        const bool avx512 = (info[1] & (1 << 16)) != 0;
+        if (avx512 && zmmSaved) {
+            return SimdLevel::AVX512;
+        }
+        if (avx2 && ymmSaved) {
+            return SimdLevel::AVX2;
+        }
+        return sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar;
+#elif defined(SIMD_KERNELS_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        return __builtin_cpu_supports("sse4.1") ? SimdLevel::SSE41 : SimdLevel::Scalar;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }();
+    return detected;
+}
+
+/*
+* @return The SimdLevel of the kernels in use
+*/
+SimdLevel SimdKernels::level()
+{
+    return activeKernels().level;
+}
+
+/*
+* Switches the kernels to another level, e.g. to compare them. Levels the CPU doesn't support fall back to the detected one.
+* Not thread-safe: call it before rendering.
+*
+* @param level The SimdLevel to use
+*/
+void SimdKernels::setLevel(SimdLevel level)
+{
+    activeKernels() = kernelTable(level > detectedLevel() ? detectedLevel() : level);
+}
+
+/*
+* @param level A SimdLevel
+*
+* @return The name of the instruction set
+*/
+const char* SimdKernels::levelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE41:
+        return "SSE4.1";
+    default:
+        return "Scalar";
+    }
+}
+
+/*
+* @return How many slots the kernels in use test at once
+*/
+uint32_t SimdKernels::laneCount()
+{
+    return activeKernels().laneCount;
+}
+
+/*
+* Filters triangle slots with the kernel in use, see SimdKernels.h
+*/
+uint32_t SimdKernels::triangleCandidates(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    return activeKernels().triangles(lanes, first, last, ray, candidates);
+}
+
+/*
+* Filters sphere slots with the kernel in use, see SimdKernels.h
+*/
+uint32_t SimdKernels::sphereCandidates(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates)
+{
+    return activeKernels().spheres(lanes, first, last, ray, candidates);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Vec3D.h"
+
+constexpr uint32_t SIMD_MAX_LANES = 16;                 // widest kernel (AVX-512), the lanes are padded by this many slots
+constexpr uint32_t SIMD_CANDIDATE_BATCH = 64;           // slots filtered per kernel call, so the candidate buffer fits on the stack
+constexpr uint32_t SIMD_MIN_SLOTS = 2;                  // fewer slots are tested exactly, skipping the float filter
+constexpr float SIMD_ROUNDING_PADDING = 8e-6f;          // about 64 float epsilons: a float lane's rounding error, relative to its operands' magnitudes
+constexpr float SIMD_ILL_CONDITIONED = 0.5f;            // lanes whose determinant's bounded error reaches this fraction of it are always candidates
+constexpr float SIMD_DISCRIMINANT_PADDING = 1e-4f;      // relative slack on a float lane's ray-sphere discriminant
+constexpr double SIMD_T_PADDING = 1e-3;                 // relative slack on the t-interval the float lanes are tested against
+
+// Instruction sets the kernels are compiled for, in increasing width. The widest one the CPU supports is picked at run time.
+enum class SimdLevel { Scalar, SSE41, AVX2, AVX512 };
+
+// SoA view of packed triangles: the first vertex and both edges, one array per axis. The first vertex stays in double,
+// so its offset to the ray origin is exact before it is rounded to float.
+struct TriangleLanes {
+    const double* vertex0[3];
+    const float* edge1[3];
+    const float* edge2[3];
+    const float* edgeNorm;      // |edge1|_1 + |edge2|_1, the scale of the triangle in the rounding bounds
+};
+
+// SoA view of packed spheres, the centers in double like TriangleLanes::vertex0
+struct SphereLanes {
+    const double* center[3];
+    const float* radiusSquared;
+};
+
+// A ray prepared for the kernels. The origin stays in double, the direction is rounded to float. Its t-interval is
+// widened by SIMD_T_PADDING, so rounding can't make a kernel reject a hit the exact double test would accept.
+struct SimdRay {
+    double origin[3];
+    float direction[3];
+    float t_min;
+    float t_max;
+
+    SimdRay(const Point3D& origin, const Vec3D& direction, double t_min, double t_max);
+};
+
+namespace SimdKernels
+{
+    SimdLevel detectedLevel();
+    SimdLevel level();
+    void setLevel(SimdLevel level);
+    const char* levelName(SimdLevel level);
+    uint32_t laneCount();
+
+    // Write the slots in [first, last) the ray may hit to candidates, in increasing order, and return how many there are.
+    // Every slot the exact test would accept is a candidate; a few it would reject may be too. last - first must not
+    // exceed SIMD_CANDIDATE_BATCH, and the lanes must be padded by SIMD_MAX_LANES slots past last.
+    uint32_t triangleCandidates(const TriangleLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates);
+    uint32_t sphereCandidates(const SphereLanes& lanes, uint32_t first, uint32_t last, const SimdRay& ray, uint32_t* candidates);
+}
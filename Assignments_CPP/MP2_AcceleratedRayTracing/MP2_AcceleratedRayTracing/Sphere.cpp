@@ -35,6 +35,18 @@ const double& Sphere::getRadius() const
 	return radius;
 }
 
+/*
+* Moves the Sphere. A BVH already built over it has to be told, see World::updateSceneObject.
+*
+* @param center The new center of the Sphere
+*/
+void Sphere::setCenter(const Point3D& center)
+{
+	this->center = center;
+	boundingBox.min() = Point3D(center[0] - radius, center[1] - radius, center[2] - radius);
+	boundingBox.max() = Point3D(center[0] + radius, center[1] + radius, center[2] + radius);
+}
+
 /*
 * Find the intersection points, if any, with a Ray3D
 *
@@ -56,27 +68,61 @@ int Sphere::intersection(const Ray3D& ray, const double& t_min, const double& t_
 	double b = 2.0 * B.dotProduct(A - C);
 	double c = (A - C).euclideanSquared() - pow(R, 2.0);
 
-	std::vector<double> potentialSols;
+	double potentialSols[2];
 	int sol_count = Arithmetic::quadratic_solver(a, b, c, potentialSols);
 	
 	if (sol_count == 0) {
 		return 0;
 	}
-	std::vector<double> sols;
-	for (double ps : potentialSols) {
-		if (!(ps < Arithmetic::EPSILON || ps < t_min || ps > t_max)) {
-			sols.push_back(ps);
+	bool found = false;
+	double intT = 0;
+	for (int i = 0; i < sol_count; i++) {
+		const double ps = potentialSols[i];
+		if (!(ps < Arithmetic::EPSILON || ps < t_min || ps > t_max) && (!found || ps < intT)) {
+			found = true;
+			intT = ps;
 		}
 	}
-	if (sols.size() == 0) {
+	if (!found) {
 		return 0;
 	}
-	double intT = *(std::min_element(sols.begin(), sols.end()));
 	Point3D intPoint = ray.pos(intT);
 	hitRecord = HitRecord(intT, intPoint, this->normal(intPoint), getAmbient(), getDiffuse(), getSpecular(), getAlpha());
 	return 1;
 }
 
+/*
+* Checks whether a Ray3D hits the Sphere anywhere in [t_min, t_max], without computing the hit point or normal
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return True if either root of the ray-sphere quadratic lies in [t_min, t_max]
+*/
+bool Sphere::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	const Vec3D& B = ray.getDirection();
+	Vec3D AC = ray.getStart() - center;
+
+	double a = B.euclideanSquared();
+	double b = 2.0 * B.dotProduct(AC);
+	double c = AC.euclideanSquared() - radius * radius;
+	double discriminant = b * b - 4.0 * a * c;
+	if (discriminant < 0.0) {
+		return false;
+	}
+
+	double root = std::sqrt(discriminant);
+	double lower = std::max(t_min, Arithmetic::EPSILON);
+	for (double t : { (-b - root) / (2.0 * a), (-b + root) / (2.0 * a) }) {
+		if (t >= lower && t <= t_max) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /*
 * Get the normal vector of the object at a specified intersection point
 *
@@ -16,8 +16,10 @@ public:
 
     const Point3D& getCenter() const;
     const double& getRadius() const;
+    void setCenter(const Point3D& center);
 
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
     Vec3D normal(const Point3D& intersection) const;
     bool generateBoundingBox(AABB3D& bb) const;
 
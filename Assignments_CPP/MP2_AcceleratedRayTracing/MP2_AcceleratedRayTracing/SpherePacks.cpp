@@ -0,0 +1,167 @@
+#include "SpherePacks.h"
+
+#include <algorithm>
+
+/*
+* Packs the spheres referenced by primitiveIndices, one slot per reference. Nothing is packed unless every primitive is a Sphere.
+*
+* @param primitives The primitives of the BVH
+* @param primitiveIndices The primitive indices referenced by the BVH's leaves
+*
+* @return True if the spheres were packed, false if the packs were left empty
+*/
+bool SpherePacks::build(const std::vector<std::shared_ptr<Object>>& primitives, const std::vector<uint32_t>& primitiveIndices)
+{
+    clear();
+    if (primitiveIndices.empty()) {
+        return false;
+    }
+    for (const std::shared_ptr<Object>& primitive : primitives) {
+        if (primitive->getObjectType() != ObjectType::Sphere) {
+            return false;
+        }
+    }
+
+    size_t n = primitiveIndices.size();
+    spheres.resize(n);
+    for (int a = 0; a < 3; a++) {
+        center[a].assign(n + SIMD_MAX_LANES, 0.0);
+    }
+    radiusSquared.assign(n + SIMD_MAX_LANES, 0.0f);
+
+    for (size_t i = 0; i < n; i++) {
+        const Sphere* sphere = static_cast<const Sphere*>(primitives[primitiveIndices[i]].get());
+        spheres[i] = sphere;
+        for (int a = 0; a < 3; a++) {
+            center[a][i] = sphere->getCenter()[a];
+        }
+        radiusSquared[i] = (float)(sphere->getRadius() * sphere->getRadius());
+    }
+    return true;
+}
+
+/*
+* Empties the packs
+*/
+void SpherePacks::clear()
+{
+    std::vector<const Sphere*>().swap(spheres);
+    for (int a = 0; a < 3; a++) {
+        std::vector<double>().swap(center[a]);
+    }
+    std::vector<float>().swap(radiusSquared);
+}
+
+/*
+* @return True if no spheres are packed
+*/
+bool SpherePacks::empty() const
+{
+    return spheres.empty();
+}
+
+/*
+* @return The number of packed slots
+*/
+size_t SpherePacks::size() const
+{
+    return spheres.size();
+}
+
+/*
+* @return The bytes held by the packs
+*/
+size_t SpherePacks::memoryBytes() const
+{
+    return size() * sizeof(const Sphere*) + (empty() ? 0 : (size() + SIMD_MAX_LANES) * (3 * sizeof(double) + sizeof(float)));
+}
+
+/*
+* @return The packs, as the SIMD kernels take them
+*/
+SphereLanes SpherePacks::lanes() const
+{
+    SphereLanes view;
+    for (int a = 0; a < 3; a++) {
+        view.center[a] = center[a].data();
+    }
+    view.radiusSquared = radiusSquared.data();
+    return view;
+}
+
+/*
+* Finds the closest sphere in slots [first, last) that a ray hits in [t_min, closest]. The SIMD kernel in use filters
+* the slots, then the candidates it passes are intersected in slot order.
+*
+* @param first The first slot
+* @param last One past the last slot
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param closest The maximum intersection t, lowered to every closer hit. Modified by function.
+* @param hitRecord HitRecord struct holding the closest hit (if any). Modified by function.
+*
+* @return True if any sphere in the slots was hit
+*/
+bool SpherePacks::intersect(uint32_t first, uint32_t last, const Ray3D& ray, double t_min, double& closest, HitRecord& hitRecord) const
+{
+    bool hit = false;
+    if (last - first < SIMD_MIN_SLOTS) {
+        for (uint32_t i = first; i < last; i++) {
+            if (spheres[i]->intersection(ray, t_min, closest, hitRecord)) {
+                hit = true;
+                closest = hitRecord.intT;
+            }
+        }
+        return hit;
+    }
+
+    const SphereLanes view = lanes();
+    uint32_t candidates[SIMD_CANDIDATE_BATCH];
+    for (uint32_t batch = first; batch < last; batch += SIMD_CANDIDATE_BATCH) {
+        const SimdRay simdRay(ray.getStart(), ray.getDirection(), t_min, closest);
+        uint32_t count = SimdKernels::sphereCandidates(view, batch, std::min(last, batch + SIMD_CANDIDATE_BATCH), simdRay, candidates);
+        for (uint32_t c = 0; c < count; c++) {
+            if (spheres[candidates[c]]->intersection(ray, t_min, closest, hitRecord)) {
+                hit = true;
+                closest = hitRecord.intT;
+            }
+        }
+    }
+    return hit;
+}
+
+/*
+* Checks whether a ray hits any sphere in slots [first, last) within [t_min, t_max]
+*
+* @param first The first slot
+* @param last One past the last slot
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any sphere in the slots was hit
+*/
+bool SpherePacks::occluded(uint32_t first, uint32_t last, const Ray3D& ray, double t_min, double t_max) const
+{
+    if (last - first < SIMD_MIN_SLOTS) {
+        for (uint32_t i = first; i < last; i++) {
+            if (spheres[i]->occluded(ray, t_min, t_max)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const SphereLanes view = lanes();
+    const SimdRay simdRay(ray.getStart(), ray.getDirection(), t_min, t_max);
+    uint32_t candidates[SIMD_CANDIDATE_BATCH];
+    for (uint32_t batch = first; batch < last; batch += SIMD_CANDIDATE_BATCH) {
+        uint32_t count = SimdKernels::sphereCandidates(view, batch, std::min(last, batch + SIMD_CANDIDATE_BATCH), simdRay, candidates);
+        for (uint32_t c = 0; c < count; c++) {
+            if (spheres[candidates[c]]->occluded(ray, t_min, t_max)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "Sphere.h"
+#include "SimdKernels.h"
+
+// Structure-of-arrays copy of the spheres a BVH's leaves refer to, in leaf reference order, so the SIMD kernels
+// can test a whole leaf against the ray at once. Only the spheres they pass are intersected exactly, through the Sphere
+// itself, so hits are the same as without the packs.
+struct SpherePacks {
+    std::vector<const Sphere*> spheres;
+    std::vector<double> center[3];          // padded with SIMD_MAX_LANES empty slots
+    std::vector<float> radiusSquared;
+
+    bool build(const std::vector<std::shared_ptr<Object>>& primitives, const std::vector<uint32_t>& primitiveIndices);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    size_t memoryBytes() const;
+    SphereLanes lanes() const;
+
+    bool intersect(uint32_t first, uint32_t last, const Ray3D& ray, double t_min, double& closest, HitRecord& hitRecord) const;
+    bool occluded(uint32_t first, uint32_t last, const Ray3D& ray, double t_min, double t_max) const;
+};
@@ -0,0 +1,155 @@
+#include "ThreadPool.h"
+
+/*
+* Constructor for ThreadPool
+*
+* @param threadCount The number of worker threads (at least one is always started)
+*/
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+/*
+* Destructor for ThreadPool. Finishes all queued tasks, then joins the workers.
+*/
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+* Main loop of every worker thread: run tasks until the pool is stopped and the queue is drained
+*/
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/*
+* Runs one queued task on the calling thread, if there is one
+*
+* @return True if a task was run, false if the queue was empty
+*/
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = std::move(tasks.back());
+        tasks.pop_back();
+    }
+    task();
+    return true;
+}
+
+/*
+* @return The number of worker threads
+*/
+size_t ThreadPool::getThreadCount() const
+{
+    return workers.size();
+}
+
+/*
+* Queues a task to run on one of the workers
+*
+* @param task The task
+*
+* @return A future which becomes ready once the task has run
+*/
+std::future<void> ThreadPool::submit(const std::function<void()>& task)
+{
+    std::shared_ptr<std::packaged_task<void()>> packagedTask = std::make_shared<std::packaged_task<void()>>(task);
+    std::future<void> future = packagedTask->get_future();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks.emplace_back([packagedTask] { (*packagedTask)(); });
+    }
+    condition.notify_one();
+    return future;
+}
+
+/*
+* Waits for a task to finish, running other queued tasks on the calling thread in the meantime.
+* This makes it safe for tasks to wait on the tasks they submit.
+*
+* @param future The future returned by submit
+*/
+void ThreadPool::wait(std::future<void>& future)
+{
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!runPendingTask()) {
+            future.wait_for(std::chrono::microseconds(50));
+        }
+    }
+    future.get();
+}
+
+/*
+* Runs body over [begin, end) split into chunks of at most grainSize elements, and waits for all of them
+*
+* @param begin The first index
+* @param end One past the last index
+* @param grainSize The largest number of indices handed to a single call of body
+* @param body The function to run, called with the [start, end) range of one chunk
+*/
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+{
+    if (end <= begin) {
+        return;
+    }
+    if (grainSize == 0) {
+        grainSize = 1;
+    }
+
+    std::vector<std::future<void>> futures;
+    size_t chunkStart = begin + grainSize;
+    while (chunkStart < end) {
+        size_t chunkEnd = std::min(end, chunkStart + grainSize);
+        futures.push_back(submit([&body, chunkStart, chunkEnd] { body(chunkStart, chunkEnd); }));
+        chunkStart = chunkEnd;
+    }
+
+    // The calling thread takes the first chunk itself
+    body(begin, std::min(end, begin + grainSize));
+    for (std::future<void>& future : futures) {
+        wait(future);
+    }
+}
+
+/*
+* @return A pool shared by the whole program, with one worker per hardware thread
+*/
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
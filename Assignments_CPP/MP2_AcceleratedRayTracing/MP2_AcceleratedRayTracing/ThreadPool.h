@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+
+    void workerLoop();
+    bool runPendingTask();
+
+public:
+    ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    size_t getThreadCount() const;
+
+    std::future<void> submit(const std::function<void()>& task);
+    void wait(std::future<void>& future);
+    void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+    static ThreadPool& global();
+};
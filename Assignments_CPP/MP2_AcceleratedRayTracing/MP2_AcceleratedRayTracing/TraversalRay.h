@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+
+#include "Ray3D.h"
+
+// Scale on a slab test's exit t so rounding in the test can't make a ray miss a box it grazes (Ize 2013: 1 + 2 * gamma(3))
+constexpr double TRAVERSAL_RAY_EXIT_SCALE = 1.0 + 2.0 * (3 * 0.5 * DBL_EPSILON) / (1.0 - 3 * 0.5 * DBL_EPSILON);
+
+// A Ray3D prepared for acceleration structure traversal. The reciprocal direction and its per-axis signs are computed once
+// per ray, so a node's slab test is a subtraction and a multiplication per plane with no divisions or swaps.
+// tMax is meant to be lowered to the closest hit as the traversal finds it.
+struct TraversalRay {
+    double origin[3];
+    double invDir[3];       // +-infinity along axes the direction is zero on
+    uint8_t sign[3];        // 1 where the direction is negative (including -0), so the near plane is the box's maximum
+    double tMin;
+    double tMax;
+
+    TraversalRay();
+    TraversalRay(const Ray3D& ray, double tMin, double tMax);
+
+    void set(const Ray3D& ray, double tMin, double tMax);
+
+    /*
+    * Slab test against a box within [tMin, tMax]. The near and far planes are picked by sign, and a ray lying in a slab's
+    * plane (0 * infinity = NaN) is kept, since the comparisons drop NaNs in favor of the running interval.
+    *
+    * @param boundsMin The minimum corner of the box (anything indexable by axis: float[3], Point3D, ...)
+    * @param boundsMax The maximum corner of the box
+    * @param t_entry The t at which the ray enters the box (clamped to tMin). Modified by function.
+    *
+    * @return True if the ray enters the box within [tMin, tMax]
+    */
+    template <typename Bounds>
+    bool hitBox(const Bounds& boundsMin, const Bounds& boundsMax, double& t_entry) const {
+        double t_near = tMin;
+        double t_far = tMax;
+        for (int a = 0; a < 3; a++) {
+            const double nearPlane = sign[a] ? boundsMax[a] : boundsMin[a];
+            const double farPlane = sign[a] ? boundsMin[a] : boundsMax[a];
+            const double t0 = (nearPlane - origin[a]) * invDir[a];
+            const double t1 = (farPlane - origin[a]) * invDir[a] * TRAVERSAL_RAY_EXIT_SCALE;
+            t_near = t0 > t_near ? t0 : t_near;
+            t_far = t1 < t_far ? t1 : t_far;
+        }
+        t_entry = t_near;
+        return t_near <= t_far;
+    }
+};
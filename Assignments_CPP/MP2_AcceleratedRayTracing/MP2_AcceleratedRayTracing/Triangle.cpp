@@ -14,25 +14,9 @@ Triangle::Triangle(const Point3D(&v)[3], const ColorRGB& diffuse, const ColorRGB
 	vertices[0] = v[0];
 	vertices[1] = v[1];
 	vertices[2] = v[2];
-	
-	Vec3D A = vertices[1] - vertices[0];
-	Vec3D B = vertices[2] - vertices[0];
-	normals[0] = B.crossProduct(A);
-	normals[0].normalize();
 
 	meshTriangle = false;
-
-	Point3D minPoint;
-	Point3D maxPoint;
-
-	for (int i = 0; i < 3; i++) {
-		minPoint[i] = std::min(vertices[0][i], std::min(vertices[1][i], vertices[2][i]));
-		maxPoint[i] = std::max(vertices[0][i], std::max(vertices[1][i], vertices[2][i]));
-	}
-
-	boundingBox = AABB3D();
-	boundingBox.min() = minPoint;
-	boundingBox.max() = maxPoint;
+	precompute();
 }
 
 /*
@@ -61,18 +45,27 @@ Triangle::Triangle(const Point3D(&v)[3], const Vec3D(&n)[3], const ColorRGB& amb
 
 
 	meshTriangle = true;
+	precompute();
+}
+
+/*
+* Computes everything derived from the vertices: the edges used by the intersection test, the face normal
+* (mesh triangles interpolate their vertex normals instead) and the bounding box
+*/
+void Triangle::precompute()
+{
+	edge1 = vertices[1] - vertices[0];
+	edge2 = vertices[2] - vertices[0];
 
-	Point3D minPoint;
-	Point3D maxPoint;
+	if (!meshTriangle) {
+		normals[0] = edge2.crossProduct(edge1);
+		normals[0].normalize();
+	}
 
 	for (int i = 0; i < 3; i++) {
-		minPoint[i] = std::min(vertices[0][i], std::min(vertices[1][i], vertices[2][i]));
-		maxPoint[i] = std::max(vertices[0][i], std::max(vertices[1][i], vertices[2][i]));
+		boundingBox.min()[i] = std::min(vertices[0][i], std::min(vertices[1][i], vertices[2][i]));
+		boundingBox.max()[i] = std::max(vertices[0][i], std::max(vertices[1][i], vertices[2][i]));
 	}
-
-	boundingBox = AABB3D();
-	boundingBox.min() = minPoint;
-	boundingBox.max() = maxPoint;
 }
 
 /*
@@ -112,6 +105,42 @@ const Point3D& Triangle::vertex2() const
 	return vertices[2];
 }
 
+/*
+* @return The first edge of the Triangle (vertex1 - vertex0)
+*/
+const Vec3D& Triangle::getEdge1() const
+{
+	return edge1;
+}
+
+/*
+* @return The second edge of the Triangle (vertex2 - vertex0)
+*/
+const Vec3D& Triangle::getEdge2() const
+{
+	return edge2;
+}
+
+/*
+* Moves the Triangle, updating its edges and bounding box
+*
+* @param v The new vertices of the Triangle
+* @param n The new vertex normals (only used by mesh triangles, others recompute their face normal)
+*/
+void Triangle::setVertices(const Point3D(&v)[3], const Vec3D(&n)[3])
+{
+	for (int i = 0; i < 3; i++) {
+		vertices[i] = v[i];
+	}
+
+	if (meshTriangle) {
+		for (int i = 0; i < 3; i++) {
+			normals[i] = n[i];
+		}
+	}
+	precompute();
+}
+
 /*
 * Find the intersection points, if any, with a Ray3D
 *
@@ -124,19 +153,51 @@ const Point3D& Triangle::vertex2() const
 */
 int Triangle::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
 {
-	double intT;
-	Point3D intPoint;
-	bool intersected = Arithmetic::moller_trumbore(ray.getStart(), ray.getDirection(), vertices, intT, intPoint);
+	double intT, u, v;
+	bool intersected = Arithmetic::moller_trumbore(ray.getStart(), ray.getDirection(), vertices[0], edge1, edge2, intT, u, v);
 	if (intersected) {
 		if (intT < t_min || intT > t_max) {
 			return 0;
 		}
-		hitRecord = HitRecord(intT, intPoint, this->normal(intPoint), getAmbient(), getDiffuse(), getSpecular(), getAlpha());
+		makeHitRecord(ray, intT, u, v, hitRecord);
 		return 1;
 	}
 	return 0;
 }
 
+/*
+* Fills a HitRecord for a hit already found, such as one found by a BVH's packed triangle test
+*
+* @param ray A Ray3D.
+* @param intT The t-value of the intersection.
+* @param u The barycentric weight of vertex1 at the intersection
+* @param v The barycentric weight of vertex2 at the intersection
+* @param hitRecord A HitRecord struct which will store information related to the intersection. Modified by function.
+*/
+void Triangle::makeHitRecord(const Ray3D& ray, const double& intT, const double& u, const double& v, HitRecord& hitRecord) const
+{
+	Point3D intPoint = ray.getStart() + ray.getDirection() * intT;
+	hitRecord = HitRecord(intT, intPoint, this->normal(u, v), getAmbient(), getDiffuse(), getSpecular(), getAlpha());
+}
+
+/*
+* Checks whether a Ray3D hits the Triangle in [t_min, t_max], without computing the normal
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return True if the ray hits the Triangle in [t_min, t_max]
+*/
+bool Triangle::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	double intT, u, v;
+	if (Arithmetic::moller_trumbore(ray.getStart(), ray.getDirection(), vertices[0], edge1, edge2, intT, u, v)) {
+		return intT >= t_min && intT <= t_max;
+	}
+	return false;
+}
+
 /*
 * Get the normal vector of the object at a specified intersection point
 * May use face or barycentric normal
@@ -159,6 +220,25 @@ Vec3D Triangle::normal(const Point3D& intersection) const
 
 }
 
+/*
+* Get the normal vector of the Triangle at a point given by its barycentric coordinates, as returned by the intersection test.
+* Saves solving for the barycentric coordinates of the point a second time.
+*
+* @param u The barycentric weight of vertex1
+* @param v The barycentric weight of vertex2
+*
+* @return The face normal, or the interpolated vertex normal for mesh triangles
+*/
+Vec3D Triangle::normal(const double& u, const double& v) const
+{
+	if (!meshTriangle) {
+		return normals[0];
+	}
+	Vec3D weightedNormal{ (normals[0] * (1.0 - u - v)) + (normals[1] * u) + (normals[2] * v) };
+	weightedNormal.normalize();
+	return weightedNormal;
+}
+
 /*
 * Generates an axis-aligned bounding box for the object
 *
@@ -12,8 +12,12 @@ class Triangle :
 private:
     Point3D vertices[3];
     Vec3D normals[3];
+    Vec3D edge1;    // vertices[1] - vertices[0]
+    Vec3D edge2;    // vertices[2] - vertices[0]
     bool meshTriangle;
     AABB3D boundingBox;
+
+    void precompute();
 public:
     Triangle(const Point3D(&v)[3], const ColorRGB& ambient = DEFAULT_COLOR, const ColorRGB& diffuse = DEFAULT_COLOR, const ColorRGB& specular = DEFAULT_COLOR, const double& alpha = DEFAULT_ALPHA);
     Triangle(const Point3D(&v)[3], const Vec3D(&n)[3], const ColorRGB& ambient = DEFAULT_COLOR, const ColorRGB& diffuse = DEFAULT_COLOR, const ColorRGB& specular = DEFAULT_COLOR, const double& alpha = DEFAULT_ALPHA);
@@ -23,9 +27,15 @@ public:
     const Point3D& vertex0() const;
     const Point3D& vertex1() const;
     const Point3D& vertex2() const;
+    const Vec3D& getEdge1() const;
+    const Vec3D& getEdge2() const;
+    void setVertices(const Point3D(&v)[3], const Vec3D(&n)[3]);
 
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    void makeHitRecord(const Ray3D& ray, const double& intT, const double& u, const double& v, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
     Vec3D normal(const Point3D& intersection) const;
+    Vec3D normal(const double& u, const double& v) const;
     bool generateBoundingBox(AABB3D& bb) const;
 
     std::string toString() const;
@@ -69,6 +69,36 @@ void TriangleMesh::loadFromOBJFile(const std::string& path)
 	generateTriangles(vertices, faces, normals, triangles);
 }
 
+/*
+* Load a model from flat vertex, normal and face buffers (e.g. a BVHCache) without recomputing the normals.
+*
+* @param vertexData The x, y, z coordinates of every vertex
+* @param normalData The x, y, z components of every vertex normal
+* @param vertexCount The number of vertices (and normals)
+* @param faceData The three zero-based vertex indices of every face
+* @param faceCount The number of faces
+*/
+void TriangleMesh::loadFromBuffers(const double* vertexData, const double* normalData, size_t vertexCount, const uint32_t* faceData, size_t faceCount)
+{
+	vertices.clear();
+	normals.clear();
+	faces.clear();
+	triangles.clear();
+
+	vertices.reserve(vertexCount);
+	normals.reserve(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		vertices.push_back(std::make_shared<Point3D>(vertexData[3 * i], vertexData[3 * i + 1], vertexData[3 * i + 2]));
+		normals.push_back(std::make_shared<Vec3D>(normalData[3 * i], normalData[3 * i + 1], normalData[3 * i + 2]));
+	}
+	faces.reserve(faceCount);
+	for (size_t i = 0; i < faceCount; i++) {
+		faces.push_back(std::make_shared<TriangleFace>(faceData[3 * i], faceData[3 * i + 1], faceData[3 * i + 2]));
+	}
+
+	generateTriangles(vertices, faces, normals, triangles);
+}
+
 /*
 * Add a transformation from the model space to the world space.
 * 
@@ -82,6 +112,30 @@ void TriangleMesh::addTransformation(const Mat4& transformationMatrix, const Tra
 	inverseModelViewMatrix = inverseModelViewMatrix * inverseTransformationMatrix;
 }
 
+/*
+* Moves every Triangle to its model-space vertices transformed by the current modelViewMatrix.
+* The Triangles are updated in place, so a BVH built over them stays valid and only needs a refit.
+*/
+void TriangleMesh::applyModelViewMatrix()
+{
+	// Normals transform by the inverse transpose so they stay perpendicular under non-uniform scales
+	Mat4 normalMatrix = inverseModelViewMatrix.getTranspose();
+
+	ThreadPool::global().parallelFor(0, faces.size(), 4096, [&](size_t start, size_t end) {
+		for (size_t i = start; i < end; i++) {
+			const TriangleFace& face = *faces[i];
+			size_t idxs[3]{ face.v0_idx, face.v1_idx, face.v2_idx };
+			Point3D currVertices[3];
+			Vec3D currNormals[3];
+			for (int k = 0; k < 3; k++) {
+				currVertices[k] = modelViewMatrix.transformPoint(*vertices[idxs[k]]);
+				currNormals[k] = normalMatrix.transformVector(*normals[idxs[k]]).get_normalized();
+			}
+			triangles[i]->setVertices(currVertices, currNormals);
+		}
+	});
+}
+
 /*
 * Compute the vertex normal vectors of a given face-set
 * 
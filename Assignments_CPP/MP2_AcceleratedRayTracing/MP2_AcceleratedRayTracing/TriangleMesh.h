@@ -7,6 +7,7 @@
 
 #include "Triangle.h"
 #include "Mat4.h"
+#include "ThreadPool.h"
 
 struct TriangleFace {
 	size_t v0_idx;
@@ -60,7 +61,9 @@ public:
 	
 	void setColors(const ColorRGB& ambient, const ColorRGB& diffuse, const ColorRGB& specular, const double& alpha);
 	void loadFromOBJFile(const std::string& path);
+	void loadFromBuffers(const double* vertexData, const double* normalData, size_t vertexCount, const uint32_t* faceData, size_t faceCount);
 	void addTransformation(const Mat4& transformationMatrix, const Transformation& transformationType);
+	void applyModelViewMatrix();
 
 	void computeNormals(const std::vector<std::shared_ptr<Point3D>>& vertices, const std::vector<std::shared_ptr<TriangleFace>>& faces, std::vector<std::shared_ptr<Vec3D>>& normals);
 	void generateTriangles(const std::vector<std::shared_ptr<Point3D>>& vertices, const std::vector<std::shared_ptr<TriangleFace>>& faces, const std::vector<std::shared_ptr<Vec3D>>& normals, std::vector<std::shared_ptr<Triangle>>& triangles);
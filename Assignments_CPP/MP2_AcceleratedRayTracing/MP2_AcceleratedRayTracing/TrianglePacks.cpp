@@ -0,0 +1,231 @@
+#include "TrianglePacks.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+* Packs the triangles referenced by primitiveIndices, one slot per reference. Nothing is packed unless every primitive is a Triangle.
+*
+* @param primitives The primitives of the BVH
+* @param primitiveIndices The primitive indices referenced by the BVH's leaves
+*
+* @return True if the triangles were packed, false if the packs were left empty
+*/
+bool TrianglePacks::build(const std::vector<std::shared_ptr<Object>>& primitives, const std::vector<uint32_t>& primitiveIndices)
+{
+    clear();
+    if (primitiveIndices.empty()) {
+        return false;
+    }
+    for (const std::shared_ptr<Object>& primitive : primitives) {
+        if (primitive->getObjectType() != ObjectType::Triangle) {
+            return false;
+        }
+    }
+
+    size_t n = primitiveIndices.size();
+    for (int a = 0; a < 3; a++) {
+        vertex0[a].assign(n + SIMD_MAX_LANES, 0.0);
+        edge1[a].resize(n);
+        edge2[a].resize(n);
+        laneEdge1[a].assign(n + SIMD_MAX_LANES, 0.0f);
+        laneEdge2[a].assign(n + SIMD_MAX_LANES, 0.0f);
+    }
+    laneEdgeNorm.assign(n + SIMD_MAX_LANES, 0.0f);
+
+    ThreadPool::global().parallelFor(0, n, TRIANGLE_PACKS_PARALLEL_CUTOFF, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            const Triangle& triangle = static_cast<const Triangle&>(*primitives[primitiveIndices[i]]);
+            for (int a = 0; a < 3; a++) {
+                vertex0[a][i] = triangle.vertex0()[a];
+                edge1[a][i] = triangle.vertex1()[a] - triangle.vertex0()[a];
+                edge2[a][i] = triangle.vertex2()[a] - triangle.vertex0()[a];
+                laneEdge1[a][i] = (float)edge1[a][i];
+                laneEdge2[a][i] = (float)edge2[a][i];
+                laneEdgeNorm[i] += std::fabs(laneEdge1[a][i]) + std::fabs(laneEdge2[a][i]);
+            }
+        }
+    });
+    return true;
+}
+
+/*
+* Empties the packs
+*/
+void TrianglePacks::clear()
+{
+    for (int a = 0; a < 3; a++) {
+        std::vector<double>().swap(vertex0[a]);
+        std::vector<double>().swap(edge1[a]);
+        std::vector<double>().swap(edge2[a]);
+        std::vector<float>().swap(laneEdge1[a]);
+        std::vector<float>().swap(laneEdge2[a]);
+    }
+    std::vector<float>().swap(laneEdgeNorm);
+}
+
+/*
+* @return True if no triangles are packed
+*/
+bool TrianglePacks::empty() const
+{
+    return edge1[0].empty();
+}
+
+/*
+* @return The number of packed slots
+*/
+size_t TrianglePacks::size() const
+{
+    return edge1[0].size();
+}
+
+/*
+* @return The bytes held by the packs
+*/
+size_t TrianglePacks::memoryBytes() const
+{
+    return 6 * size() * sizeof(double) + (empty() ? 0 : 3 * (size() + SIMD_MAX_LANES) * sizeof(double) + 7 * (size() + SIMD_MAX_LANES) * sizeof(float));
+}
+
+/*
+* @return The packs, as the SIMD kernels take them
+*/
+TriangleLanes TrianglePacks::lanes() const
+{
+    TriangleLanes view;
+    for (int a = 0; a < 3; a++) {
+        view.vertex0[a] = vertex0[a].data();
+        view.edge1[a] = laneEdge1[a].data();
+        view.edge2[a] = laneEdge2[a].data();
+    }
+    view.edgeNorm = laneEdgeNorm.data();
+    return view;
+}
+
+/*
+* Tests one slot with the same Moller-Trumbore test as Triangle::intersection
+*
+* @param i The slot
+* @param origin The origin of the ray
+* @param direction The direction of the ray
+* @param t_min The minimum intersection t.
+* @param closest The maximum intersection t, lowered to the hit if there is one. Modified by function.
+* @param packHit The slot and barycentric coordinates of the hit, if there is one. Modified by function.
+*
+* @return True if the triangle was hit in [t_min, closest]
+*/
+bool TrianglePacks::intersectSlot(uint32_t i, const Point3D& origin, const Vec3D& direction, double t_min, double& closest, TrianglePackHit& packHit) const
+{
+    double e1x = edge1[0][i], e1y = edge1[1][i], e1z = edge1[2][i];
+    double e2x = edge2[0][i], e2y = edge2[1][i], e2z = edge2[2][i];
+
+    double hx = direction[1] * e2z - direction[2] * e2y;
+    double hy = direction[2] * e2x - direction[0] * e2z;
+    double hz = direction[0] * e2y - direction[1] * e2x;
+    double a = e1x * hx + e1y * hy + e1z * hz;
+    if (a > -Arithmetic::EPSILON && a < Arithmetic::EPSILON) {
+        return false;
+    }
+    double f = 1.0 / a;
+    double sx = origin[0] - vertex0[0][i];
+    double sy = origin[1] - vertex0[1][i];
+    double sz = origin[2] - vertex0[2][i];
+    double u = f * (sx * hx + sy * hy + sz * hz);
+    if (u < 0.0 || u > 1.0) {
+        return false;
+    }
+    double qx = sy * e1z - sz * e1y;
+    double qy = sz * e1x - sx * e1z;
+    double qz = sx * e1y - sy * e1x;
+    double v = f * (direction[0] * qx + direction[1] * qy + direction[2] * qz);
+    if (v < 0.0 || u + v > 1.0) {
+        return false;
+    }
+    double t = f * (e2x * qx + e2y * qy + e2z * qz);
+    if (t > Arithmetic::EPSILON && t >= t_min && t <= closest) {
+        closest = t;
+        packHit.slot = i;
+        packHit.u = u;
+        packHit.v = v;
+        return true;
+    }
+    return false;
+}
+
+/*
+* Finds the closest triangle in slots [first, last) that a ray hits in [t_min, closest]. The SIMD kernel in use filters
+* the slots in float lanes, then the candidates it passes are tested exactly, in slot order, so the result is the same
+* as testing every slot with intersectSlot.
+*
+* @param first The first slot
+* @param last One past the last slot
+* @param origin The origin of the ray
+* @param direction The direction of the ray
+* @param t_min The minimum intersection t.
+* @param closest The maximum intersection t, lowered to every closer hit. Modified by function.
+* @param packHit The slot and barycentric coordinates of the closest hit. Modified by function.
+*
+* @return True if any triangle in the slots was hit
+*/
+bool TrianglePacks::intersect(uint32_t first, uint32_t last, const Point3D& origin, const Vec3D& direction, double t_min, double& closest, TrianglePackHit& packHit) const
+{
+    bool hit = false;
+    if (last - first < SIMD_MIN_SLOTS) {
+        for (uint32_t i = first; i < last; i++) {
+            hit |= intersectSlot(i, origin, direction, t_min, closest, packHit);
+        }
+        return hit;
+    }
+
+    const TriangleLanes view = lanes();
+    uint32_t candidates[SIMD_CANDIDATE_BATCH];
+    for (uint32_t batch = first; batch < last; batch += SIMD_CANDIDATE_BATCH) {
+        const SimdRay simdRay(origin, direction, t_min, closest);
+        uint32_t count = SimdKernels::triangleCandidates(view, batch, std::min(last, batch + SIMD_CANDIDATE_BATCH), simdRay, candidates);
+        for (uint32_t c = 0; c < count; c++) {
+            hit |= intersectSlot(candidates[c], origin, direction, t_min, closest, packHit);
+        }
+    }
+    return hit;
+}
+
+/*
+* Checks whether a ray hits any triangle in slots [first, last) within [t_min, t_max]
+*
+* @param first The first slot
+* @param last One past the last slot
+* @param origin The origin of the ray
+* @param direction The direction of the ray
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any triangle in the slots was hit
+*/
+bool TrianglePacks::occluded(uint32_t first, uint32_t last, const Point3D& origin, const Vec3D& direction, double t_min, double t_max) const
+{
+    double closest = t_max;
+    TrianglePackHit packHit;
+    if (last - first < SIMD_MIN_SLOTS) {
+        for (uint32_t i = first; i < last; i++) {
+            if (intersectSlot(i, origin, direction, t_min, closest, packHit)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const TriangleLanes view = lanes();
+    const SimdRay simdRay(origin, direction, t_min, t_max);
+    uint32_t candidates[SIMD_CANDIDATE_BATCH];
+    for (uint32_t batch = first; batch < last; batch += SIMD_CANDIDATE_BATCH) {
+        uint32_t count = SimdKernels::triangleCandidates(view, batch, std::min(last, batch + SIMD_CANDIDATE_BATCH), simdRay, candidates);
+        for (uint32_t c = 0; c < count; c++) {
+            if (intersectSlot(candidates[c], origin, direction, t_min, closest, packHit)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+#include "Triangle.h"
+#include "SimdKernels.h"
+
+constexpr size_t TRIANGLE_PACKS_PARALLEL_CUTOFF = 16384;    // fewer triangles are packed on the current thread
+
+// The closest packed triangle a ray hit, with the barycentric coordinates the test found it at
+struct TrianglePackHit {
+    uint32_t slot = 0;
+    double u = 0;       // weight of vertex1
+    double v = 0;       // weight of vertex2
+};
+
+// Structure-of-arrays copy of the triangles a BVH's leaves refer to, in leaf reference order, so every leaf is one
+// contiguous block. The first vertex and both edges are precomputed, so a leaf is intersected in a single tight loop
+// with no virtual call or pointer chase per triangle. A float copy of the edges lets the SIMD kernels filter a whole
+// leaf at once; only the slots they pass go through the exact double test.
+struct TrianglePacks {
+    std::vector<double> vertex0[3];         // padded with SIMD_MAX_LANES empty slots, the kernels read it directly
+    std::vector<double> edge1[3];
+    std::vector<double> edge2[3];
+    std::vector<float> laneEdge1[3];        // padded with SIMD_MAX_LANES empty slots
+    std::vector<float> laneEdge2[3];
+    std::vector<float> laneEdgeNorm;
+
+    bool build(const std::vector<std::shared_ptr<Object>>& primitives, const std::vector<uint32_t>& primitiveIndices);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    size_t memoryBytes() const;
+    TriangleLanes lanes() const;
+
+    bool intersectSlot(uint32_t i, const Point3D& origin, const Vec3D& direction, double t_min, double& closest, TrianglePackHit& packHit) const;
+
+    bool intersect(uint32_t first, uint32_t last, const Point3D& origin, const Vec3D& direction, double t_min, double& closest, TrianglePackHit& packHit) const;
+    bool occluded(uint32_t first, uint32_t last, const Point3D& origin, const Vec3D& direction, double t_min, double t_max) const;
+};
@@ -0,0 +1,425 @@
+#include "WideBVH.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define WIDE_BVH_SSE
+#endif
+
+/*
+* Default constructor for WideBVH (empty tree)
+*/
+template <size_t Width>
+WideBVH<Width>::WideBVH() : Object(ObjectType::WideBVH) {}
+
+/*
+* Constructor for WideBVH
+*
+* @param binaryBVH The binary BVH to collapse
+*/
+template <size_t Width>
+WideBVH<Width>::WideBVH(const LinearBVH& binaryBVH) : Object(ObjectType::WideBVH), primitiveIndices(binaryBVH.getPrimitiveIndices()), primitives(binaryBVH.getPrimitives())
+{
+    const std::vector<LinearBVHNode>& binaryNodes = binaryBVH.getNodes();
+    if (binaryNodes.empty()) {
+        return;
+    }
+
+    // A binary leaf at the root still needs a node to hang off
+    if (binaryNodes[0].primitiveCount > 0) {
+        nodes.push_back(WideBVHNode<Width>());
+        nodes[0].childCount = 1;
+        setChild(0, 0, binaryNodes, 0);
+        for (size_t lane = 1; lane < Width; lane++) {
+            setChild(0, lane, binaryNodes, UINT32_MAX);
+        }
+        return;
+    }
+
+    // A wide tree over n leaves has fewer than n / (Width - 1) + 1 nodes; reserve assuming every binary node is a leaf
+    nodes.reserve(binaryNodes.size() / (Width - 1) + 1);
+    collapse(binaryNodes, 0);
+    nodes.shrink_to_fit();
+}
+
+/*
+* Creates the wide node for an interior binary node, and recursively for every interior node below it
+*
+* @param binaryNodes The nodes of the binary BVH
+* @param binaryIndex The interior binary node to collapse
+*
+* @return The index of the new wide node
+*/
+template <size_t Width>
+uint32_t WideBVH<Width>::collapse(const std::vector<LinearBVHNode>& binaryNodes, uint32_t binaryIndex)
+{
+    auto area = [&](uint32_t i) -> double {
+        const LinearBVHNode& n = binaryNodes[i];
+        double dx = n.boundsMax[0] - n.boundsMin[0];
+        double dy = n.boundsMax[1] - n.boundsMin[1];
+        double dz = n.boundsMax[2] - n.boundsMin[2];
+        return dx * dy + dy * dz + dz * dx;
+    };
+
+    // Open the interior child with the largest surface area until the node is full
+    uint32_t children[Width];
+    size_t childCount = 2;
+    children[0] = binaryIndex + 1;
+    children[1] = binaryNodes[binaryIndex].offset;
+    while (childCount < Width) {
+        int largest = -1;
+        for (size_t c = 0; c < childCount; c++) {
+            if (binaryNodes[children[c]].primitiveCount == 0 && (largest < 0 || area(children[c]) > area(children[largest]))) {
+                largest = (int)c;
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        uint32_t opened = children[largest];
+        children[largest] = opened + 1;
+        children[childCount++] = binaryNodes[opened].offset;
+    }
+
+    uint32_t nodeIndex = (uint32_t)nodes.size();
+    nodes.push_back(WideBVHNode<Width>());
+    nodes[nodeIndex].childCount = (uint8_t)childCount;
+    for (size_t lane = 0; lane < Width; lane++) {
+        setChild(nodeIndex, lane, binaryNodes, lane < childCount ? children[lane] : UINT32_MAX);
+    }
+    return nodeIndex;
+}
+
+/*
+* Fills one lane of a wide node from a binary node, collapsing it first if it is interior
+*
+* @param nodeIndex The wide node
+* @param lane The lane to fill
+* @param binaryNodes The nodes of the binary BVH
+* @param binaryIndex The binary node to store in the lane, or UINT32_MAX for an empty lane
+*/
+template <size_t Width>
+void WideBVH<Width>::setChild(uint32_t nodeIndex, size_t lane, const std::vector<LinearBVHNode>& binaryNodes, uint32_t binaryIndex)
+{
+    if (binaryIndex == UINT32_MAX) {
+        for (int a = 0; a < 3; a++) {
+            nodes[nodeIndex].boundsMin[a][lane] = std::numeric_limits<float>::infinity();
+            nodes[nodeIndex].boundsMax[a][lane] = -std::numeric_limits<float>::infinity();
+        }
+        nodes[nodeIndex].children[lane] = 0;
+        nodes[nodeIndex].primitiveCounts[lane] = 0;
+        return;
+    }
+
+    const LinearBVHNode& binaryNode = binaryNodes[binaryIndex];
+    uint32_t child = binaryNode.primitiveCount > 0 ? binaryNode.offset : collapse(binaryNodes, binaryIndex);
+
+    // collapse may have grown the node array, so only index into it afterwards
+    WideBVHNode<Width>& node = nodes[nodeIndex];
+    for (int a = 0; a < 3; a++) {
+        node.boundsMin[a][lane] = binaryNode.boundsMin[a];
+        node.boundsMax[a][lane] = binaryNode.boundsMax[a];
+    }
+    node.children[lane] = child;
+    node.primitiveCounts[lane] = binaryNode.primitiveCount;
+}
+
+/*
+* Slab test of a ray against every child box of a node at once
+*
+* @param node The node
+* @param origin The origin of the ray
+* @param invDir The reciprocal of the ray's direction
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param t_entry The t at which the ray enters each child box (only meaningful for hit lanes). Modified by function.
+*
+* @return A bit mask with bit i set if the ray enters child i within [t_min, t_max]
+*/
+template <size_t Width>
+unsigned WideBVH<Width>::hitChildren(const WideBVHNode<Width>& node, const float(&origin)[3], const float(&invDir)[3], float t_min, float t_max, float(&t_entry)[Width]) const
+{
+    unsigned mask = 0;
+
+#if defined(WIDE_BVH_SSE) && defined(__AVX__)
+    if (Width == 8) {
+        __m256 tNear = _mm256_set1_ps(t_min);
+        __m256 tFar = _mm256_set1_ps(t_max);
+        for (int a = 0; a < 3; a++) {
+            __m256 o = _mm256_set1_ps(origin[a]);
+            __m256 inv = _mm256_set1_ps(invDir[a]);
+            __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMin[a]), o), inv);
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMax[a]), o), inv);
+            tNear = _mm256_max_ps(tNear, _mm256_min_ps(t0, t1));
+            tFar = _mm256_min_ps(tFar, _mm256_mul_ps(_mm256_max_ps(t0, t1), _mm256_set1_ps(WIDE_BVH_SLAB_PADDING)));
+        }
+        _mm256_storeu_ps(t_entry, tNear);
+        mask = (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+        return mask & ((1u << node.childCount) - 1);
+    }
+#endif
+
+#if defined(WIDE_BVH_SSE)
+    // Four lanes at a time: one pass for BVH4, two for BVH8 without AVX
+    for (size_t base = 0; base < Width; base += 4) {
+        __m128 tNear = _mm_set1_ps(t_min);
+        __m128 tFar = _mm_set1_ps(t_max);
+        for (int a = 0; a < 3; a++) {
+            __m128 o = _mm_set1_ps(origin[a]);
+            __m128 inv = _mm_set1_ps(invDir[a]);
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.boundsMin[a][base]), o), inv);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.boundsMax[a][base]), o), inv);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_max_ps(t0, t1), _mm_set1_ps(WIDE_BVH_SLAB_PADDING)));
+        }
+        _mm_storeu_ps(&t_entry[base], tNear);
+        mask |= (unsigned)_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) << base;
+    }
+#else
+    for (size_t lane = 0; lane < Width; lane++) {
+        float tNear = t_min;
+        float tFar = t_max;
+        for (int a = 0; a < 3; a++) {
+            float t0 = (node.boundsMin[a][lane] - origin[a]) * invDir[a];
+            float t1 = (node.boundsMax[a][lane] - origin[a]) * invDir[a];
+            tNear = std::max(tNear, std::min(t0, t1));
+            tFar = std::min(tFar, std::max(t0, t1) * WIDE_BVH_SLAB_PADDING);
+        }
+        t_entry[lane] = tNear;
+        if (tNear <= tFar) {
+            mask |= 1u << lane;
+        }
+    }
+#endif
+
+    return mask & ((1u << node.childCount) - 1);
+}
+
+/*
+* @return The wide nodes, in depth-first order
+*/
+template <size_t Width>
+const std::vector<WideBVHNode<Width>>& WideBVH<Width>::getNodes() const
+{
+    return nodes;
+}
+
+/*
+* Retrieve the bounding box of the whole BVH
+*
+* @param output_box The variable to hold the bounding box. Modified by function.
+*
+* @return False if the BVH is empty, true otherwise
+*/
+template <size_t Width>
+bool WideBVH<Width>::generateBoundingBox(AABB3D& output_box) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+    output_box = EMPTY_BOUNDING_BOX;
+    const WideBVHNode<Width>& root = nodes[0];
+    for (size_t lane = 0; lane < root.childCount; lane++) {
+        output_box.expand(AABB3D(Point3D(root.boundsMin[0][lane], root.boundsMin[1][lane], root.boundsMin[2][lane]),
+            Point3D(root.boundsMax[0][lane], root.boundsMax[1][lane], root.boundsMax[2][lane])));
+    }
+    return true;
+}
+
+/*
+* Find the closest primitive a ray intersects, testing all children of a node with one SIMD slab test.
+* Hit children are visited in order of entry distance; interior children are pushed far-to-near with their entry
+* distance so they can be dropped without being fetched once a closer hit has been found.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return 1 if any primitive was hit, 0 otherwise
+*/
+template <size_t Width>
+int WideBVH<Width>::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+    if (nodes.empty()) {
+        return 0;
+    }
+
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    float origin[3];
+    float invDir[3];
+    for (int a = 0; a < 3; a++) {
+        origin[a] = (float)start[a];
+        invDir[a] = (float)(1.0 / direction[a]);
+    }
+
+    struct StackEntry {
+        uint32_t node;
+        float t_entry;
+    };
+    StackEntry stack[WIDE_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = { 0, (float)t_min };
+    double closest = t_max;
+
+    // Spatial splits put a primitive in several leaves; a small mailbox skips the ones this ray already tested
+    const bool dedupe = primitiveIndices.size() > primitives.size();
+    uint32_t mailbox[LINEAR_BVH_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + LINEAR_BVH_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+    bool hit = false;
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.t_entry > closest) {
+            continue;
+        }
+
+        const WideBVHNode<Width>& node = nodes[entry.node];
+        float t_entry[Width];
+        unsigned mask = hitChildren(node, origin, invDir, (float)t_min, std::nextafter((float)closest, std::numeric_limits<float>::infinity()), t_entry);
+
+        // Insertion sort the hit lanes by entry distance, nearest first
+        size_t order[Width];
+        size_t hitCount = 0;
+        for (size_t lane = 0; mask != 0; lane++, mask >>= 1) {
+            if (!(mask & 1)) {
+                continue;
+            }
+            size_t i = hitCount++;
+            while (i > 0 && t_entry[order[i - 1]] > t_entry[lane]) {
+                order[i] = order[i - 1];
+                i--;
+            }
+            order[i] = lane;
+        }
+
+        // Leaves are intersected right away, nearest first, which may already shrink closest for the interior children
+        for (size_t i = 0; i < hitCount; i++) {
+            size_t lane = order[i];
+            if (node.primitiveCounts[lane] == 0 || t_entry[lane] > closest) {
+                continue;
+            }
+            for (uint32_t p = node.children[lane]; p < node.children[lane] + node.primitiveCounts[lane]; p++) {
+                const uint32_t primitive = primitiveIndices[p];
+                if (dedupe) {
+                    if (mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] == primitive) {
+                        continue;
+                    }
+                    mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] = primitive;
+                }
+                if (primitives[primitive]->intersection(ray, t_min, closest, hitRecord)) {
+                    hit = true;
+                    closest = hitRecord.intT;
+                }
+            }
+        }
+        for (size_t i = hitCount; i > 0; i--) {
+            size_t lane = order[i - 1];
+            if (node.primitiveCounts[lane] == 0 && t_entry[lane] <= closest) {
+                stack[stackSize++] = { node.children[lane], t_entry[lane] };
+            }
+        }
+    }
+
+    return hit ? 1 : 0;
+}
+
+/*
+* Checks whether any primitive blocks a ray within [t_min, t_max]. Stops at the first hit found, in no particular order.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return True if any primitive is hit, false otherwise
+*/
+template <size_t Width>
+bool WideBVH<Width>::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3D& start = ray.getStart();
+    const Vec3D& direction = ray.getDirection();
+    float origin[3];
+    float invDir[3];
+    for (int a = 0; a < 3; a++) {
+        origin[a] = (float)start[a];
+        invDir[a] = (float)(1.0 / direction[a]);
+    }
+    const float t_maxPadded = std::nextafter((float)t_max, std::numeric_limits<float>::infinity());
+
+    uint32_t stack[WIDE_BVH_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    const bool dedupe = primitiveIndices.size() > primitives.size();
+    uint32_t mailbox[LINEAR_BVH_MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + LINEAR_BVH_MAILBOX_SIZE, std::numeric_limits<uint32_t>::max());
+
+    while (stackSize > 0) {
+        const WideBVHNode<Width>& node = nodes[stack[--stackSize]];
+        float t_entry[Width];
+        unsigned mask = hitChildren(node, origin, invDir, (float)t_min, t_maxPadded, t_entry);
+        for (size_t lane = 0; mask != 0; lane++, mask >>= 1) {
+            if (!(mask & 1)) {
+                continue;
+            }
+            if (node.primitiveCounts[lane] == 0) {
+                stack[stackSize++] = node.children[lane];
+                continue;
+            }
+            for (uint32_t p = node.children[lane]; p < node.children[lane] + node.primitiveCounts[lane]; p++) {
+                const uint32_t primitive = primitiveIndices[p];
+                if (dedupe) {
+                    if (mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] == primitive) {
+                        continue;
+                    }
+                    mailbox[primitive % LINEAR_BVH_MAILBOX_SIZE] = primitive;
+                }
+                if (primitives[primitive]->occluded(ray, t_min, t_max)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// NOTE: THESE FUNCTIONS DON'T HAVE ANY USE! THEY'RE SIMPLY TO COMPLY WITH THE PURE VIRTUAL OVERRIDE REQUIREMENTS OF THE PARENT CLASS, OBJECT!
+
+template <size_t Width>
+const ColorRGB& WideBVH<Width>::getAmbient() const
+{
+    return WHITE_COLOR;
+}
+
+template <size_t Width>
+const ColorRGB& WideBVH<Width>::getDiffuse() const
+{
+    return WHITE_COLOR;
+}
+
+template <size_t Width>
+const ColorRGB& WideBVH<Width>::getSpecular() const
+{
+    return WHITE_COLOR;
+}
+
+template <size_t Width>
+const double& WideBVH<Width>::getAlpha() const
+{
+    static const double alpha = 0;
+    return alpha;
+}
+
+template <size_t Width>
+Vec3D WideBVH<Width>::normal(const Point3D& intersection) const
+{
+    return Vec3D(0, 0, 1);
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+
+#include "Object.h"
+#include "LinearBVH.h"
+
+constexpr size_t WIDE_BVH_STACK_SIZE = 1024;    // a node pushes at most Width - 1 more entries than it pops, over at most LINEAR_BVH_STACK_SIZE levels
+constexpr float WIDE_BVH_SLAB_PADDING = 1.0f + 4.0f * FLT_EPSILON;    // far slab distances are scaled up by this much so float rounding never culls a box the ray grazes
+
+// Node of a 4- or 8-wide BVH. Child bounds are stored structure-of-arrays, one float lane per child, so a ray can be
+// tested against all children of a node in a single SIMD slab test.
+template <size_t Width>
+struct WideBVHNode {
+    float boundsMin[3][Width];
+    float boundsMax[3][Width];
+    uint32_t children[Width];           // interior child: index of its node, leaf child: index of its first primitive index
+    uint16_t primitiveCounts[Width];    // 0 for interior children
+    uint8_t childCount;
+};
+
+// A BVH with Width children per node, collapsed from a binary LinearBVH by repeatedly opening the child with the
+// largest surface area. Shares the binary BVH's primitive order, so leaves are unchanged.
+template <size_t Width>
+class WideBVH :
+    public Object
+{
+private:
+    std::vector<WideBVHNode<Width>> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<std::shared_ptr<Object>> primitives;
+
+    uint32_t collapse(const std::vector<LinearBVHNode>& binaryNodes, uint32_t binaryIndex);
+    void setChild(uint32_t nodeIndex, size_t lane, const std::vector<LinearBVHNode>& binaryNodes, uint32_t binaryIndex);
+    unsigned hitChildren(const WideBVHNode<Width>& node, const float(&origin)[3], const float(&invDir)[3], float t_min, float t_max, float(&t_entry)[Width]) const;
+
+public:
+    WideBVH();
+    WideBVH(const LinearBVH& binaryBVH);
+
+    const std::vector<WideBVHNode<Width>>& getNodes() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+
+    // JUST TO COMPLY
+    const ColorRGB& getAmbient() const;
+    const ColorRGB& getDiffuse() const;
+    const ColorRGB& getSpecular() const;
+    const double& getAlpha() const;
+
+    Vec3D normal(const Point3D& intersection) const;
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
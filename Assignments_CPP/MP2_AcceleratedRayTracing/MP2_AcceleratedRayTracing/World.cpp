@@ -1,10 +1,12 @@
 #include "World.h"
 #include "BVHNode.h"
 
+#include <numeric>
+
 /*
 * Default constructor for World
 */
-World::World() {}
+World::World() : sceneObjectsPacked(false), rayPacketSize(DEFAULT_RAY_PACKET_SIZE), bvhConstructionSeconds(0), rayTracingSeconds(0), rayTracingAllocations(0) {}
 
 /*
 * Default destructor for World
@@ -35,6 +37,13 @@ const std::shared_ptr<TriangleMesh>& World::getTriangleMesh() const
 	return triangleMesh;
 }
 
+/*
+* @return A reference to the vector of all MeshInstance in the World
+*/
+const std::vector<std::shared_ptr<MeshInstance>>& World::getMeshInstances() const
+{
+	return meshInstances;
+}
 
 /*
 * @return A reference to the vector of all RenderOption in the World
@@ -45,12 +54,51 @@ const std::vector<RenderOption>& World::getRenderOptions() const
 }
 
 /*
-* @param sceneObject The SceneObject to add to the world
+* @param sceneObject The SceneObject to add to the world. With DYNAMIC_BVH it is also inserted into the BVH left over from the last render.
 */
 void World::addSceneObject(std::shared_ptr<SceneObject> sceneObject)
 {
 
 	sceneObjects.push_back(sceneObject);
+	sceneObjectsPacked = false;
+	root.reset();
+	if (dynamicBVH && (OPT_BVH() || !meshInstances.empty())) {
+		dynamicBVH->insert(sceneObject);
+	}
+}
+
+/*
+* @param sceneObject The SceneObject to remove from the world. With DYNAMIC_BVH it is also removed from the BVH left over from the last render.
+*
+* @return True if the SceneObject was in the world, false otherwise
+*/
+bool World::removeSceneObject(const std::shared_ptr<SceneObject>& sceneObject)
+{
+	auto found = std::find(sceneObjects.begin(), sceneObjects.end(), sceneObject);
+	if (found == sceneObjects.end()) {
+		return false;
+	}
+	sceneObjects.erase(found);
+	sceneObjectsPacked = false;
+	root.reset();
+	if (dynamicBVH) {
+		dynamicBVH->remove(*sceneObject);
+	}
+	return true;
+}
+
+/*
+* Tells the world a SceneObject has moved or changed shape (e.g. with Sphere::setCenter). With DYNAMIC_BVH its leaf
+* is moved in the BVH left over from the last render; otherwise the next render rebuilds the BVH (or the packs) anyway.
+*
+* @param sceneObject The SceneObject that changed
+*/
+void World::updateSceneObject(const std::shared_ptr<SceneObject>& sceneObject)
+{
+	sceneObjectsPacked = false;
+	if (dynamicBVH) {
+		dynamicBVH->update(*sceneObject);
+	}
 }
 
 /*
@@ -67,6 +115,33 @@ void World::addLightSource(std::shared_ptr<LightSource> lightSource)
 void World::setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh)
 {
 	this->triangleMesh = triangleMesh;
+	this->triangleMeshBVH = nullptr;
+	root.reset();
+	dynamicBVH.reset();
+}
+
+/*
+* @param triangleMesh The TriangleMesh to add to the world
+* @param triangleMeshBVH A BVH already built over the mesh's triangles (e.g. loaded from a BVHCache), used instead of building one in render()
+*/
+void World::setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh, const std::shared_ptr<LinearBVH>& triangleMeshBVH)
+{
+	this->triangleMesh = triangleMesh;
+	this->triangleMeshBVH = triangleMeshBVH;
+	root.reset();
+	dynamicBVH.reset();
+}
+
+/*
+* @param meshInstance The MeshInstance to add to the world. Instances are always traced through a two-level BVH.
+*/
+void World::addMeshInstance(const std::shared_ptr<MeshInstance>& meshInstance)
+{
+	meshInstances.push_back(meshInstance);
+	root.reset();
+	if (dynamicBVH) {
+		dynamicBVH->insert(meshInstance);
+	}
 }
 
 /*
@@ -75,6 +150,8 @@ void World::setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh)
 void World::addRenderOption(const RenderOption& renderOption)
 {
 	renderOptions.push_back(renderOption);
+	root.reset();
+	dynamicBVH.reset();
 }
 
 /*
@@ -103,6 +180,32 @@ void World::setAmbientLight(const ColorRGB& ambientColor)
 	this->ambientLight = ambientColor;
 }
 
+/*
+* @param bvhBuildParameters The bin count and SAH costs used when building the BVH
+*/
+void World::setBVHBuildParameters(const BVHBuildParameters& bvhBuildParameters)
+{
+	this->bvhBuildParameters = bvhBuildParameters;
+	root.reset();
+	dynamicBVH.reset();
+}
+
+/*
+* @param bvhStatisticsFilepath The file the BVH statistics JSON is written to after each build. Empty prints it to the console instead.
+*/
+void World::setBVHStatisticsFilepath(const std::string& bvhStatisticsFilepath)
+{
+	this->bvhStatisticsFilepath = bvhStatisticsFilepath;
+}
+
+/*
+* @param rayPacketSize The side of the pixel blocks traced as one packet with RAY_PACKETS. Rounded down to 2, 4 or 8.
+*/
+void World::setRayPacketSize(int rayPacketSize)
+{
+	this->rayPacketSize = rayPacketSize >= 8 ? 8 : (rayPacketSize >= 4 ? 4 : 2);
+}
+
 /*
 * @return bool Checks whether the user selected AntiAliasing as a RenderOption
 */
@@ -127,6 +230,110 @@ bool World::OPT_TRIANGLE_MESH() const
 	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::TRIANGLE_MESH) != renderOptions.end();
 }
 
+/*
+* @return bool Checks whether the user selected LBVH as a RenderOption
+*/
+bool World::OPT_LBVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::LBVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected BVH4 as a RenderOption
+*/
+bool World::OPT_BVH4() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::BVH4) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected BVH8 as a RenderOption
+*/
+bool World::OPT_BVH8() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::BVH8) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected REFIT_BVH as a RenderOption
+*/
+bool World::OPT_REFIT_BVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::REFIT_BVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected SBVH as a RenderOption
+*/
+bool World::OPT_SBVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::SBVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected OPTIMIZE_BVH as a RenderOption
+*/
+bool World::OPT_OPTIMIZE_BVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::OPTIMIZE_BVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected COMPRESSED_BVH as a RenderOption
+*/
+bool World::OPT_COMPRESSED_BVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::COMPRESSED_BVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected KD_TREE as a RenderOption
+*/
+bool World::OPT_KD_TREE() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::KD_TREE) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected GRID as a RenderOption
+*/
+bool World::OPT_GRID() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::GRID) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected TWO_LEVEL_GRID as a RenderOption
+*/
+bool World::OPT_TWO_LEVEL_GRID() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::TWO_LEVEL_GRID) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected DYNAMIC_BVH as a RenderOption
+*/
+bool World::OPT_DYNAMIC_BVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::DYNAMIC_BVH) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected RAY_PACKETS as a RenderOption
+*/
+bool World::OPT_RAY_PACKETS() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::RAY_PACKETS) != renderOptions.end();
+}
+
+/*
+* @return bool Checks whether the user selected BVH_SAH as a RenderOption
+*/
+bool World::OPT_BVH_SAH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::BVH_SAH) != renderOptions.end();
+}
+
 /*
 * @return The background Image of the World
 */
@@ -159,6 +366,71 @@ const ColorRGB& World::getAmbientLight()
 	return ambientLight;
 }
 
+/*
+* @return The parameters used when building the BVH
+*/
+const BVHBuildParameters& World::getBVHBuildParameters() const
+{
+	return bvhBuildParameters;
+}
+
+/*
+* @return The wall-clock seconds spent building the BVH in the last render
+*/
+double World::getBVHConstructionSeconds() const
+{
+	return bvhConstructionSeconds;
+}
+
+/*
+* @return The wall-clock seconds spent tracing rays in the last render
+*/
+double World::getRayTracingSeconds() const
+{
+	return rayTracingSeconds;
+}
+
+/*
+* @return The heap allocations made while tracing rays in the last render. Always 0 unless COUNT_HEAP_ALLOCATIONS is defined.
+*/
+uint64_t World::getRayTracingAllocations() const
+{
+	return rayTracingAllocations;
+}
+
+/*
+* @return The statistics of the BVH built by the last render
+*/
+const BVHStatistics& World::getBVHStatistics() const
+{
+	return bvhStatistics;
+}
+
+/*
+* @return The side of the pixel blocks traced as one packet with RAY_PACKETS
+*/
+int World::getRayPacketSize() const
+{
+	return rayPacketSize;
+}
+
+/*
+* @return Whether rays are traced through a BVH rather than against every SceneObject
+*/
+bool World::usesBVH() const
+{
+	return OPT_TRIANGLE_MESH() || OPT_BVH() || !meshInstances.empty();
+}
+
+/*
+* @return Whether the BVH is a top-level tree over MeshInstances and SceneObjects, which is needed as soon as
+* the scene holds instances or both the TriangleMesh and the SceneObjects are traced
+*/
+bool World::usesTwoLevelBVH() const
+{
+	return !meshInstances.empty() || (OPT_TRIANGLE_MESH() && OPT_BVH());
+}
+
 /*
 * Generates a bounding box which surrounds two given bounding boxes
 *
@@ -201,7 +473,7 @@ bool World::surroundingBox(const std::vector<std::shared_ptr<Object>>& objects,
 
 	for (const auto& objectPtr : objects) {
 		Object* currObject = objectPtr.get();
-		if (currObject->generateBoundingBox(temp_box)) continue;
+		if (!currObject->generateBoundingBox(temp_box)) continue;
 		bb = first_box ? temp_box : surroundingBox(bb, temp_box);
 		first_box = false;
 		count++;
@@ -215,6 +487,169 @@ bool World::surroundingBox(const std::vector<std::shared_ptr<Object>>& objects,
 	return true;
 }
 
+/*
+* Splits the SceneObjects into those a BVH can hold and those without a bounding box, which are kept in unboundedObjects
+*
+* @return The SceneObjects with a bounding box
+*/
+std::vector<std::shared_ptr<SceneObject>> World::partitionBoundedObjects()
+{
+	std::vector<std::shared_ptr<SceneObject>> boundedObjects;
+	unboundedObjects.clear();
+	for (const std::shared_ptr<SceneObject>& sceneObject : sceneObjects) {
+		AABB3D box;
+		if (sceneObject->generateBoundingBox(box)) {
+			boundedObjects.push_back(sceneObject);
+		}
+		else {
+			unboundedObjects.push_back(sceneObject);
+		}
+	}
+	return boundedObjects;
+}
+
+/*
+* Finds the closest unbounded SceneObject a ray hits. Run before the BVH traversal, so a hit lowers t_max
+* and lets the traversal skip every node behind it.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t, lowered to the closest hit. Modified by function.
+* @param hitRecord HitRecord struct holding intersection information (if any). Modified by function.
+*
+* @return Whether any unbounded SceneObject was hit
+*/
+bool World::intersectUnbounded(const Ray3D& ray, const double& t_min, double& t_max, HitRecord& hitRecord) const
+{
+	bool intersected = false;
+	for (const std::shared_ptr<SceneObject>& unboundedObject : unboundedObjects) {
+		if (unboundedObject->intersection(ray, t_min, t_max, hitRecord)) {
+			t_max = hitRecord.intT;
+			intersected = true;
+		}
+	}
+	return intersected;
+}
+
+/*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return Whether any unbounded SceneObject blocks the ray within [t_min, t_max]
+*/
+bool World::occludedUnbounded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	for (const std::shared_ptr<SceneObject>& unboundedObject : unboundedObjects) {
+		if (unboundedObject->occluded(ray, t_min, t_max)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+* Splits the sceneObjects into SpherePacks and TrianglePacks for the SIMD kernels, for rendering without a BVH.
+* Everything else (Planes) is kept in unpackedObjects and tested one by one.
+*/
+void World::packSceneObjects()
+{
+	std::vector<std::shared_ptr<Object>> spheres;
+	packedTriangles.clear();
+	unpackedObjects.clear();
+	for (const std::shared_ptr<SceneObject>& sceneObject : sceneObjects) {
+		if (sceneObject->getObjectType() == ObjectType::Sphere) {
+			spheres.push_back(sceneObject);
+		}
+		else if (sceneObject->getObjectType() == ObjectType::Triangle) {
+			packedTriangles.push_back(sceneObject);
+		}
+		else {
+			unpackedObjects.push_back(sceneObject);
+		}
+	}
+
+	std::vector<uint32_t> sphereIndices(spheres.size());
+	std::iota(sphereIndices.begin(), sphereIndices.end(), 0);
+	spherePacks.build(spheres, sphereIndices);
+	std::vector<uint32_t> triangleIndices(packedTriangles.size());
+	std::iota(triangleIndices.begin(), triangleIndices.end(), 0);
+	trianglePacks.build(packedTriangles, triangleIndices);
+	sceneObjectsPacked = true;
+}
+
+/*
+* Finds the closest SceneObject a ray hits, without a BVH. Once render() has packed them, the spheres and triangles
+* are tested through the SIMD kernels.
+*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+* @param hitRecord HitRecord struct holding intersection information (if any). Modified by function.
+*
+* @return Whether any SceneObject was hit
+*/
+bool World::intersectSceneObjects(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+	double closest = t_max;
+	bool intersected = false;
+	if (!sceneObjectsPacked) {
+		for (const std::shared_ptr<SceneObject>& sceneObject : sceneObjects) {
+			if (sceneObject->intersection(ray, t_min, closest, hitRecord)) {
+				closest = hitRecord.intT;
+				intersected = true;
+			}
+		}
+		return intersected;
+	}
+
+	if (spherePacks.intersect(0, (uint32_t)spherePacks.size(), ray, t_min, closest, hitRecord)) {
+		intersected = true;
+	}
+	TrianglePackHit packHit;
+	if (trianglePacks.intersect(0, (uint32_t)trianglePacks.size(), ray.getStart(), ray.getDirection(), t_min, closest, packHit)) {
+		static_cast<const Triangle&>(*packedTriangles[packHit.slot]).makeHitRecord(ray, closest, packHit.u, packHit.v, hitRecord);
+		intersected = true;
+	}
+	for (const std::shared_ptr<SceneObject>& unpackedObject : unpackedObjects) {
+		if (unpackedObject->intersection(ray, t_min, closest, hitRecord)) {
+			closest = hitRecord.intT;
+			intersected = true;
+		}
+	}
+	return intersected;
+}
+
+/*
+* @param ray The Ray3D.
+* @param t_min The minimum intersection t.
+* @param t_max The maximum intersection t.
+*
+* @return Whether any SceneObject blocks the ray within [t_min, t_max], found without a BVH
+*/
+bool World::occludedSceneObjects(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	if (!sceneObjectsPacked) {
+		for (const std::shared_ptr<SceneObject>& sceneObject : sceneObjects) {
+			if (sceneObject->occluded(ray, t_min, t_max)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	if (spherePacks.occluded(0, (uint32_t)spherePacks.size(), ray, t_min, t_max)
+		|| trianglePacks.occluded(0, (uint32_t)trianglePacks.size(), ray.getStart(), ray.getDirection(), t_min, t_max)) {
+		return true;
+	}
+	for (const std::shared_ptr<SceneObject>& unpackedObject : unpackedObjects) {
+		if (unpackedObject->occluded(ray, t_min, t_max)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /*
 * Shoots a ray from the origin through the view plane, then determines which objects it hits.
 * In a more advanced implementation, this ray will "reflect off" and "pass through" surfaces, meaning there will be multiple intersection points.
@@ -238,30 +673,47 @@ bool World::shootPrimaryRay(const int& currentRow, const int& currentColumn, con
 	// First Ray: From Camera out into the world ...
 	firstRay = Ray3D{ firstRayStart, firstRayDirection };
 
-	// finds the index of the SceneObject in the iterable closest to the start of the ray
-	double minT = 0;
-	double minDist = 0;
-	bool intersected = false;
-
-	if (OPT_TRIANGLE_MESH() || OPT_BVH()) {
-		return root.intersection(firstRay, 0, MAX_T, hitRecord);
+	if (usesBVH()) {
+		double t_max = MAX_T;
+		bool unboundedHit = intersectUnbounded(firstRay, 0, t_max, hitRecord);
+		return accelerator->intersection(firstRay, 0, t_max, hitRecord) || unboundedHit;
 	}
 
 	// Otherwise, just do the usual ...
-	for (int i = 0; i < sceneObjects.size(); i++) {
-		HitRecord currHitRecord;
-		const std::shared_ptr<SceneObject>& currSceneObject = sceneObjects[i];
-		bool currIntersected = currSceneObject->intersection(firstRay, 0, MAX_T, currHitRecord);
-		if (currIntersected) {
-			if (!intersected || currHitRecord.intT < minT) {
-				hitRecord = currHitRecord;
-				minT = currHitRecord.intT;
-			}
-			intersected = true;
-		}
+	return intersectSceneObjects(firstRay, 0, MAX_T, hitRecord);
+}
+
+/*
+* Shoots the primary rays of a block of pixels as one packet. Only used with RAY_PACKETS, when the BVH is traced directly.
+*
+* @param rowStart The first row of the block.
+* @param colStart The first column of the block.
+* @param blockCols The number of columns in the block. The packet holds the block's pixels row by row.
+* @param offsets The offset of every pixel's ray destination, in packet order.
+* @param packet The RayPacket, filled with the rays and each one's hit flag. Modified by function.
+* @param hitRecords One HitRecord struct per ray, holding intersection information (if any). Modified by function.
+*/
+void World::shootPrimaryPacket(const int& rowStart, const int& colStart, const int& blockCols, const std::pair<double, double>* offsets, RayPacket& packet, HitRecord* hitRecords)
+{
+	// Unbounded objects are tested ray by ray first, so their hits lower each ray's tMax before the traversal
+	bool unboundedHits[RAY_PACKET_MAX_RAYS];
+	for (size_t r = 0; r < packet.size; r++) {
+		Point3D rayStart;
+		Vec3D rayDirection;
+		camera.getRay(rowStart + (int)r / blockCols, colStart + (int)r % blockCols, offsets[r].first, offsets[r].second, rayStart, rayDirection);
+		// Built with the normalizing constructor, so t_max and the hits are measured along the same unit ray as shootRay's
+		packet.rays[r] = Ray3D{ rayStart, rayDirection };
+		double t_max = MAX_T;
+		unboundedHits[r] = intersectUnbounded(packet.rays[r], 0, t_max, hitRecords[r]);
+		packet.traversalRays[r].set(packet.rays[r], 0, t_max);
+		packet.hit[r] = false;
 	}
+	packet.finalize();
 
-	return intersected;
+	root->intersectPacket(packet, hitRecords);
+	for (size_t r = 0; r < packet.size; r++) {
+		packet.hit[r] = packet.hit[r] || unboundedHits[r];
+	}
 }
 
 /*
@@ -284,7 +736,6 @@ void World::determineColor(const int& currentRow, const int& currentColumn, bool
 
 	// Otherwise, determine color at pixel
 	const Point3D& lightRayStart = hitRecord.intPoint;
-	bool shadow = false;
 
 	// Color Part 1: Ambient Term
 	ColorRGB ambientComponent = (hitRecord.material.ambient / 255).elementMultiply(ambientLight / 255);
@@ -300,32 +751,17 @@ void World::determineColor(const int& currentRow, const int& currentColumn, bool
 		const Ray3D lightRay{ lightRayStart, currentLightPoint - lightRayStart };
 
 		// Iterate over all objects for the current light source to find shadow
-		if (OPT_BVH() || OPT_TRIANGLE_MESH()) {
-			const double t_max_shadow = lightRay.getT(currentLightPoint);
-			HitRecord shadowHitRecord;
-			if (root.intersection(lightRay, 0, t_max_shadow, shadowHitRecord)) {
-				shadow = true;
+		// Any hit before the ray reaches the light source is enough, so only an occlusion query is needed
+		const double t_max_shadow = lightRay.getT(currentLightPoint);
+		if (usesBVH()) {
+			if (occludedUnbounded(lightRay, 0, t_max_shadow) || accelerator->occluded(lightRay, 0, t_max_shadow)) {
 				break;
 			}
 		}
-		else {
-			for (int j = 0; j < sceneObjects.size(); j++) {
-				const SceneObject* currSceneObject = sceneObjects[j].get();
-				HitRecord currLightHitRecord;
-				bool currShadow = currSceneObject->intersection(lightRay, 0, MAX_T, currLightHitRecord);
-
-				// intersection happens ONLY IF the intersection point happens BEFORE the ray reaches the light source
-				if (currShadow && lightRayStart.distanceTo(currLightHitRecord.intPoint) < lightRayStart.distanceTo(currentLightPoint)) {
-					shadow = true;
-					diffuseComponent = BLACK_COLOR / 255;
-					specularComponent = BLACK_COLOR / 255;
-					break;
-				}
-				// otherwise, apply phong reflection model
-			}
-			if (shadow) {
-				break;
-			}
+		else if (occludedSceneObjects(lightRay, 0, t_max_shadow)) {
+			diffuseComponent = BLACK_COLOR / 255;
+			specularComponent = BLACK_COLOR / 255;
+			break;
 		}
 
 		// If no shadow, apply phong reflection model
@@ -387,6 +823,52 @@ ColorRGB World::rayTrace(const int& currentRow, const int& currentColumn, const
 	return pixelColor;
 }
 
+/*
+* Renders a block of up to rayPacketSize x rayPacketSize pixels, tracing the same sample of every pixel as one packet
+*
+* @param rowStart The first row of the block.
+* @param colStart The first column of the block.
+* @param image The Image being rendered. Modified by function.
+*/
+void World::renderBlock(const int& rowStart, const int& colStart, Image& image)
+{
+	const int blockRows = std::min(rayPacketSize, camera.getViewWindowRows() - rowStart);
+	const int blockCols = std::min(rayPacketSize, camera.getViewWindowCols() - colStart);
+	const size_t pixelCount = (size_t)(blockRows * blockCols);
+
+	// Generate multiple samples with anti-aliasing, one sample without. Every pixel gets the same number of samples.
+	std::pair<double, double> offsets[RAY_PACKET_MAX_RAYS][ANTI_ALIASING_SAMPLES];
+	int sampleCount = 1;
+	for (size_t p = 0; p < pixelCount; p++) {
+		if (OPT_ANTI_ALIASING()) {
+			sampleCount = Arithmetic::multi_jittered_sampling(ANTI_ALIASING_DIVISIONS, offsets[p]);
+		}
+		else {
+			offsets[p][0] = std::make_pair(0.5, 0.5);
+		}
+	}
+
+	RayPacket packet;
+	packet.size = pixelCount;
+	HitRecord hitRecords[RAY_PACKET_MAX_RAYS];
+	std::pair<double, double> sampleOffsets[RAY_PACKET_MAX_RAYS];
+	ColorRGB colors[RAY_PACKET_MAX_RAYS][ANTI_ALIASING_SAMPLES];
+	for (int sample = 0; sample < sampleCount; sample++) {
+		for (size_t p = 0; p < pixelCount; p++) {
+			sampleOffsets[p] = offsets[p][sample];
+		}
+		shootPrimaryPacket(rowStart, colStart, blockCols, sampleOffsets, packet, hitRecords);
+		for (size_t p = 0; p < pixelCount; p++) {
+			determineColor(rowStart + (int)p / blockCols, colStart + (int)p % blockCols, packet.hit[p], packet.rays[p], hitRecords[p], colors[p][sample]);
+		}
+	}
+
+	// Take average of all colors for every pixel
+	for (size_t p = 0; p < pixelCount; p++) {
+		image.set(rowStart + (int)p / blockCols, colStart + (int)p % blockCols, Arithmetic::averageVec3D(colors[p], sampleCount));
+	}
+}
+
 /*
 * Render the World into an Image object
 *
@@ -397,6 +879,7 @@ Image World::render()
 	// Preliminary setup
 	std::cout << "Total Scene Objects: " << sceneObjects.size() << std::endl;
 	std::cout << "Total Light Sources: " << lightSources.size() << std::endl;
+	std::cout << "SIMD Kernels: " << SimdKernels::levelName(SimdKernels::level()) << " (" << SimdKernels::laneCount() << " lanes)" << std::endl;
 
 	int rows = camera.getViewWindowRows();
 	int cols = camera.getViewWindowCols();
@@ -408,50 +891,237 @@ Image World::render()
 
 	camera.ready();
 
-	// Record Start time
+	// Record Start time (wall clock, the BVH build runs on several threads)
 	auto start_time = std::chrono::high_resolution_clock::now();
 
 	// Preliminary: Prepare BVH Tree
-	clock_t start;
-	start = clock();
+	BVHBuildParameters buildParameters = bvhBuildParameters;
+	if (OPT_LBVH()) {
+		buildParameters.splitMethod = BVHSplitMethod::LBVH;
+	}
+	else if (OPT_SBVH()) {
+		buildParameters.splitMethod = BVHSplitMethod::SBVH;
+	}
+	else if (OPT_BVH_SAH()) {
+		buildParameters.splitMethod = BVHSplitMethod::SAH;
+	}
+	if (OPT_OPTIMIZE_BVH() && buildParameters.optimizationSeconds <= 0) {
+		buildParameters.optimizationSeconds = DEFAULT_BVH_OPTIMIZATION_SECONDS;
+	}
+
+	// Planes have no bounding box, so they stay out of the BVH and are tested before every traversal instead
+	std::vector<std::shared_ptr<SceneObject>> boundedObjects = partitionBoundedObjects();
+	if (usesBVH() && !unboundedObjects.empty()) {
+		std::cout << "Unbounded Objects kept outside the BVH: " << unboundedObjects.size() << std::endl;
+	}
+
+	// Without a BVH, the spheres and triangles are traced in packs through the SIMD kernels
+	if (!usesBVH()) {
+		packSceneObjects();
+	}
 
-	if (OPT_TRIANGLE_MESH()) {
+	// With DYNAMIC_BVH, the BVH of the last render is kept, and objects added, removed or moved since were already edited into it.
+	// Changing the mesh, the options or the build parameters drops it, since what it should hold changes with them.
+	if (!usesBVH() || !OPT_DYNAMIC_BVH()) {
+		dynamicBVH.reset();
+	}
+
+	// With KD_TREE, GRID or DYNAMIC_BVH, one flat structure is built over everything a BVH would hold, MeshInstances included, in place of the BVH
+	std::shared_ptr<KdTree> kdTree;
+	std::shared_ptr<Grid> grid;
+	if (dynamicBVH) {
+		std::cout << std::endl << "Reusing dynamic BVH over " << dynamicBVH->size() << " objects." << std::endl;
+		root.reset();
+	}
+	else if (usesBVH() && (OPT_KD_TREE() || OPT_GRID() || OPT_TWO_LEVEL_GRID() || OPT_DYNAMIC_BVH())) {
+		std::vector<std::shared_ptr<Object>> flatObjects;
+		if (OPT_BVH() || !meshInstances.empty()) {
+			flatObjects.assign(boundedObjects.begin(), boundedObjects.end());
+		}
+		if (OPT_TRIANGLE_MESH() && triangleMesh) {
+			const std::vector<std::shared_ptr<Triangle>> triangles = triangleMesh->getTriangles();
+			flatObjects.insert(flatObjects.end(), triangles.begin(), triangles.end());
+		}
+		flatObjects.insert(flatObjects.end(), meshInstances.begin(), meshInstances.end());
+		if (OPT_KD_TREE()) {
+			std::cout << std::endl << "Building kd-tree over " << flatObjects.size() << " objects..." << std::endl;
+			kdTree = std::make_shared<KdTree>(flatObjects);
+		}
+		else if (OPT_DYNAMIC_BVH()) {
+			std::cout << std::endl << "Building dynamic BVH over " << flatObjects.size() << " objects..." << std::endl;
+			dynamicBVH = std::make_shared<DynamicBVH>(flatObjects, buildParameters);
+		}
+		else {
+			std::cout << std::endl << "Building " << (OPT_TWO_LEVEL_GRID() ? "two-level " : "") << "grid over " << flatObjects.size() << " objects..." << std::endl;
+			grid = std::make_shared<Grid>(flatObjects, OPT_TWO_LEVEL_GRID());
+		}
+		root.reset();
+	}
+	// With REFIT_BVH, a BVH left over from the previous render is refit to the moved primitives instead of rebuilt. Adding or
+	// removing objects, changing the mesh, the options or the build parameters drops it, so it's only refit over the same primitives
+	else if (usesBVH() && OPT_REFIT_BVH() && root) {
+		std::cout << std::endl << "Refitting BVH..." << std::endl;
+		if (root->update()) {
+			std::cout << "SAH cost degraded too far, rebuilt BVH." << std::endl;
+		}
+	}
+	else if (usesTwoLevelBVH()) {
+		// The world's TriangleMesh is traced in place, so it becomes an identity instance of its own bottom-level BVH
+		std::vector<std::shared_ptr<Object>> topLevelObjects(boundedObjects.begin(), boundedObjects.end());
+		topLevelObjects.insert(topLevelObjects.end(), meshInstances.begin(), meshInstances.end());
+		if (OPT_TRIANGLE_MESH() && triangleMesh) {
+			std::shared_ptr<LinearBVH> meshBVH = triangleMeshBVH;
+			if (!meshBVH) {
+				std::cout << std::endl << "Building bottom-level BVH from TriangleMesh..." << std::endl;
+				meshBVH = std::make_shared<LinearBVH>(triangleMesh, buildParameters);
+			}
+			topLevelObjects.push_back(std::make_shared<MeshInstance>(meshBVH, Mat4(), Mat4()));
+		}
+		std::cout << std::endl << "Building top-level BVH over " << topLevelObjects.size() << " objects and instances..." << std::endl;
+		root = std::make_shared<LinearBVH>(topLevelObjects, buildParameters);
+	}
+	else if (OPT_TRIANGLE_MESH() && triangleMeshBVH) {
+		std::cout << std::endl << "Using prebuilt BVH for TriangleMesh." << std::endl;
+		root = triangleMeshBVH;
+	}
+	else if (OPT_TRIANGLE_MESH()) {
 		std::cout << std::endl << "Building BVH from TriangleMesh..." << std::endl;
-		root = BVHNode(triangleMesh);
+		root = std::make_shared<LinearBVH>(triangleMesh, buildParameters);
 	} else if (OPT_BVH()) {
 		std::cout << std::endl << "Building BVH from sceneObjects..." << std::endl;
-		root = BVHNode(sceneObjects);
+		root = std::make_shared<LinearBVH>(boundedObjects, buildParameters);
+	}
+
+	// Collapse into a wide BVH if one was selected, otherwise trace the binary BVH
+	std::shared_ptr<CompressedBVH> compressedRoot;
+	std::shared_ptr<BVH8> wideRoot8;
+	std::shared_ptr<BVH4> wideRoot4;
+	if (kdTree) {
+		accelerator = kdTree;
+	}
+	else if (grid) {
+		accelerator = grid;
+	}
+	else if (dynamicBVH) {
+		accelerator = dynamicBVH;
+	}
+	else if (usesBVH() && OPT_COMPRESSED_BVH()) {
+		compressedRoot = std::make_shared<CompressedBVH>(*root);
+		accelerator = compressedRoot;
+	}
+	else if (usesBVH() && OPT_BVH8()) {
+		wideRoot8 = std::make_shared<BVH8>(*root);
+		accelerator = wideRoot8;
+	}
+	else if (usesBVH() && OPT_BVH4()) {
+		wideRoot4 = std::make_shared<BVH4>(*root);
+		accelerator = wideRoot4;
+	}
+	else {
+		accelerator = root;
 	}
 
-	// Record BVH time (if applicable)
+	// Record BVH time and statistics (if applicable)
 	double bvh_seconds = 0;
-	auto bvh_finish_time = clock();
-	if (OPT_TRIANGLE_MESH() || OPT_BVH()) {
-		bvh_seconds = ((double)(bvh_finish_time - start)) / ((double)(CLOCKS_PER_SEC));
-		std::cout << "Done building BVH! Took " << bvh_seconds << " seconds." << std::endl << std::endl;
+	double bvh_sah_cost = 0;
+	auto bvh_finish_time = std::chrono::high_resolution_clock::now();
+	bvhStatistics = BVHStatistics();
+	if (usesBVH()) {
+		bvh_seconds = std::chrono::duration<double>(bvh_finish_time - start_time).count();
+	}
+	if (kdTree) {
+		std::cout << "Done building kd-tree! Took " << bvh_seconds << " seconds." << std::endl;
+		std::cout << "kd-tree Nodes: " << kdTree->getNodes().size() << " (" << kdTree->getNodes().size() * sizeof(KdTreeNode) << " bytes)" << std::endl;
+		std::cout << "kd-tree References: " << kdTree->getPrimitiveIndices().size() << std::endl;
+		std::cout << "kd-tree Memory: " << kdTree->memoryBytes() << " bytes" << std::endl << std::endl;
+	}
+	else if (grid) {
+		const GridLevel& topLevel = grid->getTopLevel();
+		std::cout << "Done building grid! Took " << bvh_seconds << " seconds." << std::endl;
+		std::cout << "Grid Resolution: " << topLevel.resolution[0] << " x " << topLevel.resolution[1] << " x " << topLevel.resolution[2] << " (" << grid->getSubGrids().size() << " sub-grids)" << std::endl;
+		std::cout << "Grid Memory: " << grid->memoryBytes() << " bytes" << std::endl << std::endl;
+	}
+	else if (dynamicBVH) {
+		bvh_sah_cost = dynamicBVH->sahCost(buildParameters);
+		std::cout << "Dynamic BVH ready! Took " << bvh_seconds << " seconds." << std::endl;
+		std::cout << "BVH SAH Cost: " << bvh_sah_cost << std::endl;
+		std::cout << "BVH Nodes: " << dynamicBVH->nodeCount() << " (height " << dynamicBVH->height() << ")" << std::endl << std::endl;
+	}
+	else if (usesBVH()) {
+		bvhStatistics = BVHStatistics(*root, buildParameters);
+		bvhStatistics.buildSeconds = bvh_seconds;
+		if (compressedRoot) {
+			bvhStatistics.addWideBVH(*compressedRoot);
+		}
+		else if (wideRoot8) {
+			bvhStatistics.addWideBVH(*wideRoot8);
+		}
+		else if (wideRoot4) {
+			bvhStatistics.addWideBVH(*wideRoot4);
+		}
+		bvh_sah_cost = bvhStatistics.sahCost;
+		std::cout << "Done building BVH! Took " << bvh_seconds << " seconds." << std::endl;
+		std::cout << "BVH SAH Cost: " << bvh_sah_cost << std::endl;
+		std::cout << "BVH Nodes: " << bvhStatistics.nodeCount << " (" << bvhStatistics.nodeBytes << " bytes)" << std::endl;
+		if (root->getDuplicatedReferences() > 0) {
+			std::cout << "Duplicated References: " << root->getDuplicatedReferences() << std::endl;
+		}
+		if (bvhStatistics.wideNodeCount > 0) {
+			std::cout << (compressedRoot ? "Compressed" : "Wide") << " BVH Nodes: " << bvhStatistics.wideNodeCount << " (" << bvhStatistics.wideNodeBytes << " bytes)" << std::endl;
+		}
+		if (bvhStatisticsFilepath.empty()) {
+			std::cout << "BVH Statistics: " << bvhStatistics.toJSON() << std::endl;
+		}
+		else if (bvhStatistics.writeJSON(bvhStatisticsFilepath)) {
+			std::cout << "BVH Statistics written to " << bvhStatisticsFilepath << std::endl;
+		}
+		std::cout << std::endl;
 	}
 
 	std::cout << std::endl;
+	auto ray_tracing_start_time = std::chrono::high_resolution_clock::now();
+	const uint64_t ray_tracing_start_allocations = AllocationCounter::count();
+
+	// With RAY_PACKETS, blocks of pixels are traced as packets through the binary BVH; other accelerators trace rays one at a time
+	const bool tracePackets = OPT_RAY_PACKETS() && root && accelerator == root;
+	if (OPT_RAY_PACKETS() && !tracePackets) {
+		std::cout << "Ray packets need the binary BVH, tracing rays one at a time." << std::endl;
+	}
+	else if (tracePackets) {
+		std::cout << "Tracing " << rayPacketSize << "x" << rayPacketSize << " ray packets." << std::endl;
+	}
+
+	// Iterate over all blocks of pixels, perform packet ray tracing on each
+	for (int i = 0; tracePackets && i < rows; i += rayPacketSize) {
+		for (int j = 0; j < cols; j += rayPacketSize) {
+			renderBlock(i, j, rm);
+		}
+		while (blockCount <= (size_t)(std::min(i + rayPacketSize, rows) * 100 / rows)) {
+			std::cout << "Rendering ... " << blockCount << "% done" << std::endl;
+			blockCount++;
+		}
+	}
 
 	// Iterate over all pixels, perform ray tracing on each
-	for (int i = 0; i < rows; i++) {
+	for (int i = 0; !tracePackets && i < rows; i++) {
 		for (int j = 0; j < cols; j++) {
 
 			// Generate multiple samples with anti-aliasing, one sample without
-			std::vector<std::pair<double, double>> offsets{};
+			std::pair<double, double> offsets[ANTI_ALIASING_SAMPLES];
+			int sampleCount = 1;
 			if (OPT_ANTI_ALIASING()) {
-				Arithmetic::multi_jittered_sampling(4, offsets);
+				sampleCount = Arithmetic::multi_jittered_sampling(ANTI_ALIASING_DIVISIONS, offsets);
 			}
 			else {
-				offsets.push_back(std::make_pair(0.5, 0.5));
+				offsets[0] = std::make_pair(0.5, 0.5);
 			}
-			std::vector<ColorRGB> colors;
-			for (std::pair<double, double> o : offsets) {
-				colors.push_back(rayTrace(i, j, o.first, o.second));
+			ColorRGB colors[ANTI_ALIASING_SAMPLES];
+			for (int sample = 0; sample < sampleCount; sample++) {
+				colors[sample] = rayTrace(i, j, offsets[sample].first, offsets[sample].second);
 			}
 
 			// Take average of all colors for current pixel
-			rm.set(i, j, Arithmetic::averageVec3D(colors));
+			rm.set(i, j, Arithmetic::averageVec3D(colors, sampleCount));
 
 			if ((i * rows + j) % progressBlock == 0) {
 				std::cout << "Rendering ... " << blockCount << "% done" << std::endl;
@@ -462,18 +1132,24 @@ Image World::render()
 	std::cout << "Rendering ... " << blockCount << "% done" << std::endl;
 
 	// Record Ending times
-	double ray_tracing_seconds = 0;
-	auto render_finish_time = clock();
-	ray_tracing_seconds = ((double)(render_finish_time - bvh_finish_time)) / ((double)(CLOCKS_PER_SEC));
+	auto render_finish_time = std::chrono::high_resolution_clock::now();
+	double ray_tracing_seconds = std::chrono::duration<double>(render_finish_time - ray_tracing_start_time).count();
+	bvhConstructionSeconds = bvh_seconds;
+	rayTracingSeconds = ray_tracing_seconds;
+	rayTracingAllocations = AllocationCounter::count() - ray_tracing_start_allocations;
 
 	double total_render_seconds = ray_tracing_seconds;
 	
 	std::cout << "Statistics:" << std::endl;
-	if (OPT_TRIANGLE_MESH() || OPT_BVH()) {
+	if (usesBVH()) {
 		std::cout << "BVH Construction Time: " << bvh_seconds << " seconds." << std::endl;
+		std::cout << "BVH SAH Cost: " << bvh_sah_cost << std::endl;
 		total_render_seconds += bvh_seconds;
 	}
 	std::cout << "Ray Tracing Time: " << ray_tracing_seconds << " seconds." << std::endl;
+	if (AllocationCounter::enabled()) {
+		std::cout << "Heap Allocations While Ray Tracing: " << rayTracingAllocations << std::endl;
+	}
 	std::cout << "Total Render Time: " << total_render_seconds << " seconds." << std::endl << std::endl;
 
 	// Return rendered image
@@ -15,28 +15,62 @@
 #include "Image.h"
 #include "Camera.h"
 #include "BVHNode.h"
+#include "LinearBVH.h"
+#include "WideBVH.h"
+#include "CompressedBVH.h"
+#include "KdTree.h"
+#include "Grid.h"
+#include "DynamicBVH.h"
+#include "MeshInstance.h"
+#include "BVHCache.h"
+#include "BVHStatistics.h"
+#include "TrianglePacks.h"
+#include "SpherePacks.h"
+#include "AllocationCounter.h"
 
 #include "PointLightSource.h"
 #include "TriangleMesh.h"
 
-enum class RenderOption { ANTI_ALIASING, BVH, TRIANGLE_MESH };
+enum class RenderOption { ANTI_ALIASING, BVH, TRIANGLE_MESH, BVH_SAH, LBVH, BVH4, BVH8, REFIT_BVH, SBVH, OPTIMIZE_BVH, COMPRESSED_BVH, KD_TREE, GRID, TWO_LEVEL_GRID, DYNAMIC_BVH, RAY_PACKETS };
 
 const Point3D DEFAULT_VIEW_WINDOW[4]{ Point3D({-8, 4.5, -4.5}), Point3D({8, 4.5, -4.5}), Point3D({8, -4.5, -4.5}), Point3D({-8, -4.5, -4.5}) };
 
 const double MAX_T = 100000;
 
+constexpr int DEFAULT_RAY_PACKET_SIZE = 4;	// RAY_PACKETS traces blocks of this many pixels squared together
+constexpr int ANTI_ALIASING_DIVISIONS = 4;	// ANTI_ALIASING takes multi-jittered samples on this many coarse cells per axis
+constexpr int ANTI_ALIASING_SAMPLES = ANTI_ALIASING_DIVISIONS * ANTI_ALIASING_DIVISIONS;
+
 class World
 {
 private:
 	std::vector<std::shared_ptr<SceneObject>> sceneObjects;
+	std::vector<std::shared_ptr<SceneObject>> unboundedObjects;	// SceneObjects without a bounding box (Planes), tested alongside the BVH
+	std::vector<std::shared_ptr<Object>> packedTriangles;	// the Triangles among sceneObjects, in the order of trianglePacks
+	TrianglePacks trianglePacks;	// SIMD-filtered copies of the sceneObjects, traced in place of them when there is no BVH
+	SpherePacks spherePacks;
+	std::vector<std::shared_ptr<SceneObject>> unpackedObjects;	// the sceneObjects neither pack holds
+	bool sceneObjectsPacked;	// false until render() packs the sceneObjects, and again after any of them is added, removed or moved
 	std::vector<std::shared_ptr<LightSource>> lightSources;
 	std::shared_ptr<TriangleMesh> triangleMesh;
+	std::shared_ptr<LinearBVH> triangleMeshBVH;	// prebuilt BVH over triangleMesh, if one was given
+	std::vector<std::shared_ptr<MeshInstance>> meshInstances;
 	std::vector<RenderOption> renderOptions;
 	Image backgroundImage;
 	Camera camera;
 	ColorRGB ambientLight;
 
-	BVHNode root;
+	std::shared_ptr<LinearBVH> root;	// kept between renders for REFIT_BVH, dropped whenever the primitives, options or build parameters change
+	std::shared_ptr<DynamicBVH> dynamicBVH;	// kept between renders with DYNAMIC_BVH, edited in place as objects are added, removed or moved, dropped when the mesh, options or build parameters change
+	std::shared_ptr<Object> accelerator;	// what rays are traced against: root, a wide BVH collapsed from it, a kd-tree or a grid
+	BVHBuildParameters bvhBuildParameters;
+	BVHStatistics bvhStatistics;
+	std::string bvhStatisticsFilepath;	// where the statistics JSON is written after each build, printed to the console if empty
+	int rayPacketSize;	// side of the pixel blocks traced as one packet with RAY_PACKETS: 2, 4 or 8
+
+	double bvhConstructionSeconds;
+	double rayTracingSeconds;
+	uint64_t rayTracingAllocations;	// heap allocations made while tracing rays, counted with COUNT_HEAP_ALLOCATIONS
 
 public:
 	World();
@@ -45,32 +79,69 @@ public:
 	const std::vector<std::shared_ptr<SceneObject>>& getSceneObjects() const;
 	const std::vector<std::shared_ptr<LightSource>>& getLightSource() const;
 	const std::shared_ptr<TriangleMesh>& getTriangleMesh() const;
+	const std::vector<std::shared_ptr<MeshInstance>>& getMeshInstances() const;
 	const std::vector<RenderOption>& getRenderOptions() const;
 	const Image& getBackgroundImage();
 	const Camera& getCamera() const;
 	Camera& getCamera();
 	const ColorRGB& getAmbientLight();
+	const BVHBuildParameters& getBVHBuildParameters() const;
+	double getBVHConstructionSeconds() const;
+	double getRayTracingSeconds() const;
+	uint64_t getRayTracingAllocations() const;
+	const BVHStatistics& getBVHStatistics() const;
+	int getRayPacketSize() const;
 
 	bool OPT_ANTI_ALIASING() const;
 	bool OPT_BVH() const;
 	bool OPT_TRIANGLE_MESH() const;
+	bool OPT_BVH_SAH() const;
+	bool OPT_LBVH() const;
+	bool OPT_BVH4() const;
+	bool OPT_BVH8() const;
+	bool OPT_REFIT_BVH() const;
+	bool OPT_SBVH() const;
+	bool OPT_OPTIMIZE_BVH() const;
+	bool OPT_COMPRESSED_BVH() const;
+	bool OPT_KD_TREE() const;
+	bool OPT_GRID() const;
+	bool OPT_TWO_LEVEL_GRID() const;
+	bool OPT_DYNAMIC_BVH() const;
+	bool OPT_RAY_PACKETS() const;
 
 	void addSceneObject(std::shared_ptr<SceneObject> sceneObject);
+	bool removeSceneObject(const std::shared_ptr<SceneObject>& sceneObject);
+	void updateSceneObject(const std::shared_ptr<SceneObject>& sceneObject);
 	void addLightSource(std::shared_ptr<LightSource> lightSource);
 	void setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh);
+	void setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh, const std::shared_ptr<LinearBVH>& triangleMeshBVH);
+	void addMeshInstance(const std::shared_ptr<MeshInstance>& meshInstance);
 	void addRenderOption(const RenderOption& renderOption);
 	void setBackgroundImage(Image&& image);
 	void setCamera(const Camera& camera);
 	void setAmbientLight(const ColorRGB& ambientLight);
+	void setBVHBuildParameters(const BVHBuildParameters& bvhBuildParameters);
+	void setBVHStatisticsFilepath(const std::string& bvhStatisticsFilepath);
+	void setRayPacketSize(int rayPacketSize);
 
 	// Ray Tracing Helper Methods
+	bool usesBVH() const;
+	bool usesTwoLevelBVH() const;
 	AABB3D surroundingBox(const AABB3D& box0, const AABB3D& box1) const;
 	bool surroundingBox(const std::vector<std::shared_ptr<Object>>& objects, AABB3D& bb) const;
+	std::vector<std::shared_ptr<SceneObject>> partitionBoundedObjects();
+	bool intersectUnbounded(const Ray3D& ray, const double& t_min, double& t_max, HitRecord& hitRecord) const;
+	bool occludedUnbounded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+	void packSceneObjects();
+	bool intersectSceneObjects(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+	bool occludedSceneObjects(const Ray3D& ray, const double& t_min, const double& t_max) const;
 
 	// Ray Tracing Main Methods
 	bool shootPrimaryRay(const int& currentRow, const int& currentColumn, const double& xOffset, const double& yOffset, Ray3D& firstRay, HitRecord& hitRecord);
 	void determineColor(const int& currentRow, const int& currentColumn, bool intersected, const Ray3D& firstRay, HitRecord& hitRecord, ColorRGB& pixelColor);
+	void shootPrimaryPacket(const int& rowStart, const int& colStart, const int& blockCols, const std::pair<double, double>* offsets, RayPacket& packet, HitRecord* hitRecords);
 
 	ColorRGB rayTrace(const int& currentRow, const int& currentColumn, const double& xOffset, const double& yOffset);
+	void renderBlock(const int& rowStart, const int& colStart, Image& image);
 	Image render();
 };
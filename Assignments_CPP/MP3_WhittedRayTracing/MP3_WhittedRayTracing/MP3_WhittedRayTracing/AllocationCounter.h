@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Defined in the project's Debug configurations (or define it here) to count every heap allocation made through the global
+// operator new, including its array and aligned forms.
+// World::render then reports how many were made while tracing rays, which should be none.
+//#define COUNT_HEAP_ALLOCATIONS
+
+namespace AllocationCounter
+{
+    bool enabled();
+    uint64_t count();
+}
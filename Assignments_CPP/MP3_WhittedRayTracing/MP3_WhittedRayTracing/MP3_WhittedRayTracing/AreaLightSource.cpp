@@ -7,7 +7,7 @@ AreaLightSource::AreaLightSource(const Point3D(&v)[3], const std::shared_ptr<Mat
 	Arithmetic::generateTriangleSamplePoints(vertex0(), vertex1(), vertex2(), 25, samplePoints);
 }
 
-const std::vector<Point3D> AreaLightSource::getSamplePoints() const
+const std::vector<Point3D>& AreaLightSource::getSamplePoints() const
 {
 	return samplePoints;
 }
\ No newline at end of file
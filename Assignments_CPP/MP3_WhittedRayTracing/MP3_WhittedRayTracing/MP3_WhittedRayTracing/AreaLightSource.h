@@ -8,6 +8,6 @@ private:
 public:
     AreaLightSource(const Point3D(&v)[3], const std::shared_ptr<Material>& material);
 
-    const std::vector<Point3D> getSamplePoints() const;
+    const std::vector<Point3D>& getSamplePoints() const;
 };
 
@@ -17,23 +17,25 @@
 
 namespace Arithmetic {
     const double EPSILON = 0.00001;
+    constexpr int MULTI_JITTERED_MAX_DIVISIONS = 8;     // coarse cells per axis multi_jittered_sampling has room for
     static std::default_random_engine generator;
     static std::uniform_real_distribution<double> doubleDistribution(0, 1);
     //static std::uniform_real_distribution<int> intDistribution(0, 1);
 
-    static int quadratic_solver(const double& a, const double& b, const double& c, std::vector<double>& sols) {
+    // Writes the real roots of a * x^2 + b * x + c to sols and returns how many there are
+    static int quadratic_solver(const double& a, const double& b, const double& c, double(&sols)[2]) {
         double discriminant = b * b - 4.0 * a * c;
 
         if (discriminant < 0.0) {
             return 0;
         }
         else if (discriminant == 0.0) {
-            sols.push_back((-1.0 * b) / (2.0 * a));
+            sols[0] = (-1.0 * b) / (2.0 * a);
             return 1;
         }
         else {
-            sols.push_back(((-1.0 * b) + std::sqrt(discriminant)) / (2.0 * a));
-            sols.push_back(((-1.0 * b) - std::sqrt(discriminant)) / (2.0 * a));
+            sols[0] = ((-1.0 * b) + std::sqrt(discriminant)) / (2.0 * a);
+            sols[1] = ((-1.0 * b) - std::sqrt(discriminant)) / (2.0 * a);
             return 2;
         }
     };
@@ -61,43 +63,62 @@ namespace Arithmetic {
 
     // Intersection between triangle and ray
     // Credit to the geniuses at wikipedia
+    // Takes the triangle's first vertex and edges (vertex1 - vertex0, vertex2 - vertex0) computed ahead of time, so nothing
+    // is rebuilt per test. Also returns the barycentric coordinates of the hit: u weights vertex1, v weights vertex2
+    // and 1 - u - v weights vertex0.
     static bool moller_trumbore(const Point3D& rayOrigin,
         const Vec3D& rayVector,
-        const Point3D(&inTriangle)[3],
+        const Point3D& vertex0,
+        const Vec3D& edge1,
+        const Vec3D& edge2,
         double& intT,
-        Point3D& outIntersectionPoint)
+        double& u,
+        double& v)
     {
-        //const double EPSILON = 0.0000001;
-        Vec3D vertex0 = inTriangle[0];
-        Vec3D vertex1 = inTriangle[1];
-        Vec3D vertex2 = inTriangle[2];
-        Vec3D edge1, edge2, h, s, q;
-        double a, f, u, v;
-        edge1 = vertex1 - vertex0;
-        edge2 = vertex2 - vertex0;
-        h = rayVector.crossProduct(edge2);
-        a = edge1.dotProduct(h);
+        const double dx = rayVector[0], dy = rayVector[1], dz = rayVector[2];
+        const double e1x = edge1[0], e1y = edge1[1], e1z = edge1[2];
+        const double e2x = edge2[0], e2y = edge2[1], e2z = edge2[2];
+
+        double hx = dy * e2z - dz * e2y;
+        double hy = dz * e2x - dx * e2z;
+        double hz = dx * e2y - dy * e2x;
+        double a = e1x * hx + e1y * hy + e1z * hz;
         if (a > -EPSILON && a < EPSILON)
             return false;    // This ray is parallel to this triangle.
-        f = 1.0 / a;
-        s = rayOrigin - vertex0;
-        u = f * s.dotProduct(h);
+        double f = 1.0 / a;
+        double sx = rayOrigin[0] - vertex0[0];
+        double sy = rayOrigin[1] - vertex0[1];
+        double sz = rayOrigin[2] - vertex0[2];
+        u = f * (sx * hx + sy * hy + sz * hz);
         if (u < 0.0 || u > 1.0)
             return false;
-        q = s.crossProduct(edge1);
-        v = f * rayVector.dotProduct(q);
+        double qx = sy * e1z - sz * e1y;
+        double qy = sz * e1x - sx * e1z;
+        double qz = sx * e1y - sy * e1x;
+        v = f * (dx * qx + dy * qy + dz * qz);
         if (v < 0.0 || u + v > 1.0)
             return false;
-        // At this stage we can compute t to find out where the intersection point is on the line.
-        double t = f * edge2.dotProduct(q);
-        if (t > EPSILON) // ray intersection
-        {
+        double t = f * (e2x * qx + e2y * qy + e2z * qz);
+        if (t > EPSILON) {
             intT = t;
-            outIntersectionPoint = rayOrigin + rayVector * t;
             return true;
         }
-        else // This means that there is a line intersection but not a ray intersection.
-            return false;
+        return false;    // This means that there is a line intersection but not a ray intersection.
+    }
+
+    // Intersection between triangle and ray, for triangles without precomputed edges
+    static bool moller_trumbore(const Point3D& rayOrigin,
+        const Vec3D& rayVector,
+        const Point3D(&inTriangle)[3],
+        double& intT,
+        Point3D& outIntersectionPoint)
+    {
+        double u, v;
+        if (moller_trumbore(rayOrigin, rayVector, inTriangle[0], inTriangle[1] - inTriangle[0], inTriangle[2] - inTriangle[0], intT, u, v)) {
+            outIntersectionPoint = rayOrigin + rayVector * intT;
+            return true;
+        }
+        return false;
     }
 
     // credit to the geniuses at scratchpixel
@@ -148,12 +169,12 @@ namespace Arithmetic {
         return closestPointIdx;
     }
 
-    static Vec3D averageVec3D(const std::vector<Vec3D>& vecs) {
+    static Vec3D averageVec3D(const Vec3D* vecs, size_t count) {
         Vec3D sum;
-        for (const Vec3D& v : vecs) {
-            sum += v;
+        for (size_t i = 0; i < count; i++) {
+            sum += vecs[i];
         }
-        return sum / ((double)vecs.size());
+        return sum / ((double)count);
     }
 
     static void range(int start, int end, std::vector<int>& rangeVec) {
@@ -162,26 +183,27 @@ namespace Arithmetic {
         }
     }
 
-    static void multi_jittered_sampling(const int& division_factor, std::vector<std::pair<double, double>>& samples) {
+    // Writes division_factor^2 samples to samples, which must have room for them, and returns how many there are.
+    // The grids are kept in fixed-size arrays, so division_factor can be at most MULTI_JITTERED_MAX_DIVISIONS.
+    static int multi_jittered_sampling(const int& division_factor, std::pair<double, double>* samples) {
         auto rng = std::default_random_engine{};
 
         // keep track of coarse grid rows
-        std::vector<int> coarse;
+        int coarse[MULTI_JITTERED_MAX_DIVISIONS];
+        int coarseCount = 0;
         double coarse_grid_size = 1.0 / division_factor;
 
         // keep track of fine grid rows
-        // 2d vector: each element is a vector containing rows of a coarse grid row
+        // each coarse grid row holds the (shuffled) fine grid rows inside it
         int fineGridDivisions = division_factor * division_factor;
-        std::vector<std::vector<int>> fine;
-        std::vector<int> currFineVec;
-        for (int row = 0; row < fineGridDivisions + 1; row++) {
-            if (currFineVec.size() >= division_factor) {
-                std::vector<int> ee = currFineVec;
-                std::shuffle(std::begin(ee), std::end(ee), rng);
-                fine.push_back(ee);
-                currFineVec.clear();
+        int fine[MULTI_JITTERED_MAX_DIVISIONS][MULTI_JITTERED_MAX_DIVISIONS];
+        int fineCount[MULTI_JITTERED_MAX_DIVISIONS];
+        for (int cgr = 0; cgr < division_factor; cgr++) {
+            for (int k = 0; k < division_factor; k++) {
+                fine[cgr][k] = cgr * division_factor + k;
             }
-            currFineVec.push_back(row);
+            fineCount[cgr] = division_factor;
+            std::shuffle(fine[cgr], fine[cgr] + division_factor, rng);
         }
 
         double fine_grid_size = coarse_grid_size / division_factor;
@@ -192,25 +214,27 @@ namespace Arithmetic {
         // go column by column
         // and pick a remaining fine-grid row which is in a different coarse grid row for the current coarse grid column
         for (int col = 0; col < fineGridDivisions; col++) {
-            // refill coarse vector if we have moved to a new coarse column
-            if (coarse.size() == 0) {
-                range(0, division_factor, coarse);
-                std::shuffle(std::begin(coarse), std::end(coarse), rng);
+            // refill coarse rows if we have moved to a new coarse column
+            if (coarseCount == 0) {
+                for (int k = 0; k < division_factor; k++) {
+                    coarse[k] = k;
+                }
+                coarseCount = division_factor;
+                std::shuffle(coarse, coarse + division_factor, rng);
             }
 
             // pick a coarse grid row
-            int cgr = coarse.back();
-            coarse.pop_back();
+            int cgr = coarse[--coarseCount];
 
             // pick a fine grid row
-            int fgr = fine[cgr].back();
-            fine[cgr].pop_back();
+            int fgr = fine[cgr][--fineCount[cgr]];
 
             // generate a random point within the current fine grid
             double x = fine_grid_size * fgr + distribution(generator);
             double y = fine_grid_size * col + distribution(generator);
-            samples.push_back(std::make_pair(x, y));
+            samples[col] = std::make_pair(x, y);
         }
+        return fineGridDivisions;
     }
 
     // find barycentric coordinates of a point
@@ -272,9 +296,10 @@ namespace Arithmetic {
             double u = doubleDistribution(generator);
             double v = doubleDistribution(generator);
             double w = doubleDistribution(generator);
-            u /= (u + v + w);
-            v /= (u + v + w);
-            w /= (u + v + w);
+            double sum = u + v + w;
+            u /= sum;
+            v /= sum;
+            w /= sum;
 
             Point3D randPt;
             reverse_barycentric(a, b, c, u, v, w, randPt);
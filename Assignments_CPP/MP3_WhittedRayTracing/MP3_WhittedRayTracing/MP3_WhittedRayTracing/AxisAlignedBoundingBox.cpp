@@ -0,0 +1,144 @@
+#include "AxisAlignedBoundingBox.h"
+
+/*
+* Default constructor for AABB3D
+*/
+AxisAlignedBoundingBox::AxisAlignedBoundingBox() {}
+
+/*
+* AABB3D constructor
+* 
+* @param a The minimum point
+* @param b The maximum point
+*/
+AxisAlignedBoundingBox::AxisAlignedBoundingBox(const Point3D& a, const Point3D& b) : minimum(a), maximum(b) {}
+
+/*
+* @eturn The mimimum point
+*/
+Point3D& AxisAlignedBoundingBox::min()
+{
+    return minimum;
+}
+
+/*
+* @return The maximum point
+*/
+Point3D& AxisAlignedBoundingBox::max()
+{
+    return maximum;
+}
+
+/*
+* @return The mimimum point
+*/
+const Point3D& AxisAlignedBoundingBox::min() const
+{
+    return minimum;
+}
+
+/*
+* @return The maximum point
+*/
+const Point3D& AxisAlignedBoundingBox::max() const
+{
+    return maximum;
+}
+
+/*
+* Checks whether a ray intersects the AABB3D
+* 
+* @param r The ray
+* @param t_min Mimimum intersection t-value
+* @param t_max Maximum intersection t-value
+* 
+* @return True if r intersects this, false otherwise
+*/
+bool AxisAlignedBoundingBox::hit(const Ray3D& r, double t_min, double t_max) const
+{
+    double t_entry;
+    return hit(TraversalRay(r, t_min, t_max), t_entry);
+}
+
+/*
+* Checks whether a ray intersects the AABB3D, and where it enters it
+*
+* @param r The ray
+* @param t_min Mimimum intersection t-value
+* @param t_max Maximum intersection t-value
+* @param t_entry The t-value at which r enters the box (clamped to t_min). Modified by function.
+*
+* @return True if r intersects this, false otherwise
+*/
+bool AxisAlignedBoundingBox::hit(const Ray3D& r, double t_min, double t_max, double& t_entry) const
+{
+    return hit(TraversalRay(r, t_min, t_max), t_entry);
+}
+
+/*
+* Checks whether a ray prepared for traversal intersects the AABB3D within its [tMin, tMax], and where it enters it.
+* Flat boxes around axis-aligned triangles have t0 == t1, and are still hit.
+*
+* @param r The ray
+* @param t_entry The t-value at which r enters the box (clamped to r.tMin). Modified by function.
+*
+* @return True if r intersects this, false otherwise
+*/
+bool AxisAlignedBoundingBox::hit(const TraversalRay& r, double& t_entry) const
+{
+    return r.hitBox(minimum, maximum, t_entry);
+}
+
+/*
+* Grows the AABB3D so that it also surrounds another box
+*
+* @param other The box to enclose
+*/
+void AxisAlignedBoundingBox::expand(const AxisAlignedBoundingBox& other)
+{
+    for (int a = 0; a < 3; a++) {
+        minimum[a] = fmin(minimum[a], other.minimum[a]);
+        maximum[a] = fmax(maximum[a], other.maximum[a]);
+    }
+}
+
+/*
+* Grows the AABB3D so that it also surrounds a point
+*
+* @param p The point to enclose
+*/
+void AxisAlignedBoundingBox::expand(const Point3D& p)
+{
+    for (int a = 0; a < 3; a++) {
+        minimum[a] = fmin(minimum[a], p[a]);
+        maximum[a] = fmax(maximum[a], p[a]);
+    }
+}
+
+/*
+* @return The center point of the AABB3D
+*/
+Point3D AxisAlignedBoundingBox::centroid() const
+{
+    return (minimum + maximum) * 0.5;
+}
+
+/*
+* @return The surface area of the AABB3D (0 for an empty box)
+*/
+double AxisAlignedBoundingBox::surfaceArea() const
+{
+    Vec3D d = maximum - minimum;
+    if (d[0] < 0 || d[1] < 0 || d[2] < 0) {
+        return 0;
+    }
+    return 2.0 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+/*
+* @return AABB3D in pretty string format
+*/
+std::string AxisAlignedBoundingBox::toString() const
+{
+    return "Min: [" + minimum.toString() + "] | Max: [" + maximum.toString() + "]";
+}
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "BVH.h"
+
+#include <numeric>
+
+/*
+* Default constructor for BVH (an empty tree)
+*/
+BVH::BVH() : Object(ObjectType::BVH, nullptr) {}
+
+/*
+* Constructor for BVH
+*
+* @param list The Objects to build the BVH over. Every one of them must have a bounding box.
+*/
+BVH::BVH(const std::vector<std::shared_ptr<Object>>& list) : Object(ObjectType::BVH, nullptr), objects(list)
+{
+	if (objects.empty()) {
+		return;
+	}
+
+	buildBounds.resize(objects.size());
+	buildCentroids.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++) {
+		if (!objects[i]->generateBoundingBox(buildBounds[i])) {
+			std::cerr << "No bounding box in BVH constructor.\n";
+		}
+		buildCentroids[i] = buildBounds[i].centroid();
+	}
+	buildIndices.resize(objects.size());
+	std::iota(buildIndices.begin(), buildIndices.end(), 0);
+
+	nodes.reserve(2 * objects.size());
+	buildRecursive(0, objects.size(), 0);
+
+	// Put the Objects in leaf order, so every leaf is one contiguous range
+	std::vector<std::shared_ptr<Object>> orderedObjects;
+	orderedObjects.reserve(objects.size());
+	for (uint32_t index : buildIndices) {
+		orderedObjects.push_back(objects[index]);
+	}
+	objects.swap(orderedObjects);
+
+	buildBounds = std::vector<AABB3D>();
+	buildCentroids = std::vector<Point3D>();
+	buildIndices = std::vector<uint32_t>();
+}
+
+/*
+* Builds the subtree over buildIndices[start, end) and appends its nodes depth-first
+*
+* @param start The first Object of the subtree
+* @param end One past the last Object of the subtree
+* @param depth The depth of the subtree's root
+*
+* @return The index of the subtree's root
+*/
+uint32_t BVH::buildRecursive(size_t start, size_t end, int depth)
+{
+	uint32_t nodeIndex = (uint32_t)nodes.size();
+	nodes.push_back(BVHNode());
+
+	AABB3D bounds = EMPTY_BOUNDING_BOX;
+	AABB3D centroidBounds = EMPTY_BOUNDING_BOX;
+	for (size_t i = start; i < end; i++) {
+		bounds.expand(buildBounds[buildIndices[i]]);
+		centroidBounds.expand(buildCentroids[buildIndices[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	int axis = 0;
+	size_t mid = start;
+	if (end - start > 1 && depth < BVH_STACK_SIZE - 1) {
+		mid = partitionSAH(start, end, bounds, centroidBounds, axis);
+	}
+
+	if (mid == start) {
+		nodes[nodeIndex].offset = (uint32_t)start;
+		nodes[nodeIndex].count = (uint32_t)(end - start);
+		nodes[nodeIndex].axis = 0;
+		return nodeIndex;
+	}
+
+	buildRecursive(start, mid, depth + 1);
+	uint32_t secondChild = buildRecursive(mid, end, depth + 1);
+	nodes[nodeIndex].offset = secondChild;
+	nodes[nodeIndex].count = 0;
+	nodes[nodeIndex].axis = (uint32_t)axis;
+	return nodeIndex;
+}
+
+/*
+* Picks the cheapest binned SAH split of buildIndices[start, end) and partitions the range around it
+*
+* @param start The first Object of the node
+* @param end One past the last Object of the node
+* @param bounds The bounding box of the node
+* @param centroidBounds The bounding box of the node's Object centroids
+* @param axis The split axis. Modified by function.
+*
+* @return The first Object of the second child, or start if the node should stay a leaf
+*/
+size_t BVH::partitionSAH(size_t start, size_t end, const AABB3D& bounds, const AABB3D& centroidBounds, int& axis)
+{
+	const size_t count = end - start;
+	const double leafCost = (double)count;
+	const double parentArea = bounds.surfaceArea();
+
+	double bestCost = std::numeric_limits<double>::infinity();
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int a = 0; a < 3; a++) {
+		double extent = centroidBounds.max()[a] - centroidBounds.min()[a];
+		if (extent <= 0.0) {
+			continue;
+		}
+
+		AABB3D binBounds[BVH_BINS];
+		size_t binCounts[BVH_BINS]{};
+		for (int b = 0; b < BVH_BINS; b++) {
+			binBounds[b] = EMPTY_BOUNDING_BOX;
+		}
+		double scale = BVH_BINS / extent;
+		for (size_t i = start; i < end; i++) {
+			int b = std::min(BVH_BINS - 1, (int)((buildCentroids[buildIndices[i]][a] - centroidBounds.min()[a]) * scale));
+			binBounds[b].expand(buildBounds[buildIndices[i]]);
+			binCounts[b]++;
+		}
+
+		// Sweep from the right to get the area and count on the right of every split, then from the left to cost each one
+		double rightAreas[BVH_BINS];
+		size_t rightCounts[BVH_BINS];
+		AABB3D rightBounds = EMPTY_BOUNDING_BOX;
+		size_t rightCount = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--) {
+			rightBounds.expand(binBounds[b]);
+			rightCount += binCounts[b];
+			rightAreas[b] = rightBounds.surfaceArea();
+			rightCounts[b] = rightCount;
+		}
+		AABB3D leftBounds = EMPTY_BOUNDING_BOX;
+		size_t leftCount = 0;
+		for (int b = 0; b < BVH_BINS - 1; b++) {
+			leftBounds.expand(binBounds[b]);
+			leftCount += binCounts[b];
+			if (leftCount == 0 || rightCounts[b + 1] == 0) {
+				continue;
+			}
+			double cost = BVH_TRAVERSAL_COST;
+			if (parentArea > 0.0) {
+				cost += (leftBounds.surfaceArea() * leftCount + rightAreas[b + 1] * rightCounts[b + 1]) / parentArea;
+			}
+			else {
+				cost += (double)count;
+			}
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = a;
+				bestBin = b;
+			}
+		}
+	}
+
+	if (bestAxis >= 0 && (bestCost < leafCost || count > BVH_MAX_LEAF_OBJECTS)) {
+		axis = bestAxis;
+		double extent = centroidBounds.max()[axis] - centroidBounds.min()[axis];
+		double scale = BVH_BINS / extent;
+		auto first = buildIndices.begin() + start;
+		auto last = buildIndices.begin() + end;
+		auto middle = std::partition(first, last, [&](uint32_t index) {
+			return std::min(BVH_BINS - 1, (int)((buildCentroids[index][axis] - centroidBounds.min()[axis]) * scale)) <= bestBin;
+		});
+		if (middle != first && middle != last) {
+			return start + (middle - first);
+		}
+	}
+
+	if (count <= BVH_MAX_LEAF_OBJECTS) {
+		return start;
+	}
+
+	// Every centroid falls in one bin (or on one point): split the range in half along the widest axis
+	axis = 0;
+	for (int a = 1; a < 3; a++) {
+		if (centroidBounds.max()[a] - centroidBounds.min()[a] > centroidBounds.max()[axis] - centroidBounds.min()[axis]) {
+			axis = a;
+		}
+	}
+	size_t mid = start + count / 2;
+	std::nth_element(buildIndices.begin() + start, buildIndices.begin() + mid, buildIndices.begin() + end, [&](uint32_t a, uint32_t b) {
+		return buildCentroids[a][axis] < buildCentroids[b][axis];
+	});
+	return mid;
+}
+
+/*
+* @return The nodes of the BVH, root first
+*/
+const std::vector<BVHNode>& BVH::getNodes() const
+{
+	return nodes;
+}
+
+/*
+* @return The Objects of the BVH, in leaf order
+*/
+const std::vector<std::shared_ptr<Object>>& BVH::getObjects() const
+{
+	return objects;
+}
+
+/*
+* Generates the bounding box of the BVH
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return False if the BVH is empty, true otherwise
+*/
+bool BVH::generateBoundingBox(AABB3D& output_box) const
+{
+	if (nodes.empty()) {
+		return false;
+	}
+	output_box = nodes[0].bounds;
+	return true;
+}
+
+/*
+* Find the closest intersection, if any, with a Ray3D. Children are visited nearest first, and nodes the ray enters
+* beyond the closest hit so far are skipped.
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+* @param hitRecord A HitRecord struct which will store information related to the intersection (if any). Modified by function.
+*
+* @return The number of intersection points (1 or 0)
+*/
+int BVH::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
+{
+	if (nodes.empty()) {
+		return 0;
+	}
+
+	TraversalRay traversalRay(ray, t_min, t_max);
+	double& closest = traversalRay.tMax;
+	bool intersected = false;
+
+	uint32_t stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+		double t_entry;
+		if (!node.bounds.hit(traversalRay, t_entry)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+				if (objects[i]->intersection(ray, t_min, closest, hitRecord)) {
+					intersected = true;
+					closest = hitRecord.intT;
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first, so the nearer one is popped next
+		uint32_t firstChild = (uint32_t)(&node - nodes.data()) + 1;
+		if (traversalRay.sign[node.axis]) {
+			stack[stackSize++] = firstChild;
+			stack[stackSize++] = node.offset;
+		}
+		else {
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = firstChild;
+		}
+	}
+
+	return intersected;
+}
+
+/*
+* Checks whether a ray hits any Object of the BVH. Stops at the first hit, so it's cheaper than intersection for shadow rays.
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return True if the ray hits an Object within [t_min, t_max], false otherwise
+*/
+bool BVH::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	if (nodes.empty()) {
+		return false;
+	}
+
+	const TraversalRay traversalRay(ray, t_min, t_max);
+	uint32_t stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+		double t_entry;
+		if (!node.bounds.hit(traversalRay, t_entry)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+				if (objects[i]->occluded(ray, t_min, t_max)) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.offset;
+		stack[stackSize++] = (uint32_t)(&node - nodes.data()) + 1;
+	}
+
+	return false;
+}
+
+/*
+* NOTE: A BVH has no surface of its own, this is only to comply with the pure virtual override requirements of Object
+*
+* @param intersection The intersection point
+*
+* @return An arbitrary unit vector
+*/
+Vec3D BVH::normal(const Point3D&) const
+{
+	return Vec3D(0, 0, 1);
+}
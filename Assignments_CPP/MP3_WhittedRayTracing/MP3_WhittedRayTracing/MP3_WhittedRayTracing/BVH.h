@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Object.h"
+
+constexpr int BVH_BINS = 16;                        // SAH split candidates per axis
+constexpr size_t BVH_MAX_LEAF_OBJECTS = 4;          // nodes with more Objects than this are always split
+constexpr double BVH_TRAVERSAL_COST = 1.0;          // SAH cost of visiting a node, relative to one Object test
+constexpr int BVH_STACK_SIZE = 64;                  // nodes this deep become leaves, so traversal never overflows its stack
+
+// Node of a BVH, stored depth-first so the first child of an interior node is the node right after it
+struct BVHNode {
+    AABB3D bounds;
+    uint32_t offset;    // first Object of a leaf, second child of an interior node
+    uint32_t count;     // Objects in a leaf, 0 for interior nodes
+    uint32_t axis;      // split axis of an interior node, used to visit the nearer child first
+};
+
+// Bounding volume hierarchy over bounded Objects, built with binned SAH and flattened into one array.
+// Objects without a bounding box (Planes) can't go in it; the World tests those alongside it.
+class BVH :
+    public Object
+{
+private:
+    std::vector<BVHNode> nodes;
+    std::vector<std::shared_ptr<Object>> objects;   // in leaf order
+
+    // only kept while building
+    std::vector<AABB3D> buildBounds;
+    std::vector<Point3D> buildCentroids;
+    std::vector<uint32_t> buildIndices;
+
+    uint32_t buildRecursive(size_t start, size_t end, int depth);
+    size_t partitionSAH(size_t start, size_t end, const AABB3D& bounds, const AABB3D& centroidBounds, int& axis);
+
+public:
+    BVH();
+    BVH(const std::vector<std::shared_ptr<Object>>& list);
+
+    const std::vector<BVHNode>& getNodes() const;
+    const std::vector<std::shared_ptr<Object>>& getObjects() const;
+
+    bool generateBoundingBox(AABB3D& output_box) const;
+
+    int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
+    bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
+    Vec3D normal(const Point3D& intersection) const;
+};
@@ -3,11 +3,13 @@
 #include <fstream>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 
 #include "World.h"
 #include "SolidMaterial.h"
 #include "Mirror.h"
 #include "Dielectric.h"
+#include "AllocationCounter.h"
 
 #define PI 3.14159265
 
@@ -234,6 +236,157 @@ void dielectricTest() {
     im.writeToFile(filepath);
 }
 
+// A mirror-finished OBJ model on a dielectric ball, rendered through the BVH
+void objTest(const std::string& objFilepath) {
+    // SETUP WORLD
+    World world;
+    int rows = 500;
+    int cols = 500;
+    double width = 1.0;  // higher value = zoom out, lower value = zoom in
+
+    Camera camera;
+    camera.setPosition({ 0,0,0 });
+    camera.setViewWindowPosition(Point3D(0, 0, -1));
+    camera.setUpVector(Vec3D(0, 1, 0));
+    camera.setViewWindowRows(rows);
+    camera.setViewWindowCols(cols);
+    camera.setPixelSize(width / rows);
+    camera.setProjectionType(ProjectionType::PERSPECTIVE);
+    camera.setWorldPosition({ 0,2,8 });
+    world.setCamera(camera);
+
+    Image backgroundImage{ rows, cols, ColorRGB(255, 219, 247) };
+    world.setBackgroundImage(std::move(backgroundImage));
+    world.setAmbientLight(WHITE_COLOR * 0.2);
+
+    // BUILD WORLD
+    std::shared_ptr<TriangleMesh> tm{ new TriangleMesh };
+    tm->setMaterial(std::make_shared<Material>(Mirror()));
+    tm->loadFromOBJFile(objFilepath);
+    world.setTriangleMesh(tm);
+    world.addRenderOption(RenderOption::TRIANGLE_MESH);
+
+    world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,-1,0 }, { 0,1,0 }, std::make_shared<Material>(SolidMaterial(YELLOW_COLOR, YELLOW_COLOR, WHITE_COLOR)))));
+    world.addSceneObject(std::shared_ptr<Object>(new Sphere(Point3D(2.5, 0, 0.5), 1, std::make_shared<Material>(Dielectric(PINK_COLOR, PINK_COLOR)))));
+
+    world.addLightSource(std::shared_ptr<AreaLightSource>(new AreaLightSource({ Point3D(-12, 20, 2), Point3D(-10, 20, 2), Point3D(-12, 22, 1) }, std::make_shared<Material>(SolidMaterial(WHITE_COLOR, WHITE_COLOR, WHITE_COLOR)))));
+
+    // RENDER
+    std::cout << "Rendering ..." << std::endl;
+    Image im{ world.render() };
+    std::cout << "Done rendering ..." << std::endl;
+    std::string filepath = objFilepath.substr(0, objFilepath.size() - 4) + "Test.ppm";
+    im.writeToFile(filepath);
+}
+
+// Random spheres in front of a mirror wall, every fourth one a mirror and every fourth one a dielectric
+void sphereTest(int sphereCount, bool useBVH = true) {
+    // SETUP WORLD
+    World world;
+    int rows = 500;
+    int cols = 500;
+    double width = 3.0;  // higher value = zoom out, lower value = zoom in
+
+    Camera camera;
+    camera.setPosition({ 0,0,0 });
+    camera.setViewWindowPosition(Point3D(0, 0, -1));
+    camera.setUpVector(Vec3D(0, 1, 0));
+    camera.setViewWindowRows(rows);
+    camera.setViewWindowCols(cols);
+    camera.setPixelSize(width / rows);
+    camera.setProjectionType(ProjectionType::PERSPECTIVE);
+    camera.setWorldPosition({ 0,0,0 });
+    world.setCamera(camera);
+
+    Image backgroundImage{ rows, cols, ColorRGB(255, 219, 247) };
+    world.setBackgroundImage(std::move(backgroundImage));
+    world.setAmbientLight(WHITE_COLOR * 0.2);
+
+    // BUILD WORLD
+    world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,0,-12 }, { 0,0,1 }, std::make_shared<Material>(Mirror()))));
+    world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,-11,0 }, { 0,1,0 }, std::make_shared<Material>(SolidMaterial(BLUE_COLOR, BLUE_COLOR, WHITE_COLOR)))));
+
+    Point3D lowerLimit{ -10, -10, -10 };
+    Point3D upperLimit{ 10, 10, -5 };
+    const ColorRGB colors[4]{ RED_COLOR, GREEN_COLOR, ORANGE_COLOR, PINK_COLOR };
+    for (int i = 0; i < sphereCount; i++) {
+        std::shared_ptr<Material> material;
+        if (i % 4 == 1) {
+            material = std::make_shared<Material>(Mirror());
+        }
+        else if (i % 4 == 3) {
+            material = std::make_shared<Material>(Dielectric(colors[i % 4], colors[i % 4]));
+        }
+        else {
+            material = std::make_shared<Material>(SolidMaterial(colors[i % 4], colors[i % 4]));
+        }
+        world.addSceneObject(std::shared_ptr<Object>(new Sphere(Arithmetic::randomVec3D(lowerLimit, upperLimit), 0.2, material)));
+    }
+
+    world.addLightSource(std::shared_ptr<AreaLightSource>(new AreaLightSource({ Point3D(-12, 20, 2), Point3D(-10, 20, 2), Point3D(-12, 22, 1) }, std::make_shared<Material>(SolidMaterial(WHITE_COLOR, WHITE_COLOR, WHITE_COLOR)))));
+    if (useBVH) {
+        world.addRenderOption(RenderOption::BVH);
+    }
+
+    // RENDER
+    std::cout << "Rendering ..." << std::endl;
+    Image im{ world.render() };
+    std::cout << "Done rendering ..." << std::endl;
+    std::string filepath = "spheres" + std::to_string(sphereCount) + ".ppm";
+    im.writeToFile(filepath);
+}
+
+// Renders the dielectric test scene, which reflects, refracts and samples an area light, with and without BVH and
+// anti-aliasing, and checks that none of it allocates on the heap while tracing. Counting needs COUNT_HEAP_ALLOCATIONS,
+// which the Debug configurations define.
+void allocationTest(int size = 100) {
+    if (!AllocationCounter::enabled()) {
+        std::cout << "Allocation test skipped, define COUNT_HEAP_ALLOCATIONS to count heap allocations" << std::endl;
+        return;
+    }
+    const std::vector<std::vector<RenderOption>> optionSets{
+        {},
+        { RenderOption::BVH },
+        { RenderOption::BVH, RenderOption::ANTI_ALIASING },
+    };
+    for (const std::vector<RenderOption>& options : optionSets) {
+        World world;
+        for (const RenderOption& option : options) {
+            world.addRenderOption(option);
+        }
+
+        Camera camera;
+        camera.setPosition({ 0,0,0 });
+        camera.setViewWindowPosition(Point3D(0, 0, -1));
+        camera.setUpVector(Vec3D(0, 1, 0));
+        camera.setViewWindowRows(size);
+        camera.setViewWindowCols(size);
+        camera.setPixelSize(2.0 / size);
+        camera.setProjectionType(ProjectionType::PERSPECTIVE);
+        camera.setWorldPosition({ 0,0,0 });
+        world.setCamera(camera);
+
+        Image backgroundImage{ size, size, ColorRGB(255, 219, 247) };
+        world.setBackgroundImage(std::move(backgroundImage));
+        world.setAmbientLight(WHITE_COLOR * 0.2);
+
+        world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,0,-15 }, { 0,0,1 }, std::make_shared<Material>(SolidMaterial(BLUE_COLOR, BLUE_COLOR, WHITE_COLOR)))));
+        world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,-2,0 }, { 0,1,0 }, std::make_shared<Material>(SolidMaterial(YELLOW_COLOR, YELLOW_COLOR, WHITE_COLOR)))));
+        world.addSceneObject(std::shared_ptr<Object>(new Plane({ 0,0,25 }, { 0,0,-1 }, std::make_shared<Material>(SolidMaterial(ORANGE_COLOR, ORANGE_COLOR, WHITE_COLOR)))));
+        world.addSceneObject(std::shared_ptr<Object>(new Triangle({ Point3D{ -7, -2, -9 }, Point3D{1, -2, -7}, Point3D{1, 4, -7} }, std::make_shared<Material>(Mirror()))));
+        world.addSceneObject(std::shared_ptr<Object>(new Triangle({ Point3D{ -1, -2, -4 }, Point3D{1, -2, -4}, Point3D{0, -2, -6} }, std::make_shared<Material>(SolidMaterial(RED_COLOR, RED_COLOR, WHITE_COLOR)))));
+        world.addSceneObject(std::shared_ptr<Object>(new Sphere(Point3D(0, -0.5, -5), 1.5, std::make_shared<Material>(Dielectric(PINK_COLOR, PINK_COLOR)))));
+        world.addLightSource(std::shared_ptr<AreaLightSource>(new AreaLightSource({ Point3D(-12, 20, 2), Point3D(-10, 20, 2), Point3D(-12, 22, 1) }, std::make_shared<Material>(SolidMaterial(WHITE_COLOR, WHITE_COLOR, WHITE_COLOR)))));
+
+        world.render();
+        if (world.getRayTracingAllocations() != 0) {
+            std::cerr << "Allocation test failed: " << world.getRayTracingAllocations() << " heap allocations while tracing rays with " << options.size() << " render options" << std::endl;
+            std::abort();
+        }
+    }
+    std::cout << "Allocation test passed: no heap allocations while tracing rays" << std::endl;
+}
+
 int main()
 {
     //testBench();
@@ -241,4 +394,7 @@ int main()
     areaLightTest();
     //reflectionTest();
     //dielectricTest();
+    //objTest("teapotObj.txt");
+    //sphereTest(1000);
+    allocationTest();
 }
\ No newline at end of file
@@ -21,3 +21,18 @@ const std::shared_ptr<Material>& Object::getMaterial() const
 	return material;
 }
 
+/*
+* Checks whether a ray hits the Object at all. Shadow rays only need this, so subclasses may override it with a
+* test that skips filling in a HitRecord.
+*
+* @param ray A Ray3D.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return True if the ray hits the Object within [t_min, t_max], false otherwise
+*/
+bool Object::occluded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	HitRecord hitRecord;
+	return intersection(ray, t_min, t_max, hitRecord);
+}
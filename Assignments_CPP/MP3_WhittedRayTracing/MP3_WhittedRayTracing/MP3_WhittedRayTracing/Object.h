@@ -7,8 +7,9 @@
 #include "Vec3D.h"
 #include "Ray3D.h"
 #include "Arithmetic.h"
+#include "AxisAlignedBoundingBox.h"
 
-enum class ObjectType { Plane, Sphere, Triangle, PointLightSource, AreaLightSource, None };
+enum class ObjectType { Plane, Sphere, Triangle, PointLightSource, AreaLightSource, BVH, None };
 
 class Object
 {
@@ -24,4 +25,7 @@ public:
 	// IMPLEMENT FOR ALL SUBCLASSES
 	virtual int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const = 0;
 	virtual Vec3D normal(const Point3D& intersection) const = 0;
+	virtual bool generateBoundingBox(AABB3D& output_box) const = 0;
+
+	virtual bool occluded(const Ray3D& ray, const double& t_min, const double& t_max) const;
 };
@@ -51,6 +51,7 @@ int Plane::intersection(const Ray3D& ray, const double& t_min, const double& t_m
 		hitRecord.intPoint = intPoint;
 		hitRecord.setFaceNormal(ray, normal(intPoint));
 		hitRecord.material = getMaterial();
+		hitRecord.lightSource = false;
 		return 1;
 	}
 	return 0;
@@ -68,3 +69,15 @@ Vec3D Plane::normal(const Point3D& intersection) const
 {
 	return normal_vector;
 }
+
+/*
+* Generates the bounding box of the Plane
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return False (a Plane is infinite, so it has no bounding box)
+*/
+bool Plane::generateBoundingBox(AABB3D&) const
+{
+	return false;
+}
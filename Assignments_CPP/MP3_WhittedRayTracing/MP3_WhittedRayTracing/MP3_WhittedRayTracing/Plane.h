@@ -18,5 +18,6 @@ public:
 
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
     Vec3D normal(const Point3D& intersection) const;
+    bool generateBoundingBox(AABB3D& output_box) const;
 };
 
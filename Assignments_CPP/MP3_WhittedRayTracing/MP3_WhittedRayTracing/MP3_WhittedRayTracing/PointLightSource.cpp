@@ -56,6 +56,18 @@ Vec3D PointLightSource::normal(const Point3D& intersection) const
     return Vec3D{ 0,0,1 };
 }
 
+/*
+* Generates the bounding box of the PointLightSource
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return False (a point has no volume to hit, so it is never put in a BVH)
+*/
+bool PointLightSource::generateBoundingBox(AABB3D&) const
+{
+    return false;
+}
+
 /*
 * Return the position of the PointLightSource
 * Overridden virtual function
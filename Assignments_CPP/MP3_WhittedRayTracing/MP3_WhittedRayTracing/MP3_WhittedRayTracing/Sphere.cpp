@@ -13,6 +13,7 @@
 Sphere::Sphere(const Point3D& center, const double& radius, const std::shared_ptr<Material>& material) : Object(ObjectType::Sphere, material), center(center), radius(radius) {
 	Point3D minPoint(center[0] - radius, center[1] - radius, center[2] - radius);
 	Point3D maxPoint(center[0] + radius, center[1] + radius, center[2] + radius);
+	boundingBox = AABB3D(minPoint, maxPoint);
 }
 
 /*
@@ -52,22 +53,24 @@ int Sphere::intersection(const Ray3D& ray, const double& t_min, const double& t_
 	double b = 2.0 * B.dotProduct(A - C);
 	double c = (A - C).euclideanSquared() - pow(R, 2.0);
 
-	std::vector<double> potentialSols;
+	double potentialSols[2];
 	int sol_count = Arithmetic::quadratic_solver(a, b, c, potentialSols);
 
 	if (sol_count == 0) {
 		return 0;
 	}
-	std::vector<double> sols;
-	for (double ps : potentialSols) {
-		if (!(ps < Arithmetic::EPSILON || ps < t_min || ps > t_max)) {
-			sols.push_back(ps);
+	bool found = false;
+	double intT = 0;
+	for (int i = 0; i < sol_count; i++) {
+		const double ps = potentialSols[i];
+		if (!(ps < Arithmetic::EPSILON || ps < t_min || ps > t_max) && (!found || ps < intT)) {
+			found = true;
+			intT = ps;
 		}
 	}
-	if (sols.size() == 0) {
+	if (!found) {
 		return 0;
 	}
-	double intT = *(std::min_element(sols.begin(), sols.end()));
 	Point3D intPoint = ray.pos(intT);
 
 	hitRecord.intersected = true;
@@ -75,6 +78,7 @@ int Sphere::intersection(const Ray3D& ray, const double& t_min, const double& t_
 	hitRecord.intPoint = intPoint;
 	hitRecord.setFaceNormal(ray, normal(intPoint));
 	hitRecord.material = getMaterial();
+	hitRecord.lightSource = false;
 
 	return 1;
 }
@@ -90,3 +94,16 @@ Vec3D Sphere::normal(const Point3D& intersection) const
 {
 	return (intersection - center).get_normalized();
 }
+
+/*
+* Generates the bounding box of the Sphere
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return True (a Sphere is always bounded)
+*/
+bool Sphere::generateBoundingBox(AABB3D& output_box) const
+{
+	output_box = boundingBox;
+	return true;
+}
@@ -10,6 +10,7 @@ class Sphere :
 private:
     Point3D center;
     double radius;
+    AABB3D boundingBox;
 public:
     Sphere(const Point3D& center, const double& radius, const std::shared_ptr<Material>& material);
 
@@ -18,6 +19,7 @@ public:
 
     int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
     Vec3D normal(const Point3D& intersection) const;
+    bool generateBoundingBox(AABB3D& output_box) const;
 
 };
 
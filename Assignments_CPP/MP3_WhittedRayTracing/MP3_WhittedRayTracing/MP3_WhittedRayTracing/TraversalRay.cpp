@@ -0,0 +1,40 @@
+#include "TraversalRay.h"
+
+#include <cmath>
+
+/*
+* Default constructor for TraversalRay (a ray along +x from the origin, over [0, 0])
+*/
+TraversalRay::TraversalRay() : origin{ 0, 0, 0 }, invDir{ 1, INFINITY, INFINITY }, sign{ 0, 0, 0 }, tMin(0), tMax(0) {}
+
+/*
+* Constructor for TraversalRay
+*
+* @param ray The Ray3D
+* @param tMin The minimum intersection t.
+* @param tMax The maximum intersection t.
+*/
+TraversalRay::TraversalRay(const Ray3D& ray, double tMin, double tMax)
+{
+	set(ray, tMin, tMax);
+}
+
+/*
+* Prepares a Ray3D for traversal
+*
+* @param ray The Ray3D
+* @param tMin The minimum intersection t.
+* @param tMax The maximum intersection t.
+*/
+void TraversalRay::set(const Ray3D& ray, double tMin, double tMax)
+{
+	const Point3D& start = ray.getStart();
+	const Vec3D& direction = ray.getDirection();
+	for (int a = 0; a < 3; a++) {
+		origin[a] = start[a];
+		invDir[a] = 1.0 / direction[a];
+		sign[a] = std::signbit(invDir[a]) ? 1 : 0;
+	}
+	this->tMin = tMin;
+	this->tMax = tMax;
+}
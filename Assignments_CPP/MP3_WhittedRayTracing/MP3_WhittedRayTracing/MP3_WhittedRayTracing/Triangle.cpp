@@ -12,9 +12,10 @@ Triangle::Triangle(const Point3D(&v)[3], const std::shared_ptr<Material>& materi
 	vertices[1] = v[1];
 	vertices[2] = v[2];
 
-	Vec3D A = vertices[1] - vertices[0];
-	Vec3D B = vertices[2] - vertices[0];
-	normals[0] = B.crossProduct(A);
+	// The edges are kept for the intersection test, so it doesn't rebuild them for every ray
+	edge1 = vertices[1] - vertices[0];
+	edge2 = vertices[2] - vertices[0];
+	normals[0] = edge2.crossProduct(edge1);
 	normals[0].normalize();
 
 	Point3D minPoint;
@@ -24,6 +25,7 @@ Triangle::Triangle(const Point3D(&v)[3], const std::shared_ptr<Material>& materi
 		minPoint[i] = std::min(vertices[0][i], std::min(vertices[1][i], vertices[2][i]));
 		maxPoint[i] = std::max(vertices[0][i], std::max(vertices[1][i], vertices[2][i]));
 	}
+	boundingBox = AABB3D(minPoint, maxPoint);
 
 }
 
@@ -76,18 +78,19 @@ const Point3D& Triangle::vertex2() const
 */
 int Triangle::intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const
 {
-	double intT;
-	Point3D intPoint;
-	bool intersected = Arithmetic::moller_trumbore(ray.getStart(), ray.getDirection(), vertices, intT, intPoint);
+	double intT, u, v;
+	bool intersected = Arithmetic::moller_trumbore(ray.getStart(), ray.getDirection(), vertices[0], edge1, edge2, intT, u, v);
 	if (intersected) {
 		if (intT < t_min || intT > t_max) {
 			return 0;
 		}
+		Point3D intPoint = ray.pos(intT);
 		hitRecord.intersected = true;
 		hitRecord.intT = intT;
 		hitRecord.intPoint = intPoint;
 		hitRecord.setFaceNormal(ray, normal(intPoint));
 		hitRecord.material = getMaterial();
+		hitRecord.lightSource = getObjectType() == ObjectType::AreaLightSource;
 
 		return 1;
 	}
@@ -106,6 +109,19 @@ Vec3D Triangle::normal(const Point3D& intersection) const
 	return normals[0];
 }
 
+/*
+* Generates the bounding box of the Triangle
+*
+* @param output_box The bounding box. Modified by function.
+*
+* @return True (a Triangle is always bounded)
+*/
+bool Triangle::generateBoundingBox(AABB3D& output_box) const
+{
+	output_box = boundingBox;
+	return true;
+}
+
 /*
 * @return Triangle in pretty string format
 */
@@ -12,6 +12,9 @@ class Triangle :
 private:
     Point3D vertices[3];
     Vec3D normals[3];
+    Vec3D edge1;    // vertices[1] - vertices[0]
+    Vec3D edge2;    // vertices[2] - vertices[0]
+    AABB3D boundingBox;
 public:
     Triangle(const Point3D(&v)[3], const std::shared_ptr<Material>& material, const ObjectType& objectType=ObjectType::Triangle);
 
@@ -23,6 +26,7 @@ public:
 
     virtual int intersection(const Ray3D& ray, const double& t_min, const double& t_max, HitRecord& hitRecord) const;
     Vec3D normal(const Point3D& intersection) const;
+    bool generateBoundingBox(AABB3D& output_box) const;
 
     std::string toString() const;
 
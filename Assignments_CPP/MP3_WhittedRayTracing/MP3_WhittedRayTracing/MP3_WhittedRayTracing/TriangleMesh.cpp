@@ -0,0 +1,83 @@
+#include "TriangleMesh.h"
+
+/*
+* Constructor for TriangleMesh. Initializes the material to a solid pink one.
+*/
+TriangleMesh::TriangleMesh() : material(std::make_shared<Material>()) {}
+
+/*
+* Sets the Material of every Triangle the mesh generates. Call before loadFromOBJFile.
+*
+* @param material The Material
+*/
+void TriangleMesh::setMaterial(const std::shared_ptr<Material>& material)
+{
+	this->material = material;
+}
+
+/*
+* Load a model from an OBJ File, and generate one Triangle per face.
+*
+* @param path The filepath of the OBJ file
+*/
+void TriangleMesh::loadFromOBJFile(const std::string& path)
+{
+	std::ifstream file(path);
+	std::string line;
+
+	// Read in vertices and faces
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		else if (line[0] == 'v') {
+			std::string lf;
+			double x, y, z;
+			std::istringstream iss{ line };
+			if (!(iss >> lf >> x >> y >> z)) {
+				break;
+			}
+			vertices.push_back(Point3D{ x, y, z });
+		}
+		else if (line[0] == 'f') {
+			std::string lf;
+			size_t v0, v1, v2;
+			std::istringstream iss{ line };
+			if (!(iss >> lf >> v0 >> v1 >> v2)) {
+				break;
+			}
+			faces.push_back(TriangleFace{ v0 - 1, v1 - 1, v2 - 1 });
+		}
+	}
+	std::cout << "faces: " << faces.size() << std::endl;
+
+	// Generate Array of Triangles
+	for (const TriangleFace& face : faces) {
+		Point3D currVertices[3]{ vertices[face.v0_idx], vertices[face.v1_idx], vertices[face.v2_idx] };
+		triangles.push_back(std::make_shared<Triangle>(currVertices, material));
+	}
+}
+
+/*
+* @return The vertices
+*/
+const std::vector<Point3D>& TriangleMesh::getVertices() const
+{
+	return vertices;
+}
+
+/*
+* @return The faces
+*/
+const std::vector<TriangleFace>& TriangleMesh::getFaces() const
+{
+	return faces;
+}
+
+/*
+* @return The triangles
+*/
+const std::vector<std::shared_ptr<Triangle>>& TriangleMesh::getTriangles() const
+{
+	return triangles;
+}
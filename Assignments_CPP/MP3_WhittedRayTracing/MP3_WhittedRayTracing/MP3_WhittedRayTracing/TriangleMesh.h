@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+
+#include "Triangle.h"
+
+struct TriangleFace {
+	size_t v0_idx;
+	size_t v1_idx;
+	size_t v2_idx;
+
+	/*
+	* Constructor for TriangleFace
+	*
+	* @param v0_idx Index of first vertex
+	* @param v1_idx Index of second vertex
+	* @param v2_idx Index of third vertex
+	*/
+	TriangleFace(const size_t& v0_idx, const size_t& v1_idx, const size_t& v2_idx) {
+		this->v0_idx = v0_idx;
+		this->v1_idx = v1_idx;
+		this->v2_idx = v2_idx;
+	}
+};
+
+class TriangleMesh
+{
+private:
+	std::vector<Point3D> vertices;
+	std::vector<TriangleFace> faces;
+
+	std::vector<std::shared_ptr<Triangle>> triangles;
+
+	std::shared_ptr<Material> material;
+
+public:
+	TriangleMesh();
+
+	void setMaterial(const std::shared_ptr<Material>& material);
+	void loadFromOBJFile(const std::string& path);
+
+	const std::vector<Point3D>& getVertices() const;
+	const std::vector<TriangleFace>& getFaces() const;
+	const std::vector<std::shared_ptr<Triangle>>& getTriangles() const;
+};
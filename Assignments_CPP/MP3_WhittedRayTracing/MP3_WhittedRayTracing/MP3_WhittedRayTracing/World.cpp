@@ -5,7 +5,7 @@
 /*
 * Default constructor for World
 */
-World::World() {}
+World::World() : rays_shot(0), rayTracingAllocations(0) {}
 
 /*
 * Default destructor for World
@@ -28,6 +28,22 @@ const std::shared_ptr<AreaLightSource> World::getLightSource() const
 	return lightSource;
 }
 
+/*
+* @return A reference to the World's TriangleMesh (null if there is none)
+*/
+const std::shared_ptr<TriangleMesh>& World::getTriangleMesh() const
+{
+	return triangleMesh;
+}
+
+/*
+* @return The BVH built by the last render (null if it didn't use one)
+*/
+const std::shared_ptr<BVH>& World::getBVH() const
+{
+	return bvh;
+}
+
 /*
 * @return A reference to the vector of all RenderOption in the World
 */
@@ -53,6 +69,14 @@ void World::addLightSource(std::shared_ptr<AreaLightSource> lightSource)
 	this->lightSource = lightSource;
 }
 
+/*
+* @param triangleMesh The TriangleMesh to add to the world. Its Triangles are only rendered with RenderOption::TRIANGLE_MESH.
+*/
+void World::setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh)
+{
+	this->triangleMesh = triangleMesh;
+}
+
 /*
 * @param renderOption The RenderOption to add to the world
 */
@@ -95,6 +119,14 @@ bool World::OPT_ANTI_ALIASING() const
 	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::ANTI_ALIASING) != renderOptions.end();
 }
 
+/*
+* @return bool Checks whether the user selected BVH as a RenderOption
+*/
+bool World::OPT_BVH() const
+{
+	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::BVH) != renderOptions.end();
+}
+
 /*
 * @return bool Checks whether the user selected TRIANGLE_MESH as a RenderOption
 */
@@ -103,6 +135,14 @@ bool World::OPT_TRIANGLE_MESH() const
 	return std::find(renderOptions.begin(), renderOptions.end(), RenderOption::TRIANGLE_MESH) != renderOptions.end();
 }
 
+/*
+* @return bool Whether rays are traced through a BVH (a TriangleMesh is always put in one)
+*/
+bool World::usesBVH() const
+{
+	return OPT_BVH() || OPT_TRIANGLE_MESH();
+}
+
 /*
 * @return The background Image of the World
 */
@@ -135,6 +175,86 @@ const ColorRGB& World::getAmbientLight()
 	return ambientLight;
 }
 
+/*
+* @return The heap allocations made while tracing rays in the last render. Always 0 unless COUNT_HEAP_ALLOCATIONS is defined.
+*/
+uint64_t World::getRayTracingAllocations() const
+{
+	return rayTracingAllocations;
+}
+
+/*
+* Builds the BVH over every bounded scene Object, the light source and the TriangleMesh (with RenderOption::TRIANGLE_MESH).
+* Objects without a bounding box are kept in unboundedObjects instead.
+*/
+void World::buildBVH()
+{
+	std::vector<std::shared_ptr<Object>> boundedObjects;
+	unboundedObjects.clear();
+	for (const std::shared_ptr<Object>& sceneObject : sceneObjects) {
+		AABB3D box;
+		if (sceneObject->generateBoundingBox(box)) {
+			boundedObjects.push_back(sceneObject);
+		}
+		else {
+			unboundedObjects.push_back(sceneObject);
+		}
+	}
+	if (OPT_TRIANGLE_MESH() && triangleMesh) {
+		const std::vector<std::shared_ptr<Triangle>>& triangles = triangleMesh->getTriangles();
+		boundedObjects.insert(boundedObjects.end(), triangles.begin(), triangles.end());
+	}
+	if (lightSource) {
+		boundedObjects.push_back(lightSource);
+	}
+
+	std::cout << "Objects to insert into BVH: " << boundedObjects.size() << std::endl;
+	if (!unboundedObjects.empty()) {
+		std::cout << "Unbounded Objects kept outside the BVH: " << unboundedObjects.size() << std::endl;
+	}
+	bvh = std::make_shared<BVH>(boundedObjects);
+	std::cout << bvh->getNodes().size() << " nodes in BVH!" << std::endl;
+}
+
+/*
+* Finds the closest unbounded Object a ray hits. Run before the BVH traversal, so a hit lowers t_max
+*
+* @param ray The ray to trace.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection. Lowered to the closest hit by function.
+* @param hitRecord HitRecord struct holding intersection information (if any). Modified by function.
+*
+* @return Whether any unbounded Object was hit
+*/
+bool World::intersectUnbounded(const Ray3D& ray, const double& t_min, double& t_max, HitRecord& hitRecord) const
+{
+	bool intersected = false;
+	for (const std::shared_ptr<Object>& unboundedObject : unboundedObjects) {
+		if (unboundedObject->intersection(ray, t_min, t_max, hitRecord)) {
+			intersected = true;
+			t_max = hitRecord.intT;
+		}
+	}
+	return intersected;
+}
+
+/*
+* @param ray The ray to trace.
+* @param t_min The minimum t-value of the intersection.
+* @param t_max The maximum t-value of the intersection.
+*
+* @return Whether any unbounded Object blocks the ray within [t_min, t_max]
+*/
+bool World::occludedUnbounded(const Ray3D& ray, const double& t_min, const double& t_max) const
+{
+	for (const std::shared_ptr<Object>& unboundedObject : unboundedObjects) {
+		if (unboundedObject->occluded(ray, t_min, t_max)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /*
 * Determines what objects a ray intersects..
 *
@@ -150,7 +270,14 @@ bool World::shootRay(const Ray3D& firstRay, HitRecord& hitRecord)
 	double minDist = 0;
 	bool intersected = false;
 
-	// Just do the usual ...
+	// The BVH holds the light source too, and marks the HitRecord when the light is the closest hit
+	if (usesBVH()) {
+		double t_max = MAX_T;
+		bool unboundedHit = intersectUnbounded(firstRay, 0, t_max, hitRecord);
+		return bvh->intersection(firstRay, 0, t_max, hitRecord) || unboundedHit;
+	}
+
+	// Otherwise, just do the usual ...
 	for (int i = 0; i < sceneObjects.size(); i++) {
 		if (intersected) {
 			sceneObjects[i]->intersection(firstRay, 0, hitRecord.intT, hitRecord);
@@ -196,12 +323,12 @@ void World::blinnPhongShading(const Ray3D& ray, const HitRecord& hitRecord, Colo
 	}
 
 	// Iterate over all sample points on the area light source!!!
-	std::vector<Point3D> samplePoints = lightSource->getSamplePoints();
+	const std::vector<Point3D>& samplePoints = lightSource->getSamplePoints();
 	ColorRGB runningColorSum{ 0,0,0 };
 
 	for (size_t i = 0; i < samplePoints.size(); i++) {
 
-		const Point3D currLightPoint = samplePoints[i];
+		const Point3D& currLightPoint = samplePoints[i];
 		const Point3D& lightRayStart = hitRecord.intPoint;
 		ColorRGB currColor{ 0,0,0 };
 		ColorRGB diffuseComponent = BLACK_COLOR / 255;
@@ -217,14 +344,21 @@ void World::blinnPhongShading(const Ray3D& ray, const HitRecord& hitRecord, Colo
 		// Iterate over all objects for the current light source to find shadow
 		bool shadow = false;
 		double maxShadowT = lightRay.getT(currLightPoint);
-		for (int j = 0; j < sceneObjects.size(); j++) {
-
-			// intersection happens ONLY IF the intersection point happens BEFORE the ray reaches the light source
-			HitRecord shadowHitRecord;
-			bool currShadow = sceneObjects[j]->intersection(lightRay, 0, maxShadowT, shadowHitRecord);
-			if (currShadow) {
-				shadow = true;
-				break;
+		if (usesBVH()) {
+			// stop just short of the sample point, so the light source in the BVH doesn't shadow itself
+			const double t_max_shadow = maxShadowT - Arithmetic::EPSILON;
+			shadow = occludedUnbounded(lightRay, 0, t_max_shadow) || bvh->occluded(lightRay, 0, t_max_shadow);
+		}
+		else {
+			for (int j = 0; j < sceneObjects.size(); j++) {
+
+				// intersection happens ONLY IF the intersection point happens BEFORE the ray reaches the light source
+				HitRecord shadowHitRecord;
+				bool currShadow = sceneObjects[j]->intersection(lightRay, 0, maxShadowT, shadowHitRecord);
+				if (currShadow) {
+					shadow = true;
+					break;
+				}
 			}
 		}
 
@@ -372,28 +506,41 @@ Image World::render()
 
 	camera.ready();
 
+	// Build the BVH
+	bvh.reset();
+	unboundedObjects.clear();
+	if (usesBVH()) {
+		auto bvh_start_time = std::chrono::high_resolution_clock::now();
+		std::cout << std::endl << "Building BVH..." << std::endl;
+		buildBVH();
+		double bvh_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - bvh_start_time).count();
+		std::cout << "BVH Construction Time: " << bvh_seconds << " seconds." << std::endl << std::endl;
+	}
+
 	// Record Start time
 	auto start_time = std::chrono::high_resolution_clock::now();
+	const uint64_t start_allocations = AllocationCounter::count();
 
 	// Iterate over all pixels, perform ray tracing on each
 	for (int i = 0; i < rows; i++) {
 		for (int j = 0; j < cols; j++) {
 
 			// Generate multiple samples with anti-aliasing, one sample without
-			std::vector<std::pair<double, double>> offsets{};
+			std::pair<double, double> offsets[ANTI_ALIASING_SAMPLES];
+			int sampleCount = 1;
 			if (OPT_ANTI_ALIASING()) {
-				Arithmetic::multi_jittered_sampling(4, offsets);
+				sampleCount = Arithmetic::multi_jittered_sampling(ANTI_ALIASING_DIVISIONS, offsets);
 			}
 			else {
-				offsets.push_back(std::make_pair(0.5, 0.5));
+				offsets[0] = std::make_pair(0.5, 0.5);
 			}
-			std::vector<ColorRGB> colors;
-			for (std::pair<double, double> o : offsets) {
-				colors.push_back(rayTracer(i, j, o.first, o.second));
+			ColorRGB colors[ANTI_ALIASING_SAMPLES];
+			for (int sample = 0; sample < sampleCount; sample++) {
+				colors[sample] = rayTracer(i, j, offsets[sample].first, offsets[sample].second);
 			}
 
 			// Take average of all colors for current pixel
-			rm.set(i, j, Arithmetic::averageVec3D(colors));
+			rm.set(i, j, Arithmetic::averageVec3D(colors, sampleCount));
 
 			if ((i * rows + j) % progressBlock == 0) {
 				std::cout << "Rendering ... " << blockCount << "% done" << std::endl;
@@ -404,10 +551,14 @@ Image World::render()
 	std::cout << "Rendering ... " << blockCount << "% done" << std::endl;
 
 	// Record Ending times
-	auto render_finish_time = clock();
-	double total_render_seconds = ((double)(render_finish_time)) / ((double)(CLOCKS_PER_SEC));
+	auto render_finish_time = std::chrono::high_resolution_clock::now();
+	double total_render_seconds = std::chrono::duration<double>(render_finish_time - start_time).count();
+	rayTracingAllocations = AllocationCounter::count() - start_allocations;
 	std::cout << "Total Render Time: " << total_render_seconds << " seconds." << std::endl << std::endl;
 	std::cout << "Rays Shot: " << rays_shot << std::endl;
+	if (AllocationCounter::enabled()) {
+		std::cout << "Heap Allocations While Ray Tracing: " << rayTracingAllocations << std::endl;
+	}
 
 	// Return rendered image
 	return rm;
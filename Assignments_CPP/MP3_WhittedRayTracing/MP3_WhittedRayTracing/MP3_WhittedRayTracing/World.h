@@ -14,9 +14,12 @@
 #include "Ray3D.h"
 #include "Image.h"
 #include "Camera.h"
+#include "BVH.h"
+#include "TriangleMesh.h"
 
 #include "PointLightSource.h"
 #include "AreaLightSource.h"
+#include "AllocationCounter.h"
 
 enum class RenderOption { ANTI_ALIASING, BVH, TRIANGLE_MESH };
 
@@ -24,34 +27,51 @@ const Point3D DEFAULT_VIEW_WINDOW[4]{ Point3D({-8, 4.5, -4.5}), Point3D({8, 4.5,
 
 const double MAX_T = 100000;
 
+constexpr int ANTI_ALIASING_DIVISIONS = 4;	// ANTI_ALIASING takes multi-jittered samples on this many coarse cells per axis
+constexpr int ANTI_ALIASING_SAMPLES = ANTI_ALIASING_DIVISIONS * ANTI_ALIASING_DIVISIONS;
+
 class World
 {
 private:
 	std::vector<std::shared_ptr<Object>> sceneObjects;
 	std::shared_ptr<AreaLightSource> lightSource;
+	std::shared_ptr<TriangleMesh> triangleMesh;
+	std::shared_ptr<BVH> bvh;
+	std::vector<std::shared_ptr<Object>> unboundedObjects;	// Objects without a bounding box (Planes), tested alongside the BVH
 	std::vector<RenderOption> renderOptions;
 	Image backgroundImage;
 	Camera camera;
 	ColorRGB ambientLight;
 
 	size_t rays_shot;
+	uint64_t rayTracingAllocations;	// heap allocations made while tracing rays, counted with COUNT_HEAP_ALLOCATIONS
+
+	void buildBVH();
+	bool intersectUnbounded(const Ray3D& ray, const double& t_min, double& t_max, HitRecord& hitRecord) const;
+	bool occludedUnbounded(const Ray3D& ray, const double& t_min, const double& t_max) const;
 public:
 	World();
 	~World();
 
 	const std::vector<std::shared_ptr<Object>>& getSceneObjects() const;
 	const std::shared_ptr<AreaLightSource> getLightSource() const;
+	const std::shared_ptr<TriangleMesh>& getTriangleMesh() const;
+	const std::shared_ptr<BVH>& getBVH() const;
 	const std::vector<RenderOption>& getRenderOptions() const;
 	const Image& getBackgroundImage();
 	const Camera& getCamera() const;
 	Camera& getCamera();
 	const ColorRGB& getAmbientLight();
+	uint64_t getRayTracingAllocations() const;
 
 	bool OPT_ANTI_ALIASING() const;
+	bool OPT_BVH() const;
 	bool OPT_TRIANGLE_MESH() const;
+	bool usesBVH() const;
 
 	void addSceneObject(std::shared_ptr<Object> sceneObject);
 	void addLightSource(std::shared_ptr<AreaLightSource> lightSource);
+	void setTriangleMesh(const std::shared_ptr<TriangleMesh>& triangleMesh);
 	void addRenderOption(const RenderOption& renderOption);
 	void setBackgroundImage(Image&& image);
 	void setCamera(const Camera& camera);